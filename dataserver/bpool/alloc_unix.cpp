@@ -1,14 +1,17 @@
 // alloc_unix.cpp
 //
 #include "dataserver/bpool/alloc_unix.h"
+#include "dataserver/bpool/numa.h"
 
 namespace sdl { namespace db { namespace bpool {
 
-page_bpool_alloc_unix::page_bpool_alloc_unix(const size_t size)
-    : m_alloc(get_alloc_size(size), vm_commited::false_) // may throw
+page_bpool_alloc_unix::page_bpool_alloc_unix(const size_t size, database_cfg const & cfg)
+    : m_alloc(get_alloc_size(size), vm_commited::false_, cfg.pool_hugepage,
+        cfg.pool_numa ? numa::node_count() : 1) // may throw
 {
     SDL_ASSERT(size <= capacity());
     SDL_ASSERT(size && !(size % pool_limits::page_size));
+    throw_error_if_t<page_bpool_alloc_unix>(m_alloc.block_reserved >= pool_limits::max_block, "max_block");
     SDL_TRACE(__FUNCTION__, " size = ", size, " ", size / megabyte<1>::value, " MB");
 }
 
@@ -23,7 +26,7 @@ void page_bpool_alloc_unix::release(block_list_t & free_block_list)
     break_or_continue const ret =
     free_block_list.for_each([this](block_head const * const p, block32 const id){
         SDL_ASSERT(get_block(id) == (char *)block_head::get_page_head(p));
-        return m_alloc.release_block(id);
+        return m_alloc.release_block(id - 1);
     });
     throw_error_if_t<page_bpool_alloc_unix>(is_break(ret), "release failed");
     SDL_DEBUG_CPP(const size_t test_count2 = m_alloc.alloc_block_count());
@@ -50,7 +53,7 @@ public:
     unit_test() {
         if (1) {
             enum { N = 8 };
-            page_bpool_alloc_unix test(pool_limits::block_size * N);
+            page_bpool_alloc_unix test(pool_limits::block_size * N, database_cfg());
             SDL_ASSERT(!test.used_block());
             SDL_ASSERT(test.unused_block() >= N); // = 16
             for (size_t i = 0; i < N; ++i) {
@@ -16,7 +16,8 @@ public:
     static constexpr size_t get_alloc_size(const size_t size) {
         return round_up_div(size, (size_t)block_size) * block_size;
     }
-    explicit page_bpool_alloc_unix(size_t);
+    using hugepage = vm_unix::hugepage;
+    page_bpool_alloc_unix(size_t, database_cfg const &);
     bool is_open() const {
         return true;
     }
@@ -47,18 +48,38 @@ public:
     }
     void release(block_list_t &); // release/decommit memory
     template <class fun_type>
-    bool defragment(fun_type && fun)  {
-        return m_alloc.defragment(fun);
+    size_t defragment(fun_type && fun, size_t const max_move)  { // returns number of moved blocks
+        return m_alloc.defragment([&fun](block32 const from, block32 const to){
+            return fun(from + 1, to + 1);
+        }, max_move);
     }
     block32 get_block_id(char const * block_adr) const { // block must be allocated
-        return m_alloc.get_block_id(block_adr);
+        return m_alloc.get_block_id(block_adr) + 1; // 0 is reserved for null block
     }
     char * get_block(block32 const id) const { // block must be allocated
-        return m_alloc.get_block(id);
+        SDL_ASSERT(id);
+        return m_alloc.get_block(id - 1);
+    }
+    char * get_block_address(block32 const id) const { // block must be allocated and pinned
+        SDL_ASSERT(id);
+        return m_alloc.get_block_address(id - 1);
     }
     size_t alloc_block_count() const {
         return m_alloc.alloc_block_count();
     }
+    hugepage arena_hugepage() const {
+        return m_alloc.arena_hugepage();
+    }
+    size_t node_count() const {
+        return m_alloc.node_count();
+    }
+    size_t current_node() const {
+        return m_alloc.current_node();
+    }
+    size_t block_node(block32 const id) const { // block must be allocated
+        SDL_ASSERT(id);
+        return m_alloc.block_node(id - 1);
+    }
 #if SDL_DEBUG || defined(SDL_TRACE_RELEASE)
     void trace() const;
 #endif
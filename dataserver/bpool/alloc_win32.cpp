@@ -6,7 +6,7 @@
 
 namespace sdl { namespace db { namespace bpool {
 
-page_bpool_alloc_win32::page_bpool_alloc_win32(const size_t size)
+page_bpool_alloc_win32::page_bpool_alloc_win32(const size_t size, database_cfg const &)
     : m_alloc(get_alloc_size(size), vm_commited::false_)
 {
     m_alloc_brk = m_alloc.base_address();
@@ -95,7 +95,7 @@ public:
     unit_test() {
         if (1) {
             enum { N = 8 };
-            page_bpool_alloc_win32 test(pool_limits::block_size * N);
+            page_bpool_alloc_win32 test(pool_limits::block_size * N, database_cfg());
             SDL_ASSERT(!test.used_block());
             SDL_ASSERT(test.unused_block() == N);
             for (size_t i = 0; i < N; ++i) {
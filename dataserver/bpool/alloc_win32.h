@@ -8,6 +8,7 @@
 
 #include "dataserver/bpool/vm_win32.h"
 #include "dataserver/bpool/block_list.h"
+#include "dataserver/system/database_cfg.h"
 
 namespace sdl { namespace db { namespace bpool {
 
@@ -15,10 +16,19 @@ class page_bpool_alloc_win32 final : noncopyable { // to be improved
     using block32 = block_index::block32;
 public:
     enum { block_size = pool_limits::block_size };  
-    explicit page_bpool_alloc_win32(size_t);
+    page_bpool_alloc_win32(size_t, database_cfg const &); // pool_hugepage and pool_numa are not supported
     bool is_open() const {
         return m_alloc.is_open();
     }
+    size_t node_count() const {
+        return 1;
+    }
+    size_t current_node() const {
+        return 0;
+    }
+    size_t block_node(block32) const {
+        return 0;
+    }
     size_t capacity() const {
         return m_alloc.byte_reserved;
     }
@@ -49,8 +59,8 @@ public:
     char * get_block(block32) const; // block must be allocated
     void release(block_list_t &); // release/decommit memory
     template <class fun_type>
-    static bool defragment(fun_type &&) {
-        return false;
+    static size_t defragment(fun_type &&, size_t) {
+        return 0;
     }
 #if SDL_DEBUG || defined(SDL_TRACE_RELEASE)
     void trace();
@@ -6,7 +6,9 @@ namespace sdl { namespace db { namespace bpool {
 namespace {
     A_STATIC_ASSERT_IS_POD(block_index);
     A_STATIC_ASSERT_IS_POD(block_head);
-    static_assert(sizeof(block_index) == sizeof(uint32), "");
+    static_assert(sizeof(block_index) == sizeof(uint64), "");
+    static_assert(sizeof(atomic_block_index) == sizeof(uint64), "");
+    static_assert(sizeof(std::atomic<block_head::count64>) == sizeof(block_head::count64), "");
     static_assert(pool_limits::max_block * pool_limits::block_size == terabyte<1>::value, "");
     static_assert(sizeof(block_head) == page_head::reserved_size, "");
     static_assert(sizeof(block_head) == 32, "");
@@ -71,6 +73,57 @@ public:
                 SDL_ASSERT(!test.d.pageLock);
             }
             SDL_ASSERT(T::last_block == test.value);
+            test.d.fastPin = block_index::fastPinMax;
+            SDL_ASSERT((test.value & block_index::fastPinMask) == (block_index::fastPinMax * block_index::fastPinOne));
+            test.d.fastPin = 0;
+            test.d.partial = 1;
+            SDL_ASSERT(test.value == (T::last_block | block_index::partialMask));
+            test.clr_blockId();
+            SDL_ASSERT(!test.value);
+        }
+        {
+            atomic_block_index test;
+            SDL_ASSERT(!test.fast_pin(0)); // not loaded
+            test.set_loading();
+            SDL_ASSERT(test.is_loading() && !test.blockId());
+            SDL_ASSERT(!test.fast_pin(0)); // in-flight
+            test.clr_loading();
+            test.set_loading();
+            test.publish(1); // prefetched
+            SDL_ASSERT(!test.is_loading());
+            SDL_ASSERT(!test.fast_pin(1)); // loaded but not locked
+            SDL_ASSERT(test.blockId() == 1);
+            test.clr_blockId();
+            test.set_loading();
+            test.publish(1, 0);
+            SDL_ASSERT(!test.is_loading());
+            SDL_ASSERT(test.fast_pin(3) == 1);
+            SDL_ASSERT(test.is_lock_page(3));
+            SDL_ASSERT(test.load().d.fastPin == 1);
+            test.fast_unpin();
+            SDL_ASSERT(!test.load().d.fastPin);
+            SDL_ASSERT(test.load().d.fastSeq == 1);
+            block_head head{};
+            SDL_ASSERT(test.clr_lock_page(3, &head) == 1);
+            head.add_lock();
+            SDL_ASSERT(test.clr_lock_page(0, &head) == 1); // page is locked again
+            SDL_ASSERT(!head.sub_lock());
+            SDL_ASSERT(!test.clr_lock_page(0, &head));
+            SDL_ASSERT(!test.fast_pin(0)); // not locked
+            test.clr_blockId();
+            SDL_ASSERT(!test.blockId());
+            test.set_loading();
+            test.publish_partial(2, 4);
+            SDL_ASSERT(test.is_partial() && !test.is_loading());
+            SDL_ASSERT(!test.fast_pin(5)); // page may be not loaded
+            SDL_ASSERT(test.fast_pin(4) == 2);
+            test.fast_unpin();
+            test.clr_partial();
+            SDL_ASSERT(!test.is_partial());
+            SDL_ASSERT(test.fast_pin(5) == 2);
+            test.fast_unpin();
+            SDL_ASSERT(test.load().blockId() == 2);
+            SDL_ASSERT(test.load().pageLock() == ((1 << 4) | (1 << 5)));
         }
         SDL_TRACE_FUNCTION;
     }
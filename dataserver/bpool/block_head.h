@@ -7,17 +7,14 @@
 #include "dataserver/system/page_head.h"
 #include "dataserver/common/array_enum.h"
 #include "dataserver/spatial/interval_set.h"
+#include <atomic>
+#include <thread>
 
 namespace sdl { namespace db { namespace bpool {
-namespace unit {
-    struct threadIndex{};
-}
-typedef quantity<unit::threadIndex, size_t> threadIndex;
 
 using page32 = pageFileID::page32;
 
 struct pool_limits final : is_static {
-    enum { max_thread = 64 };                                       // 64-bit mask
     enum { block_page_num = 8 };                                    // 1 extent
     enum { page_size = page_head::page_size };                      // 8 KB = 8192 byte = 2^13
     enum { block_size = page_size * block_page_num };               // 64 KB = 65536 byte = 2^16
@@ -30,23 +27,40 @@ struct pool_limits final : is_static {
 #pragma pack(push, 1) 
 
 struct block_index final {
-    static constexpr uint32 blockIdMask  = 0x00FFFFFF;
-    static constexpr uint32 pageLockMask = 0xFF000000;
+    static constexpr uint64 blockIdMask  = 0x0000000000FFFFFF;
+    static constexpr uint64 pageLockMask = 0x00000000FF000000;
+    static constexpr uint64 fastPinMask  = 0x00003FFF00000000;
+    static constexpr uint64 fastPinOne   = 0x0000000100000000;
+    static constexpr uint64 fastPinMax   = 0x3FFF;
+    static constexpr uint64 partialMask  = 0x0000400000000000;
+    static constexpr uint64 loadingMask  = 0x0000800000000000;
+    static constexpr uint64 fastSeqOne   = 0x0001000000000000;
     using block32 = uint32;
+    using value_type = uint64;
     static constexpr block32 invalid_block32 = block32(-1);
     struct data_type {
-        unsigned int blockId : 24;      // 1 terabyte address space 
-        unsigned int pageLock : 8;      // bitmask
+        uint64 blockId : 24;      // 1 terabyte address space 
+        uint64 pageLock : 8;      // bitmask
+        uint64 fastPin : 14;      // lock-free hits in progress
+        uint64 partial : 1;       // some pages of block are not read from file
+        uint64 loading : 1;       // block is being read from file (in-flight)
+        uint64 fastSeq : 16;      // incremented by each lock-free hit
     };
     union {
         data_type d;
-        uint32 value;
+        value_type value;
     };
     block32 blockId() const { // or address
-        return d.blockId;
+        return static_cast<block32>(d.blockId);
     }
     uint8 pageLock() const {
-        return d.pageLock;
+        return static_cast<uint8>(d.pageLock);
+    }
+    bool is_loading() const {
+        return d.loading != 0;
+    }
+    bool is_partial() const {
+        return d.partial != 0;
     }
     void clr_blockId();
     void set_blockId(block32);
@@ -65,8 +79,8 @@ inline constexpr size_t page_bit(pageIndex pageId) {
 
 class page_bpool;
 struct block_head final { // 32 bytes
-    using thread64 = uint64;
-    thread64 pageLockThread;        // 64 threads mask
+    using count64 = uint64;
+    count64 pageLockCount;          // number of threads which locked the page
     uint32 prevBlock;
     uint32 nextBlock;
     uint32 realBlock;               // real MDF block
@@ -76,10 +90,18 @@ struct block_head final { // 32 bytes
     unsigned int reserve24 : 24;      
 #endif
     unsigned int fixedBlock : 8;    // block is fixed in memory
-    uint64 reserve64;
-    bool is_lock_thread(size_t) const;
-    void set_lock_thread(size_t);
-    thread64 clr_lock_thread(size_t); // return new pageLockThread
+    uint32 unlockSeq;               // used by replacement policy
+    unsigned int frequent : 1;      // block was accessed again (replacement policy)
+    unsigned int prefetch : 1;      // block was read ahead and not accessed yet
+    unsigned int ring : 1;          // block is used only by bulk_read ring of one thread
+    unsigned int priority : 2;      // database_cfg::priority of block pages
+    unsigned int loaded : 8;        // pages read from file (bitmask)
+    unsigned int quota : 6;         // block_quota of file block (0 = none)
+    unsigned int pinned : 1;        // unlocked block is kept in pin list instead of replacement policy
+    unsigned int reserve12 : 12;
+    count64 lock_count() const;
+    void add_lock();
+    count64 sub_lock(); // return new pageLockCount
     void set_zero() {
         memset_zero(*this);
     }
@@ -107,6 +129,54 @@ struct block_head final { // 32 bytes
 
 #pragma pack(pop)
 
+// block_index shared by lock-free hits and the shard mutex owner;
+// lock-free hits only pin blocks which are already loaded and locked,
+// clearing page lock bits waits until pinned hits are completed;
+// in-flight block (loading) has no blockId until it is published.
+class atomic_block_index final {
+    using block32 = block_index::block32;
+    using value_type = block_index::value_type;
+    std::atomic<value_type> m_value;
+public:
+    atomic_block_index() noexcept : m_value(0) {}
+    block_index load() const {
+        block_index b;
+        b.value = m_value.load(std::memory_order_acquire);
+        return b;
+    }
+    block32 blockId() const {
+        return load().blockId();
+    }
+    uint8 pageLock() const {
+        return load().pageLock();
+    }
+    bool is_lock_page(size_t const i) const {
+        return load().is_lock_page(i);
+    }
+    bool can_free_unused() const {
+        return load().can_free_unused();
+    }
+    bool is_loading() const {
+        return load().is_loading();
+    }
+    bool is_partial() const {
+        return load().is_partial();
+    }
+    void set_loading(); // block is being read from file
+    void clr_loading(); // read from file failed
+    void set_blockId(block32); // block is not locked
+    void clr_blockId(); // block is not locked
+    void set_lock_page_all();
+    void publish(block32, size_t); // block loaded from file and page is locked, clears loading
+    void publish(block32); // block prefetched from file and not locked, clears loading
+    void publish_partial(block32, size_t); // only locked page is read from file, clears loading
+    void clr_partial(); // all pages are read from file
+    uint8 set_lock_page(size_t); // return old pageLock
+    uint8 clr_lock_page(size_t, block_head const *); // return new pageLock
+    block32 fast_pin(size_t); // returns 0 if block (or page of partial block) is not loaded or not locked
+    void fast_unpin();
+};
+
 using interval_block32 = interval_set<block_index::block32>;
 
 }}} // sdl
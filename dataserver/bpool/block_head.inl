@@ -15,6 +15,7 @@ inline void block_index::set_blockId(const block32 v) {
 inline void block_index::clr_blockId() {
     SDL_ASSERT(d.blockId && "warning");
     d.blockId = 0;
+    d.partial = 0;
 }
 inline bool block_index::is_lock_page(const size_t i) const {
     SDL_ASSERT(i < 8);
@@ -36,16 +37,125 @@ inline bool block_index::can_free_unused() const { // block is loaded and not lo
 }
 //-----------------------------------------------------------------
 
-inline bool block_head::is_lock_thread(size_t const i) const {
-    return bitmask<thread64>::is_bit(pageLockThread, i);
+inline void atomic_block_index::set_blockId(const block32 v) {
+    block_index b = load();
+    SDL_ASSERT(!b.pageLock() && !b.d.fastPin);
+    b.set_blockId(v);
+    m_value.store(b.value, std::memory_order_release);
 }
-inline void block_head::set_lock_thread(size_t const i) {
-    bitmask<thread64>::set_bit(pageLockThread, i);
+inline void atomic_block_index::clr_blockId() {
+    block_index b = load();
+    SDL_ASSERT(!b.pageLock() && !b.d.fastPin);
+    b.clr_blockId();
+    m_value.store(b.value, std::memory_order_release);
 }
-inline block_head::thread64
-block_head::clr_lock_thread(size_t const i) {
-    bitmask<thread64>::clr_bit(pageLockThread, i);
-    return pageLockThread;
+inline void atomic_block_index::set_lock_page_all() {
+    m_value.fetch_or(block_index::pageLockMask, std::memory_order_acq_rel);
+}
+inline void atomic_block_index::set_loading() {
+    block_index b = load();
+    SDL_ASSERT(!b.blockId() && !b.pageLock() && !b.d.fastPin && !b.is_loading());
+    b.d.loading = 1;
+    m_value.store(b.value, std::memory_order_release);
+}
+inline void atomic_block_index::clr_loading() {
+    block_index b = load();
+    SDL_ASSERT(!b.blockId() && !b.pageLock() && !b.d.fastPin && b.is_loading());
+    b.d.loading = 0;
+    m_value.store(b.value, std::memory_order_release);
+}
+inline void atomic_block_index::publish(const block32 v) {
+    block_index b = load();
+    SDL_ASSERT(!b.blockId() && !b.pageLock() && !b.d.fastPin && b.is_loading());
+    b.d.loading = 0;
+    b.set_blockId(v);
+    m_value.store(b.value, std::memory_order_release);
+}
+inline void atomic_block_index::publish(const block32 v, const size_t i) {
+    block_index b = load();
+    SDL_ASSERT(!b.blockId() && !b.pageLock() && !b.d.fastPin);
+    b.d.loading = 0;
+    b.set_blockId(v);
+    b.set_lock_page(i);
+    m_value.store(b.value, std::memory_order_release);
+}
+inline void atomic_block_index::publish_partial(const block32 v, const size_t i) {
+    block_index b = load();
+    SDL_ASSERT(!b.blockId() && !b.pageLock() && !b.d.fastPin);
+    b.d.loading = 0;
+    b.d.partial = 1;
+    b.set_blockId(v);
+    b.set_lock_page(i);
+    m_value.store(b.value, std::memory_order_release);
+}
+inline void atomic_block_index::clr_partial() {
+    m_value.fetch_and(~block_index::partialMask, std::memory_order_acq_rel);
+}
+inline uint8 atomic_block_index::set_lock_page(const size_t i) {
+    SDL_ASSERT(i < 8);
+    block_index b;
+    b.value = m_value.fetch_or(value_type(1) << (24 + i), std::memory_order_acq_rel);
+    return b.pageLock();
+}
+inline uint8 atomic_block_index::clr_lock_page(const size_t i, block_head const * const head) {
+    SDL_ASSERT(i < 8);
+    block_index old = load();
+    for (;;) {
+        SDL_ASSERT(old.is_lock_page(i));
+        if (old.d.fastPin) { // wait for lock-free hit(s)
+            std::this_thread::yield();
+            old = load();
+            continue;
+        }
+        if (head->lock_count()) { // page was locked again by lock-free hit
+            return old.pageLock();
+        }
+        block_index b = old;
+        b.clr_lock_page(i);
+        if (m_value.compare_exchange_weak(old.value, b.value,
+            std::memory_order_acq_rel, std::memory_order_acquire)) {
+            return b.pageLock();
+        }
+    }
+}
+inline block_index::block32
+atomic_block_index::fast_pin(const size_t i) {
+    SDL_ASSERT(i < 8);
+    block_index old = load();
+    for (;;) {
+        if (!(old.blockId() && old.pageLock()) || (old.d.fastPin == block_index::fastPinMax)) {
+            return 0;
+        }
+        if (old.is_partial() && !old.is_lock_page(i)) { // page may be not read from file
+            return 0;
+        }
+        block_index b = old;
+        b.set_lock_page(i);
+        b.value += block_index::fastPinOne + block_index::fastSeqOne; // fastSeq may wrap
+        if (m_value.compare_exchange_weak(old.value, b.value,
+            std::memory_order_acq_rel, std::memory_order_acquire)) {
+            return old.blockId();
+        }
+    }
+}
+inline void atomic_block_index::fast_unpin() {
+    SDL_ASSERT(load().d.fastPin);
+    m_value.fetch_sub(block_index::fastPinOne, std::memory_order_release);
+}
+
+//-----------------------------------------------------------------
+
+// pageLockCount is modified by lock-free hits, so it is accessed atomically
+inline block_head::count64 block_head::lock_count() const {
+    return reinterpret_cast<std::atomic<count64> const &>(pageLockCount).load(std::memory_order_acquire);
+}
+inline void block_head::add_lock() {
+    reinterpret_cast<std::atomic<count64> &>(pageLockCount).fetch_add(1, std::memory_order_acq_rel);
+}
+inline block_head::count64 block_head::sub_lock() {
+    const count64 old = reinterpret_cast<std::atomic<count64> &>(pageLockCount).fetch_sub(1, std::memory_order_acq_rel);
+    SDL_ASSERT(old);
+    return old - 1;
 }
 
 //-----------------------------------------------------------------
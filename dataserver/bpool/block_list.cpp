@@ -1,7 +1,7 @@
 // block_list.cpp
 //
 #include "dataserver/bpool/block_list.h"
-#include "dataserver/bpool/page_bpool.h"
+#include "dataserver/bpool/page_shard.h"
 
 namespace sdl { namespace db { namespace bpool {
 
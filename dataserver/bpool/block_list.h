@@ -11,12 +11,12 @@ namespace sdl { namespace db { namespace bpool {
 enum class freelist { false_, true_ };
 enum class tracef { false_, true_ };
 
-class page_bpool;
+class page_bpool_shard;
 class page_bpool_friend { // copyable
     using block32 = block_index::block32;
-    page_bpool const * m_p;
+    page_bpool_shard const * m_p;
 public:
-    page_bpool_friend(page_bpool const * p): m_p(p) { // allow implicit conversion
+    page_bpool_friend(page_bpool_shard const * p): m_p(p) { // allow implicit conversion
         SDL_ASSERT(m_p);
     }
     block_head * first_block_head(block32) const;
@@ -0,0 +1,428 @@
+// block_policy.cpp
+//
+#include "dataserver/bpool/block_policy.h"
+#include "dataserver/bpool/page_shard.h"
+
+namespace sdl { namespace db { namespace bpool {
+
+std::unique_ptr<block_policy>
+block_policy::make(database_cfg const & cfg,
+                   page_bpool_friend const & p,
+                   size_t const capacity,
+                   size_t const block_count,
+                   size_t const shard_count)
+{
+    SDL_ASSERT(shard_count);
+    priority_policy::floor_type floor;
+    for (size_t i = 0; i < floor.size(); ++i) { // share of shard
+        floor[i] = round_up_div(cfg.pool_floor[i], shard_count) / pool_limits::block_size;
+    }
+    return std::make_unique<priority_policy>(cfg.pool_policy, p, capacity, block_count, shard_count, floor);
+}
+
+std::unique_ptr<block_policy>
+block_policy::make(replacement const type,
+                   page_bpool_friend const & p,
+                   size_t const capacity,
+                   size_t const block_count,
+                   size_t const shard_count)
+{
+    if (replacement::arc == type) {
+        return std::make_unique<arc_policy>(p, capacity, block_count, shard_count);
+    }
+    SDL_ASSERT(replacement::lru == type);
+    return std::make_unique<lru_policy>(p);
+}
+
+//------------------------------------------------------
+
+lru_policy::lru_policy(page_bpool_friend const & p)
+    : m_list(page_bpool_friend(p), "unlock")
+{
+}
+
+void lru_policy::insert(block_head * const h, block32 const blockId)
+{
+    m_list.insert(h, blockId);
+}
+
+bool lru_policy::remove(block_head * const h, block32 const blockId)
+{
+    return m_list.remove(h, blockId);
+}
+
+size_t lru_policy::evict(block_list_t & dest, size_t const count)
+{
+    return m_list.truncate(dest, count);
+}
+
+void lru_policy::for_each(block_fun const & fun) const
+{
+    m_list.for_each([&fun](block_head const * const h, block32){ // tail is evicted first
+        fun(h);
+        return bc::continue_;
+    });
+}
+
+//------------------------------------------------------
+
+arc_policy::arc_policy(page_bpool_friend const & p,
+                       size_t const capacity,
+                       size_t const block_count,
+                       size_t const shard_count)
+    : m_capacity(a_max(capacity, size_t(1)))
+    , m_shard_count(shard_count)
+    , m_correlated(a_max(m_capacity / 16, size_t(2)))
+    , m_p(p)
+    , m_recency(page_bpool_friend(p), "recency")
+    , m_frequency(page_bpool_friend(p), "frequency")
+    , m_ghost_tag(block_count)
+{
+    SDL_ASSERT(m_shard_count);
+}
+
+uint8 & arc_policy::ghost_tag(size_t const realBlock)
+{
+    const size_t i = realBlock / m_shard_count; // index of block in shard
+    SDL_ASSERT(i < m_ghost_tag.size());
+    return m_ghost_tag[i];
+}
+
+void arc_policy::ghost_push(size_t const i, size_t const realBlock)
+{
+    SDL_ASSERT(i < 2);
+    uint8 & tag = ghost_tag(realBlock);
+    if (tag) {
+        --m_ghost_size[tag - 1];
+    }
+    tag = static_cast<uint8>(i + 1);
+    ++m_ghost_size[i];
+    auto & fifo = m_ghost[i];
+    fifo.push_back(static_cast<block32>(realBlock));
+    while (fifo.size() > m_capacity) {
+        uint8 & old = ghost_tag(fifo.front());
+        if (old == i + 1) {
+            old = 0;
+            --m_ghost_size[i];
+        }
+        fifo.pop_front();
+    }
+}
+
+void arc_policy::insert(block_head * const h, block32 const blockId)
+{
+    h->unlockSeq = ++m_seq;
+    const size_t i = list_index(h);
+    get_list(i).insert(h, blockId);
+    ++m_size[i];
+}
+
+bool arc_policy::remove(block_head * const h, block32 const blockId)
+{
+    const size_t i = list_index(h);
+    if (get_list(i).remove(h, blockId)) {
+        SDL_ASSERT(m_size[i]);
+        --m_size[i];
+        return true;
+    }
+    return false;
+}
+
+void arc_policy::on_hit(block_head * const h)
+{
+    SDL_ASSERT(!h->prefetch);
+    if (!h->frequent && (uint32(m_seq - h->unlockSeq) >= m_correlated)) {
+        h->frequent = 1; // will be inserted into frequency list
+    }
+}
+
+void arc_policy::on_miss(block_head * const h)
+{
+    SDL_ASSERT(h->realBlock);
+    uint8 & tag = ghost_tag(h->realBlock);
+    if (tag == 1) { // recency list is too short
+        const size_t delta = a_max(m_ghost_size[1] / m_ghost_size[0], size_t(1));
+        m_target = a_min(m_target + delta, m_capacity);
+    }
+    else if (tag == 2) { // frequency list is too short
+        const size_t delta = a_max(m_ghost_size[0] / m_ghost_size[1], size_t(1));
+        m_target = (m_target > delta) ? (m_target - delta) : 0;
+    }
+    else {
+        return;
+    }
+    --m_ghost_size[tag - 1];
+    tag = 0;
+    h->frequent = 1;
+}
+
+size_t arc_policy::evict_batch(size_t const count) const
+{
+    return a_min(count, a_max(m_capacity / 32, size_t(2)));
+}
+
+size_t arc_policy::evict(block_list_t & dest, size_t const count)
+{
+    SDL_ASSERT(dest.empty());
+    size_t result = 0;
+    for (; result < count; ++result) {
+        size_t i;
+        if (m_size[0] && ((m_size[0] > m_target) || !m_size[1])) {
+            i = 0;
+        }
+        else if (m_size[1]) {
+            i = 1;
+        }
+        else {
+            break;
+        }
+        block_list_t victim{page_bpool_friend(m_p)};
+        if (!get_list(i).truncate(victim, 1)) {
+            SDL_ASSERT(0);
+            break;
+        }
+        --m_size[i];
+        ghost_push(i, m_p.first_block_head(victim.head())->realBlock);
+        dest.append(std::move(victim));
+    }
+    return result;
+}
+
+void arc_policy::for_each(block_fun const & fun) const
+{
+    for (block_list_t const * list : { &m_frequency, &m_recency }) {
+        list->for_each([&fun](block_head const * const h, block32){
+            fun(h);
+            return bc::continue_;
+        });
+    }
+}
+
+#if SDL_DEBUG
+bool arc_policy::assert_list() const
+{
+    SDL_ASSERT(m_recency.assert_list());
+    SDL_ASSERT(m_frequency.assert_list());
+    SDL_ASSERT_DEBUG_2(m_recency.length() == m_size[0]);
+    SDL_ASSERT_DEBUG_2(m_frequency.length() == m_size[1]);
+    SDL_ASSERT(m_target <= m_capacity);
+    return true;
+}
+#endif
+
+//------------------------------------------------------
+
+priority_policy::priority_policy(replacement const type,
+                                 page_bpool_friend const & p,
+                                 size_t const capacity,
+                                 size_t const block_count,
+                                 size_t const shard_count,
+                                 floor_type const & floor)
+    : m_p(p)
+    , m_floor(floor)
+{
+    for (auto & c : m_class) {
+        c = block_policy::make(type, p, capacity, block_count, shard_count);
+    }
+}
+
+block_policy::priority
+priority_policy::page_priority(pageType::type const t)
+{
+    switch (t) {
+    case pageType::type::index:
+        return priority::index;
+    case pageType::type::GAM:
+    case pageType::type::SGAM:
+    case pageType::type::IAM:
+    case pageType::type::PFS:
+    case pageType::type::boot:
+    case pageType::type::fileheader:
+    case pageType::type::diffmap:
+    case pageType::type::MLmap:
+        return priority::meta;
+    default: // leaf data, text and unallocated pages
+        return priority::data;
+    }
+}
+
+block_policy::priority
+priority_policy::block_priority(char const * const block_adr, size_t const page_count, uint8 const loaded)
+{
+    SDL_ASSERT(page_count && (page_count <= pool_limits::block_page_num));
+    priority result = priority::data;
+    for (size_t i = 0; i < page_count; ++i) { // block is as valuable as its best page
+        if (!(loaded & (1 << i))) { // page is not read from file
+            continue;
+        }
+        page_head const * const page = reinterpret_cast<page_head const *>(block_adr + i * pool_limits::page_size);
+        set_max(result, page_priority(page->data.type));
+    }
+    return result;
+}
+
+bool priority_policy::find_block(block32 const blockId) const
+{
+    for (auto const & c : m_class) {
+        if (c->find_block(blockId)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void priority_policy::insert(block_head * const h, block32 const blockId)
+{
+    const size_t i = class_index(h);
+    m_class[i]->insert(h, blockId);
+    ++m_size[i];
+}
+
+bool priority_policy::remove(block_head * const h, block32 const blockId)
+{
+    const size_t i = class_index(h);
+    if (m_class[i]->remove(h, blockId)) {
+        SDL_ASSERT(m_size[i]);
+        --m_size[i];
+        return true;
+    }
+    return false;
+}
+
+void priority_policy::on_hit(block_head * const h)
+{
+    m_class[class_index(h)]->on_hit(h);
+}
+
+void priority_policy::on_miss(block_head * const h)
+{
+    m_class[class_index(h)]->on_miss(h);
+}
+
+size_t priority_policy::evict_class(size_t const i, block_list_t & dest, size_t const count)
+{
+    SDL_ASSERT(count <= m_size[i]);
+    block_list_t victim{page_bpool_friend(m_p)};
+    const size_t result = m_class[i]->evict(victim, count);
+    SDL_ASSERT(result <= m_size[i]);
+    m_size[i] -= result;
+    if (result) {
+        dest.append(std::move(victim));
+    }
+    return result;
+}
+
+size_t priority_policy::evict(block_list_t & dest, size_t const count)
+{
+    SDL_ASSERT(dest.empty());
+    for (size_t i = 0; i < size; ++i) { // higher class is not touched while lower class is above its floor
+        if (m_size[i] > m_floor[i]) {
+            return evict_class(i, dest, a_min(count, m_size[i] - m_floor[i]));
+        }
+    }
+    for (size_t i = 0; i < size; ++i) { // pool is too small for floors
+        if (m_size[i]) {
+            return evict_class(i, dest, a_min(count, m_size[i]));
+        }
+    }
+    return 0;
+}
+
+void priority_policy::for_each(block_fun const & fun) const
+{
+    for (size_t i = size; i; --i) { // higher class first
+        m_class[i - 1]->for_each(fun);
+    }
+}
+
+#if SDL_DEBUG
+bool priority_policy::assert_list() const
+{
+    for (size_t i = 0; i < size; ++i) {
+        SDL_ASSERT(m_class[i]->assert_list());
+        SDL_ASSERT_DEBUG_2(m_class[i]->length() == m_size[i]);
+    }
+    return true;
+}
+#endif
+
+#if SDL_DEBUG
+namespace {
+    class unit_test {
+    public:
+        unit_test() {
+            using T = pool_limits;
+            using block32 = block_index::block32;
+            pool_info_t const info(T::block_size * 16);
+            pool_budget budget(0, info.filesize);
+            std::vector<atomic_block_index> block(info.block_count);
+            block_quota quota(info.block_count);
+            page_bpool_shard shard(info, budget, block, quota, 0, 1, database_cfg());
+            arc_policy test(&shard, 4, info.block_count, 1);
+            block_head * h[4] = {};
+            block32 id[4] = {};
+            for (size_t i = 1; i < 4; ++i) {
+                char * const adr = shard.alloc_block();
+                id[i] = shard.get_block_id(adr);
+                h[i] = page_bpool_shard::first_block_head(adr);
+                h[i]->set_zero();
+                h[i]->d_blockId = id[i];
+                h[i]->realBlock = static_cast<block32>(i);
+                test.insert(h[i], id[i]);
+            }
+            SDL_ASSERT(test.length() == 3);
+            test.remove(h[1], id[1]);
+            test.on_hit(h[1]); // not correlated
+            SDL_ASSERT(h[1]->frequent);
+            test.insert(h[1], id[1]);
+            test.remove(h[1], id[1]);
+            test.on_hit(h[1]);
+            test.insert(h[1], id[1]);
+            SDL_ASSERT(test.assert_list());
+            { // scan blocks are evicted first
+                block_list_t dest(&shard);
+                SDL_ASSERT(test.evict(dest, 2) == 2);
+                SDL_ASSERT(!dest.find_block(id[1]));
+                SDL_ASSERT(test.length() == 1);
+                SDL_ASSERT(test.find_block(id[1]));
+                SDL_ASSERT(test.ghost_size(0) == 2);
+            }
+            h[2]->set_zero();
+            h[2]->d_blockId = id[2];
+            h[2]->realBlock = 2;
+            test.on_miss(h[2]); // hit in recency ghost
+            SDL_ASSERT(h[2]->frequent);
+            SDL_ASSERT(test.target() == 1);
+            SDL_ASSERT(test.ghost_size(0) == 1);
+            SDL_ASSERT(priority_policy::page_priority(pageType::type::data) == database_cfg::priority::data);
+            SDL_ASSERT(priority_policy::page_priority(pageType::type::index) == database_cfg::priority::index);
+            SDL_ASSERT(priority_policy::page_priority(pageType::type::IAM) == database_cfg::priority::meta);
+            { // data blocks are evicted first down to floor
+                priority_policy::floor_type floor{};
+                floor[0] = 1;
+                priority_policy test(database_cfg::replacement::lru, &shard, 4, info.block_count, 1, floor);
+                for (size_t i = 1; i < 4; ++i) {
+                    h[i]->set_zero();
+                    h[i]->d_blockId = id[i];
+                    h[i]->realBlock = static_cast<block32>(i);
+                    h[i]->priority = static_cast<unsigned>((i == 1) ? 
+                        database_cfg::priority::index : database_cfg::priority::data);
+                    test.insert(h[i], id[i]);
+                }
+                SDL_ASSERT(test.class_size(database_cfg::priority::data) == 2);
+                for (size_t i : { 2, 1, 3 }) { // data, index (data floor), data (floor is ignored)
+                    block_list_t dest(&shard);
+                    SDL_ASSERT(test.evict(dest, 1) == 1);
+                    SDL_ASSERT(dest.head() == id[i]);
+                }
+                SDL_ASSERT(test.empty());
+                SDL_ASSERT(test.assert_list());
+            }
+            SDL_TRACE_FUNCTION;
+        }
+    };
+    static unit_test s_test;
+}
+#endif // SDL_DEBUG
+
+}}} // sdl
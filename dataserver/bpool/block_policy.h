@@ -0,0 +1,191 @@
+// block_policy.h
+//
+#pragma once
+#ifndef __SDL_BPOOL_BLOCK_POLICY_H__
+#define __SDL_BPOOL_BLOCK_POLICY_H__
+
+#include "dataserver/bpool/block_list.h"
+#include "dataserver/system/database_cfg.h"
+#include <deque>
+#include <functional>
+
+namespace sdl { namespace db { namespace bpool {
+
+// replacement policy for unlocked blocks of one shard;
+// all methods are called under mutex of the shard
+class block_policy : noncopyable {
+protected:
+    using block32 = block_index::block32;
+    block_policy() = default;
+public:
+    using replacement = database_cfg::replacement;
+    using priority = database_cfg::priority;
+    using block_fun = std::function<void(block_head const *)>;
+    virtual ~block_policy() {}
+    virtual replacement type() const = 0;
+    virtual bool empty() const = 0;
+    virtual size_t length() const = 0; // O(N)
+    virtual bool find_block(block32) const = 0;
+    virtual void insert(block_head *, block32) = 0; // block is unlocked or prefetched
+    virtual bool remove(block_head *, block32) = 0; // block is locked or moved
+    virtual void on_hit(block_head *) {} // unlocked block was locked again (not by bulk read)
+    virtual void on_miss(block_head *) {} // block is loaded on demand
+    virtual size_t evict_batch(size_t count) const { // number of blocks to evict when pool is full
+        return count;
+    }
+    virtual size_t evict(block_list_t & dest, size_t count) = 0; // moves victims to empty dest
+    virtual void for_each(block_fun const &) const = 0; // from most valuable block to next victim
+#if SDL_DEBUG
+    virtual bool assert_list() const = 0;
+#endif
+    static std::unique_ptr<block_policy> make(database_cfg const &, page_bpool_friend const &,
+        size_t capacity, size_t block_count, size_t shard_count); // capacity and block_count of shard
+private:
+    static std::unique_ptr<block_policy> make(replacement, page_bpool_friend const &,
+        size_t capacity, size_t block_count, size_t shard_count);
+    friend class priority_policy;
+};
+
+// least recently unlocked block is evicted first
+class lru_policy final : public block_policy {
+public:
+    explicit lru_policy(page_bpool_friend const &);
+    replacement type() const override {
+        return replacement::lru;
+    }
+    bool empty() const override {
+        return m_list.empty();
+    }
+    size_t length() const override {
+        return m_list.length();
+    }
+    bool find_block(block32 const blockId) const override {
+        return m_list.find_block(blockId);
+    }
+    void insert(block_head *, block32) override;
+    bool remove(block_head *, block32) override;
+    size_t evict(block_list_t &, size_t) override;
+    void for_each(block_fun const &) const override;
+#if SDL_DEBUG
+    bool assert_list() const override {
+        return m_list.assert_list();
+    }
+#endif
+private:
+    block_list_t m_list;
+};
+
+// adaptive replacement cache (ARC): blocks accessed once (recency list)
+// are separated from blocks accessed again (frequency list), so one scan
+// cannot flush blocks which are used repeatedly; target size of recency list
+// adapts to hits in ghost lists of recently evicted blocks.
+class arc_policy final : public block_policy {
+public:
+    arc_policy(page_bpool_friend const &, size_t capacity, size_t block_count, size_t shard_count);
+    replacement type() const override {
+        return replacement::arc;
+    }
+    bool empty() const override {
+        return m_recency.empty() && m_frequency.empty();
+    }
+    size_t length() const override {
+        return m_size[0] + m_size[1];
+    }
+    bool find_block(block32 const blockId) const override {
+        return m_recency.find_block(blockId) || m_frequency.find_block(blockId);
+    }
+    void insert(block_head *, block32) override;
+    bool remove(block_head *, block32) override;
+    void on_hit(block_head *) override;
+    void on_miss(block_head *) override;
+    size_t evict_batch(size_t) const override;
+    size_t evict(block_list_t &, size_t) override;
+    void for_each(block_fun const &) const override;
+#if SDL_DEBUG
+    bool assert_list() const override;
+#endif
+    size_t target() const { // target size of recency list
+        return m_target;
+    }
+    size_t ghost_size(size_t const i) const {
+        SDL_ASSERT(i < 2);
+        return m_ghost_size[i];
+    }
+private:
+    static size_t list_index(block_head const * h) {
+        return h->frequent ? 1 : 0;
+    }
+    block_list_t & get_list(size_t const i) {
+        SDL_ASSERT(i < 2);
+        return i ? m_frequency : m_recency;
+    }
+    uint8 & ghost_tag(size_t realBlock);
+    void ghost_push(size_t, size_t realBlock);
+private:
+    size_t const m_capacity;
+    size_t const m_shard_count;
+    size_t const m_correlated; // re-access within this number of unlocks is not counted
+    page_bpool_friend const m_p;
+    block_list_t m_recency;   // [0] blocks accessed once
+    block_list_t m_frequency; // [1] blocks accessed again
+    size_t m_size[2] = {};
+    size_t m_target = 0; // ARC p
+    uint32 m_seq = 0; // unlock sequence
+    std::vector<uint8> m_ghost_tag; // 0 = none, 1 = recency ghost, 2 = frequency ghost
+    std::deque<block32> m_ghost[2]; // approximate FIFO, stale entries are skipped
+    size_t m_ghost_size[2] = {};
+};
+
+// blocks are grouped by priority class of their pages (block_head::priority);
+// lower class is evicted first down to its floor, so index and allocation pages
+// stay in memory while data pages are scanned; each class has own policy.
+class priority_policy final : public block_policy {
+    enum { size = database_cfg::priority_size };
+    using policy_type = std::unique_ptr<block_policy>;
+public:
+    using floor_type = array_t<size_t, size>; // in blocks
+    priority_policy(replacement, page_bpool_friend const &, size_t capacity,
+        size_t block_count, size_t shard_count, floor_type const &);
+    static priority page_priority(pageType::type);
+    static priority block_priority(char const * block_adr, size_t page_count, uint8 loaded); // loaded pages only
+    replacement type() const override {
+        return m_class[0]->type();
+    }
+    bool empty() const override {
+        return !length();
+    }
+    size_t length() const override {
+        return m_size[0] + m_size[1] + m_size[2];
+    }
+    bool find_block(block32) const override;
+    void insert(block_head *, block32) override;
+    bool remove(block_head *, block32) override;
+    void on_hit(block_head *) override;
+    void on_miss(block_head *) override;
+    size_t evict_batch(size_t const count) const override {
+        return m_class[0]->evict_batch(count);
+    }
+    size_t evict(block_list_t &, size_t) override;
+    void for_each(block_fun const &) const override;
+#if SDL_DEBUG
+    bool assert_list() const override;
+#endif
+    size_t class_size(priority const i) const { // O(1)
+        return m_size[static_cast<size_t>(i)];
+    }
+private:
+    static size_t class_index(block_head const * h) {
+        SDL_ASSERT(h->priority < size);
+        return h->priority;
+    }
+    size_t evict_class(size_t, block_list_t &, size_t);
+private:
+    page_bpool_friend const m_p;
+    floor_type const m_floor;
+    policy_type m_class[size];
+    size_t m_size[size] = {};
+};
+
+}}} // sdl
+
+#endif // __SDL_BPOOL_BLOCK_POLICY_H__
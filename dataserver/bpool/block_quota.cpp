@@ -0,0 +1,111 @@
+// block_quota.cpp
+//
+#include "dataserver/bpool/block_quota.h"
+
+namespace sdl { namespace db { namespace bpool {
+
+block_quota::block_quota(size_t const block_count)
+    : m_block(block_count)
+{
+    SDL_ASSERT(block_count);
+}
+
+block_quota::quota_id
+block_quota::insert(vector_block32 const & blocks, size_t const max_block, bool const pin)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (quota_id q = 1; q <= max_quota; ++q) {
+        entry & e = m_quota[q];
+        if (e.used || e.resident.load()) { // blocks of erased set are still tagged
+            continue;
+        }
+        e.used = true;
+        e.block_count = 0;
+        e.max_block = pin ? 0 : max_block;
+        e.pin = pin;
+        for (block32 const b : blocks) {
+            SDL_ASSERT(b && (b < m_block.size()));
+            const quota_id old = m_block[b].exchange(q);
+            if (old != q) {
+                if (old && m_quota[old].block_count) { // block moves from other set
+                    --m_quota[old].block_count;
+                }
+                ++e.block_count;
+            }
+        }
+        return q;
+    }
+    return 0;
+}
+
+block_quota::vector_block32
+block_quota::erase(quota_id const q)
+{
+    vector_block32 result;
+    if (!q || (q > max_quota)) {
+        return result;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    entry & e = m_quota[q];
+    if (!e.used) {
+        return result;
+    }
+    e.used = false;
+    e.pin = false;
+    e.max_block = 0;
+    e.block_count = 0;
+    for (size_t b = 1; b < m_block.size(); ++b) {
+        quota_id expected = q;
+        if (m_block[b].compare_exchange_strong(expected, 0)) {
+            result.push_back(static_cast<block32>(b));
+        }
+    }
+    return result;
+}
+
+block_quota::quota_stat
+block_quota::statistics(quota_id const q) const
+{
+    quota_stat result;
+    if (q && (q <= max_quota)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        entry const & e = m_quota[q];
+        if (e.used) {
+            result.block_count = e.block_count;
+            result.max_block = e.max_block;
+            result.pin = e.pin;
+        }
+        result.resident = e.resident;
+    }
+    return result;
+}
+
+#if SDL_DEBUG
+namespace {
+    class unit_test {
+    public:
+        unit_test() {
+            block_quota test(16);
+            SDL_ASSERT(!test.find(1));
+            const block_quota::quota_id q1 = test.insert({ 1, 2, 3 }, 2, false);
+            const block_quota::quota_id q2 = test.insert({ 3, 4 }, 0, true);
+            SDL_ASSERT(q1 && q2 && (q1 != q2));
+            SDL_ASSERT((test.find(1) == q1) && (test.find(3) == q2) && !test.find(5));
+            SDL_ASSERT(test.is_pinned(q2) && !test.is_pinned(q1) && !test.is_pinned(0));
+            test.add_resident(q1);
+            test.add_resident(q1);
+            SDL_ASSERT(!test.overflow(q1) && test.overflow(q1, 1) && !test.overflow(q2, 100));
+            SDL_ASSERT(test.statistics(q1).resident == 2);
+            SDL_ASSERT(test.erase(q1).size() == 2); // block 3 belongs to q2
+            SDL_ASSERT(test.insert({ 5 }, 1, false) != q1); // resident blocks are still tagged by q1
+            test.sub_resident(q1);
+            test.sub_resident(q1);
+            SDL_ASSERT(test.erase(q2).size() == 2);
+            SDL_ASSERT(!test.statistics(q2).pin);
+        }
+    };
+    static unit_test s_test;
+}
+#endif // SDL_DEBUG
+
+}}} // sdl
@@ -0,0 +1,71 @@
+// block_quota.h
+//
+#pragma once
+#ifndef __SDL_BPOOL_BLOCK_QUOTA_H__
+#define __SDL_BPOOL_BLOCK_QUOTA_H__
+
+#include "dataserver/bpool/block_head.h"
+#include <mutex>
+
+namespace sdl { namespace db { namespace bpool {
+
+// soft limits of resident blocks for sets of file blocks (pages of table or allocation unit);
+// pinned set is never evicted, set above its limit recycles its own blocks when they are unlocked;
+// file block belongs to one set (the last one assigned), resident block keeps its set in block_head::quota
+class block_quota : noncopyable {
+public:
+    using quota_id = uint8;
+    using block32 = block_index::block32;
+    using vector_block32 = std::vector<block32>;
+    enum { max_quota = 63 }; // block_head::quota has 6 bits, 0 means no quota
+    struct quota_stat {
+        size_t block_count = 0; // file blocks of the set
+        size_t max_block = 0;   // 0 if set is not limited
+        size_t resident = 0;    // blocks in memory
+        bool pin = false;
+    };
+    explicit block_quota(size_t block_count);
+    quota_id find(size_t const realBlock) const {
+        SDL_ASSERT(realBlock < m_block.size());
+        return m_block[realBlock].load(std::memory_order_relaxed);
+    }
+    bool is_pinned(quota_id const q) const {
+        return q && m_quota[q].pin.load(std::memory_order_relaxed);
+    }
+    bool overflow(quota_id const q, size_t const extra = 0) const { // resident (plus extra) blocks exceed limit
+        if (q) {
+            const size_t max_block = m_quota[q].max_block.load(std::memory_order_relaxed);
+            return max_block && (m_quota[q].resident.load(std::memory_order_relaxed) + extra > max_block);
+        }
+        return false;
+    }
+    void add_resident(quota_id const q) { // called under shard mutex
+        if (q) {
+            m_quota[q].resident.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    void sub_resident(quota_id const q) {
+        if (q) {
+            SDL_ASSERT(m_quota[q].resident.load());
+            m_quota[q].resident.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    quota_id insert(vector_block32 const &, size_t max_block, bool pin); // returns 0 if all quotas are used
+    vector_block32 erase(quota_id); // returns blocks of removed set
+    quota_stat statistics(quota_id) const;
+private:
+    struct entry {
+        std::atomic<size_t> max_block{0};
+        std::atomic<size_t> resident{0};
+        std::atomic_bool pin{false};
+        size_t block_count = 0; // under m_mutex
+        bool used = false;      // under m_mutex
+    };
+    std::vector<std::atomic<quota_id>> m_block; // set of each file block
+    entry m_quota[max_quota + 1];
+    mutable std::mutex m_mutex; // insert and erase
+};
+
+}}} // sdl
+
+#endif // __SDL_BPOOL_BLOCK_QUOTA_H__
@@ -2,6 +2,15 @@
 //
 #include "dataserver/bpool/file.h"
 
+#if defined(SDL_OS_UNIX)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <errno.h>
+#endif
+
 namespace sdl { namespace db { namespace bpool {
 
 #if defined(SDL_OS_WIN32)
@@ -135,6 +144,174 @@ void PagePoolFile_win32::read(char * lpBuffer, const size_t offset, size_t size)
     SDL_ASSERT(m_seekpos <= filesize());
 }
 
+void PagePoolFile_win32::readv(io_vec const * v, size_t const count, size_t offset)
+{
+    SDL_ASSERT(v && count);
+    for (io_vec const * const last = v + count; v != last; ++v) {
+        read(v->data, offset, v->size);
+        offset += v->size;
+    }
+}
+
 #endif // #if defined(SDL_OS_WIN32)
 
+#if defined(SDL_OS_UNIX)
+
+PagePoolFile_unix::PagePoolFile_unix(const std::string & fname, bool const direct)
+{
+    SDL_ASSERT(!fname.empty());
+    if (!fname.empty()) {
+        m_fd = ::open(fname.c_str(), O_RDONLY | O_CLOEXEC);
+        if (m_fd != -1) {
+            struct stat st;
+            if (!::fstat(m_fd, &st) && (st.st_size > 0)) {
+                m_filesize = static_cast<size_t>(st.st_size);
+            }
+            if (direct && m_filesize) {
+                open_direct(fname);
+            }
+        }
+    }
+}
+
+PagePoolFile_unix::~PagePoolFile_unix() {
+    if (m_direct_fd != -1) {
+        ::close(m_direct_fd);
+    }
+    if (m_fd != -1) {
+        ::close(m_fd);
+    }
+}
+
+// O_DIRECT may be rejected by open or by first read (e.g. tmpfs), so it is probed
+void PagePoolFile_unix::open_direct(const std::string & fname)
+{
+    SDL_ASSERT(m_direct_fd == -1);
+#if defined(O_DIRECT)
+    const int fd = ::open(fname.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+    if (fd == -1) {
+        SDL_TRACE("O_DIRECT is not supported: ", fname);
+        return;
+    }
+    std::unique_ptr<char[]> buf(new char[direct_align * 2]);
+    char * const dest = buf.get() + direct_align - reinterpret_cast<size_t>(buf.get()) % direct_align;
+    ssize_t n;
+    do {
+        n = ::pread(fd, dest, direct_align, 0);
+    } while ((n < 0) && (errno == EINTR));
+    if (n != direct_align) {
+        SDL_TRACE("O_DIRECT read failed: ", fname);
+        ::close(fd);
+        return;
+    }
+    m_direct_fd = fd;
+#else
+    SDL_TRACE("O_DIRECT is not supported: ", fname);
+#endif
+}
+
+bool PagePoolFile_unix::is_aligned(char const * const dest, size_t const offset, size_t const size)
+{
+    return !(reinterpret_cast<size_t>(dest) % direct_align) 
+        && !(offset % direct_align) 
+        && !(size % direct_align);
+}
+
+void PagePoolFile_unix::read(char * const dest, size_t const offset, size_t const size) const
+{
+    static_assert(sizeof(off_t) == sizeof(uint64), "64-bit file offset");
+    static_assert(!(page_head::page_size % direct_align), "");
+    SDL_ASSERT(dest);
+    SDL_ASSERT(size && !(size % page_head::page_size));
+    SDL_ASSERT(offset + size <= filesize());
+    if (is_direct() && is_aligned(dest, offset, size)) { // pool blocks are aligned
+        pread_all(m_direct_fd, dest, offset, size);
+    }
+    else {
+        pread_all(m_fd, dest, offset, size);
+    }
+}
+
+void PagePoolFile_unix::readv(io_vec const * const v, size_t const count, size_t const offset) const
+{
+    SDL_ASSERT(v && count);
+    if (count == 1) {
+        read(v->data, offset, v->size);
+        return;
+    }
+    preadv_all(read_fd(v, count, offset), v, count, offset);
+}
+
+int PagePoolFile_unix::read_fd(io_vec const * const v, size_t const count, size_t const offset) const
+{
+    SDL_ASSERT(v && count);
+    bool aligned = is_direct();
+    size_t size = 0;
+    for (size_t i = 0; i < count; ++i) {
+        SDL_ASSERT(v[i].data && v[i].size && !(v[i].size % page_head::page_size));
+        aligned = aligned && is_aligned(v[i].data, offset + size, v[i].size);
+        size += v[i].size;
+    }
+    SDL_ASSERT(offset + size <= filesize());
+    return aligned ? m_direct_fd : m_fd;
+}
+
+void PagePoolFile_unix::preadv_all(int const fd, io_vec const * v, size_t count, size_t offset)
+{
+    enum { max_iov = 64 };
+    static_assert(max_iov <= IOV_MAX, "");
+    ::iovec iov[max_iov];
+    size_t done = 0; // bytes of v[0] already read
+    while (count) {
+        const size_t n = a_min(count, size_t(max_iov));
+        for (size_t i = 0; i < n; ++i) {
+            iov[i].iov_base = v[i].data;
+            iov[i].iov_len = v[i].size;
+        }
+        iov[0].iov_base = v[0].data + done;
+        iov[0].iov_len = v[0].size - done;
+        ssize_t res = ::preadv(fd, iov, static_cast<int>(n), static_cast<off_t>(offset));
+        if (res > 0) {
+            offset += res;
+            while (count && (static_cast<size_t>(res) >= v->size - done)) { // skip filled vectors
+                res -= v->size - done;
+                done = 0;
+                ++v;
+                --count;
+            }
+            done += res;
+            SDL_ASSERT(!count || (done < v->size));
+        }
+        else if ((res < 0) && (errno == EINTR)) {
+            continue;
+        }
+        else {
+            SDL_ASSERT(0);
+            throw_error_t<PagePoolFile_unix>("preadv failed");
+        }
+    }
+}
+
+void PagePoolFile_unix::pread_all(int const fd, char * dest, size_t offset, size_t size)
+{
+    while (size) {
+        const ssize_t n = ::pread(fd, dest, size, static_cast<off_t>(offset));
+        if (n > 0) {
+            SDL_ASSERT(static_cast<size_t>(n) <= size);
+            dest += n;
+            offset += n;
+            size -= n;
+        }
+        else if ((n < 0) && (errno == EINTR)) {
+            continue;
+        }
+        else {
+            SDL_ASSERT(0);
+            throw_error_t<PagePoolFile_unix>("pread failed");
+        }
+    }
+}
+
+#endif // #if defined(SDL_OS_UNIX)
+
 }}} // sdl
\ No newline at end of file
@@ -10,9 +10,15 @@
 #include <windows.h>
 #endif
 #include <fstream>
+#include <mutex>
 
 namespace sdl { namespace db { namespace bpool {
 
+struct io_vec { // destination of vectored read
+    char * data;
+    size_t size;
+};
+
 #if defined(SDL_OS_WIN32)
 class PagePoolFile_win32 : noncopyable {
 public:
@@ -28,6 +34,7 @@ public:
        read(dest, 0, filesize());
     }
     void read(char * dest, size_t offset, size_t size);
+    void readv(io_vec const *, size_t count, size_t offset);
 private:
     size_t seek_beg(size_t offset);
     size_t seek_end();
@@ -39,23 +46,63 @@ private:
 
 #endif // SDL_OS_WIN32
 
-class PagePoolFile_s : noncopyable {
+#if defined(SDL_OS_UNIX)
+// direct mode bypasses OS page cache (O_DIRECT) for aligned reads, so page pool is the only cache;
+// unaligned reads and file systems without O_DIRECT support use buffered descriptor
+class PagePoolFile_unix : noncopyable { // thread safe, uses positional reads (pread)
 public:
-    explicit PagePoolFile_s(const std::string & fname);
+    enum { direct_align = 4096 }; // memory, offset and size alignment of O_DIRECT read
+    explicit PagePoolFile_unix(const std::string & fname, bool direct = false);
+    ~PagePoolFile_unix();
+    size_t filesize() const { 
+        return m_filesize;
+    }
+    bool is_open() const {
+       return m_fd != -1;
+    }
+    bool is_direct() const {
+       return m_direct_fd != -1;
+    }
+    void read_all(char * dest) const {
+       read(dest, 0, filesize());
+    }
+    void read(char * dest, size_t offset, size_t size) const;
+    void readv(io_vec const *, size_t count, size_t offset) const; // adjacent file ranges in one system call (preadv)
+    int read_fd(io_vec const *, size_t count, size_t offset) const; // descriptor used by readv
+    static bool is_aligned(char const * dest, size_t offset, size_t size);
+private:
+    void open_direct(const std::string & fname);
+    static void pread_all(int fd, char * dest, size_t offset, size_t size);
+    static void preadv_all(int fd, io_vec const *, size_t count, size_t offset);
+private:
+    size_t m_filesize = 0;
+    int m_fd = -1;
+    int m_direct_fd = -1; // O_DIRECT descriptor or -1
+};
+#endif // SDL_OS_UNIX
+
+class PagePoolFile_s : noncopyable { // thread safe, but reads are serialized
+public:
+    explicit PagePoolFile_s(const std::string & fname, bool direct = false); // direct mode is not supported
     size_t filesize() const { 
         return m_filesize;
     }
     bool is_open() const {
        return m_file.is_open();
     }
+    bool is_direct() const {
+       return false;
+    }
     void read_all(char * dest);
     void read(char * dest, size_t offset, size_t size);
+    void readv(io_vec const *, size_t count, size_t offset);
 private:
     size_t m_filesize = 0;
+    std::mutex m_mutex; // ifstream has shared file position
     std::ifstream m_file;
 };
 
-inline PagePoolFile_s::PagePoolFile_s(const std::string & fname)
+inline PagePoolFile_s::PagePoolFile_s(const std::string & fname, bool)
     : m_file(fname, std::ifstream::in | std::ifstream::binary) {
     if (m_file.is_open()) {
         m_file.seekg(0, std::ios_base::end);
@@ -66,6 +113,7 @@ inline PagePoolFile_s::PagePoolFile_s(const std::string & fname)
 
 inline void PagePoolFile_s::read_all(char * const dest){
     SDL_ASSERT(dest);
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_file.seekg(0, std::ios_base::beg);
     m_file.read(dest, filesize());
 }
@@ -74,12 +122,27 @@ inline void PagePoolFile_s::read(char * const dest, const size_t offset, const s
     SDL_ASSERT(dest);
     SDL_ASSERT(size && !(size % page_head::page_size));
     SDL_ASSERT(offset + size <= filesize());
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_file.seekg(offset, std::ios_base::beg);
     m_file.read(dest, size);
 }
 
+inline void PagePoolFile_s::readv(io_vec const * v, size_t const count, size_t offset) {
+    SDL_ASSERT(v && count);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_file.seekg(offset, std::ios_base::beg);
+    for (io_vec const * const last = v + count; v != last; ++v) {
+        SDL_ASSERT(v->data && v->size && !(v->size % page_head::page_size));
+        SDL_ASSERT(offset + v->size <= filesize());
+        m_file.read(v->data, v->size);
+        offset += v->size;
+    }
+}
+
 #if 0 // defined(SDL_OS_WIN32)
 using PagePoolFile = PagePoolFile_win32;
+#elif defined(SDL_OS_UNIX)
+using PagePoolFile = PagePoolFile_unix;
 #else
 using PagePoolFile = PagePoolFile_s; // faster ?
 #endif
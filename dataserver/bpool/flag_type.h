@@ -41,6 +41,17 @@ inline constexpr bool is_decommit(decommitf f) {
 
 //----------------------------------------------------------
 
+enum class accessf { normal, bulk_read }; // bulk_read pages cycle through small ring of blocks
+
+inline constexpr accessf make_accessf(bool b) {
+    return static_cast<accessf>(b);
+}
+inline constexpr bool is_bulk_read(accessf f) {
+    return accessf::normal != f;
+}
+
+//----------------------------------------------------------
+
 }}} // sdl
 
 #endif // __SDL_BPOOL_FLAG_TYPE_H__
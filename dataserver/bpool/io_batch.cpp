@@ -0,0 +1,147 @@
+// io_batch.cpp
+//
+#include "dataserver/bpool/io_batch.h"
+#include <algorithm>
+#include <chrono>
+
+namespace sdl { namespace db { namespace bpool {
+
+io_batch::io_batch(PagePoolFile & file, size_t const window_us)
+    : m_file(file)
+    , m_window(window_us)
+{
+    m_pending.reserve(max_run);
+}
+
+size_t io_batch::batch_count() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_batch_count;
+}
+
+size_t io_batch::merge_count() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_merge_count;
+}
+
+void io_batch::read(char * const dest, size_t const offset, size_t const size)
+{
+    SDL_ASSERT(dest && size);
+    request r(dest, offset, size);
+    unique_lock lock(m_mutex);
+    struct active_guard { // mutex is locked when destroyed
+        size_t & count;
+        explicit active_guard(size_t & c): count(c) { ++count; }
+        ~active_guard() { --count; }
+    } const guard(m_active);
+    m_pending.push_back(&r);
+    if (m_leader && batch_full()) {
+        m_full_cv.notify_one();
+    }
+    for (;;) {
+        switch (r.s) {
+        case state::pending:
+            if (!m_leader) { // this thread collects next batch
+                collect(lock);
+                continue;
+            }
+            break;
+        case state::run:
+            read_run(lock, &r);
+            return;
+        case state::done:
+            return;
+        case state::error:
+            throw_error_t<io_batch>("read failed");
+            return;
+        default:
+            break;
+        }
+        m_cv.wait(lock);
+    }
+}
+
+// batch is full or every reading thread has pending request
+bool io_batch::batch_full() const
+{
+    SDL_ASSERT(m_pending.size() <= m_active);
+    return m_pending.size() >= a_min(m_active, size_t(max_run));
+}
+
+// leader waits for misses of other reading threads (not longer than window),
+// then splits pending reads into runs of adjacent file ranges
+void io_batch::collect(unique_lock & lock)
+{
+    SDL_ASSERT(lock.owns_lock());
+    SDL_ASSERT(!m_leader && !m_pending.empty());
+    m_leader = true;
+    if (m_window && (m_active > 1)) { // single reading thread is not delayed
+        m_full_cv.wait_for(lock, std::chrono::microseconds(m_window), [this]{
+            return batch_full();
+        });
+    }
+    std::vector<request *> batch;
+    batch.swap(m_pending);
+    m_pending.reserve(max_run);
+    m_leader = false;
+    std::sort(batch.begin(), batch.end(), [](request const * x, request const * y){
+        return x->offset < y->offset;
+    });
+    request * head = nullptr;
+    request * tail = nullptr;
+    size_t run_size = 0;
+    for (request * const p : batch) {
+        SDL_ASSERT(p->s == state::pending);
+        if (tail && (tail->offset + tail->size == p->offset) && (run_size < max_run)) {
+            tail->next = p;
+            p->s = state::wait;
+            ++run_size;
+            ++m_merge_count;
+        }
+        else {
+            head = p;
+            head->s = state::run;
+            run_size = 1;
+        }
+        tail = p;
+    }
+    SDL_ASSERT(head);
+    if (batch.size() > 1) {
+        ++m_batch_count;
+    }
+    m_cv.notify_all(); // threads of runs start reading, next leader may collect new batch
+}
+
+void io_batch::read_run(unique_lock & lock, request * const head)
+{
+    SDL_ASSERT(lock.owns_lock());
+    SDL_ASSERT(head->s == state::run);
+    io_vec v[max_run];
+    size_t count = 0;
+    for (request * p = head; p; p = p->next) {
+        SDL_ASSERT(count < max_run);
+        v[count].data = p->dest;
+        v[count].size = p->size;
+        ++count;
+    }
+    lock.unlock();
+    bool ok = false;
+    try {
+        m_file.readv(v, count, head->offset);
+        ok = true;
+    }
+    catch (std::exception & e) {
+        SDL_TRACE("io_batch error = ", e.what());
+    }
+    lock.lock();
+    for (request * p = head; p; p = p->next) {
+        p->s = ok ? state::done : state::error;
+    }
+    m_cv.notify_all();
+    if (!ok) {
+        throw_error_t<io_batch>("read failed");
+    }
+}
+
+}}} // sdl
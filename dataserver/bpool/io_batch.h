@@ -0,0 +1,54 @@
+// io_batch.h
+//
+#pragma once
+#ifndef __SDL_BPOOL_IO_BATCH_H__
+#define __SDL_BPOOL_IO_BATCH_H__
+
+#include "dataserver/bpool/file.h"
+#include <condition_variable>
+
+namespace sdl { namespace db { namespace bpool {
+
+// collects concurrent file reads during short batching window;
+// pending reads are sorted by file offset and adjacent ones are merged into one readv (preadv);
+// each merged run is read by thread of its first request, so distinct runs are read in parallel
+class io_batch : noncopyable {
+public:
+    enum { max_run = 32 }; // max reads merged into one readv
+    io_batch(PagePoolFile &, size_t window_us);
+    size_t window() const { // batching window in microseconds
+        return m_window;
+    }
+    void read(char * dest, size_t offset, size_t size); // blocks until data is read, throws on error
+    size_t batch_count() const; // batches with more than one read
+    size_t merge_count() const; // reads done by readv of another thread
+private:
+    enum class state { pending, run, wait, done, error };
+    struct request {
+        char * const dest;
+        size_t const offset;
+        size_t const size;
+        request * next = nullptr; // adjacent request of the same run
+        state s = state::pending;
+        request(char * d, size_t o, size_t s): dest(d), offset(o), size(s) {}
+    };
+    using unique_lock = std::unique_lock<std::mutex>;
+    void collect(unique_lock &); // called by leader of batch
+    void read_run(unique_lock &, request *);
+    bool batch_full() const;
+private:
+    PagePoolFile & m_file;
+    size_t const m_window;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;      // request state changed
+    std::condition_variable m_full_cv; // batch is full
+    std::vector<request *> m_pending;
+    bool m_leader = false;     // batch is collected by one of pending threads
+    size_t m_active = 0;       // threads inside read()
+    size_t m_batch_count = 0;
+    size_t m_merge_count = 0;
+};
+
+}}} // sdl
+
+#endif // __SDL_BPOOL_IO_BATCH_H__
@@ -0,0 +1,509 @@
+// io_queue.cpp
+//
+#include "dataserver/bpool/io_queue.h"
+#include "dataserver/common/thread.h"
+#include <deque>
+
+#if defined(SDL_OS_UNIX) && defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#define SDL_BPOOL_IO_URING  1
+#endif
+#endif
+#if !defined(SDL_BPOOL_IO_URING)
+#define SDL_BPOOL_IO_URING  0
+#endif
+
+namespace sdl { namespace db { namespace bpool {
+
+io_queue::io_queue(PagePoolFile & file, size_t const depth, complete_fun && fun)
+    : m_file(file)
+    , m_depth(depth)
+    , m_complete(std::move(fun))
+{
+    SDL_ASSERT(m_depth);
+    SDL_ASSERT(m_complete);
+}
+
+void io_queue::begin_request()
+{
+    m_pending.fetch_add(1, std::memory_order_acq_rel);
+    m_submit.fetch_add(1, std::memory_order_relaxed);
+}
+
+void io_queue::complete(io_request const & r, bool const ok)
+{
+    try {
+        m_complete(r, ok);
+    }
+    catch (std::exception & e) {
+        SDL_TRACE("io_queue error = ", e.what());
+    }
+    SDL_ASSERT(pending());
+    if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> lock(m_wait_mutex);
+        m_wait_cv.notify_all();
+    }
+}
+
+void io_queue::wait()
+{
+    std::unique_lock<std::mutex> lock(m_wait_mutex);
+    m_wait_cv.wait(lock, [this]{
+        return !pending();
+    });
+}
+
+void io_queue::read_sync(io_request const & r)
+{
+    SDL_ASSERT(r.count && (r.count <= io_request::max_vec));
+    m_file.readv(r.v, r.count, r.offset);
+}
+
+//------------------------------------------------------
+
+namespace {
+
+// worker threads with positional reads; depth() is max number of queued requests
+class io_queue_thread final : public io_queue {
+public:
+    enum { max_thread = 16 };
+    io_queue_thread(PagePoolFile &, size_t depth, complete_fun &&);
+    ~io_queue_thread();
+    backend type() const override {
+        return backend::thread;
+    }
+    void submit(io_request const &) override;
+private:
+    void run_thread();
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;      // request is queued or shutdown
+    std::condition_variable m_free_cv; // queue is not full
+    std::deque<io_request> m_queue;
+    bool m_shutdown = false;
+    std::vector<unique_thread> m_thread;
+};
+
+io_queue_thread::io_queue_thread(PagePoolFile & file, size_t const depth, complete_fun && fun)
+    : io_queue(file, depth, std::move(fun))
+{
+    m_thread.resize(a_min(depth, size_t(max_thread)));
+    for (auto & t : m_thread) {
+        t.reset(new joinable_thread([this](){
+            this->run_thread();
+        }));
+    }
+}
+
+io_queue_thread::~io_queue_thread()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shutdown = true;
+    }
+    m_cv.notify_all();
+    m_thread.clear(); // join
+}
+
+void io_queue_thread::submit(io_request const & r)
+{
+    SDL_ASSERT(r.count && (r.count <= io_request::max_vec));
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_free_cv.wait(lock, [this]{
+            return m_queue.size() < depth();
+        });
+        begin_request();
+        m_queue.push_back(r);
+    }
+    m_cv.notify_one();
+}
+
+void io_queue_thread::run_thread()
+{
+    for (;;) {
+        io_request r;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]{
+                return m_shutdown || !m_queue.empty();
+            });
+            if (m_queue.empty()) { // shutdown
+                return;
+            }
+            r = m_queue.front();
+            m_queue.pop_front();
+        }
+        m_free_cv.notify_one();
+        bool ok = false;
+        try {
+            read_sync(r);
+            ok = true;
+        }
+        catch (std::exception & e) {
+            SDL_TRACE("io_queue read error = ", e.what());
+        }
+        complete(r, ok);
+    }
+}
+
+//------------------------------------------------------
+
+#if SDL_BPOOL_IO_URING
+
+#if defined(SYS_io_uring_setup)
+enum { sys_io_uring_setup = SYS_io_uring_setup };
+enum { sys_io_uring_enter = SYS_io_uring_enter };
+#else
+enum { sys_io_uring_setup = 425 };
+enum { sys_io_uring_enter = 426 };
+#endif
+
+int uring_setup(unsigned const entries, io_uring_params * const p) {
+    return static_cast<int>(::syscall(sys_io_uring_setup, entries, p));
+}
+
+int uring_enter(int const fd, unsigned const to_submit, unsigned const min_complete, unsigned const flags) {
+    return static_cast<int>(::syscall(sys_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+// one submission ring shared by submitting threads (under mutex),
+// completions are reaped by one thread of the queue;
+// if ring fails, in-flight requests are failed and next requests are read by worker threads
+class io_queue_uring final : public io_queue {
+public:
+    io_queue_uring(PagePoolFile &, size_t depth, complete_fun &&); // throws if io_uring is not available
+    ~io_queue_uring();
+    backend type() const override {
+        return m_failed ? backend::thread : backend::uring;
+    }
+    void submit(io_request const &) override;
+private:
+    enum : uint64 { shutdown_tag = uint64(-1) };
+    struct slot_t {
+        io_request req;
+        ::iovec iov[io_request::max_vec];
+    };
+    void setup();
+    void close();
+    void push_sqe(uint8 opcode, uint64 user_data, ::iovec const *, size_t count, int fd, size_t offset); // under m_mutex
+    void run_thread();
+    void complete_cqe(uint64 user_data, int res);
+    void fail_ring(int error); // called by reaping thread
+private:
+    int m_ring_fd = -1;
+    io_uring_params m_params;
+    void * m_sq_ptr = nullptr;
+    void * m_cq_ptr = nullptr;
+    size_t m_sq_size = 0;
+    size_t m_cq_size = 0;
+    io_uring_sqe * m_sqes = nullptr;
+    unsigned * m_sq_tail = nullptr;
+    unsigned * m_sq_mask = nullptr;
+    unsigned * m_sq_array = nullptr;
+    unsigned * m_cq_head = nullptr;
+    unsigned * m_cq_tail = nullptr;
+    unsigned * m_cq_mask = nullptr;
+    io_uring_cqe * m_cqes = nullptr;
+    std::mutex m_mutex;
+    std::condition_variable m_free_cv; // slot is released
+    std::vector<slot_t> m_slot;
+    std::vector<size_t> m_free; // indexes of free slots
+    std::unique_ptr<joinable_thread> m_thread;
+    std::unique_ptr<io_queue_thread> m_fallback; // created if ring fails
+    std::atomic<bool> m_failed{false};
+};
+
+io_queue_uring::io_queue_uring(PagePoolFile & file, size_t const depth, complete_fun && fun)
+    : io_queue(file, depth, std::move(fun))
+{
+    try {
+        setup();
+    }
+    catch (...) {
+        close();
+        throw;
+    }
+    m_slot.resize(depth);
+    m_free.reserve(depth);
+    for (size_t i = depth; i; --i) {
+        m_free.push_back(i - 1);
+    }
+    m_thread.reset(new joinable_thread([this](){
+        this->run_thread();
+    }));
+}
+
+io_queue_uring::~io_queue_uring()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_fallback) { // reaping thread is running
+            try {
+                push_sqe(IORING_OP_NOP, shutdown_tag, nullptr, 0, -1, 0); // wakes up reaping thread
+            }
+            catch (std::exception & e) { // reaping thread exits on failed io_uring_enter
+                SDL_TRACE("io_uring shutdown error = ", e.what());
+            }
+        }
+    }
+    m_thread.reset(); // join
+    m_fallback.reset();
+    close();
+}
+
+void io_queue_uring::setup()
+{
+    memset_zero(m_params);
+    m_ring_fd = uring_setup(static_cast<unsigned>(depth()), &m_params);
+    throw_error_if_t<io_queue_uring>(m_ring_fd < 0, "io_uring_setup failed");
+    io_uring_params const & p = m_params;
+    m_sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    m_cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        m_sq_size = m_cq_size = a_max(m_sq_size, m_cq_size);
+    }
+    m_sq_ptr = ::mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQ_RING);
+    if (m_sq_ptr == MAP_FAILED) {
+        m_sq_ptr = nullptr;
+        close();
+        throw_error_t<io_queue_uring>("mmap sq_ring failed");
+    }
+    if (single_mmap) {
+        m_cq_ptr = m_sq_ptr;
+    }
+    else {
+        m_cq_ptr = ::mmap(nullptr, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_CQ_RING);
+        if (m_cq_ptr == MAP_FAILED) {
+            m_cq_ptr = nullptr;
+            close();
+            throw_error_t<io_queue_uring>("mmap cq_ring failed");
+        }
+    }
+    void * const sqes = ::mmap(nullptr, p.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        close();
+        throw_error_t<io_queue_uring>("mmap sqes failed");
+    }
+    m_sqes = static_cast<io_uring_sqe *>(sqes);
+    char * const sq = static_cast<char *>(m_sq_ptr);
+    char * const cq = static_cast<char *>(m_cq_ptr);
+    m_sq_tail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+    m_sq_mask = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+    m_sq_array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+    m_cq_head = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+    m_cq_tail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+    m_cq_mask = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+    throw_error_if_t<io_queue_uring>(p.sq_entries < depth(), "io_uring entries");
+}
+
+void io_queue_uring::close()
+{
+    if (m_sqes) {
+        ::munmap(m_sqes, m_params.sq_entries * sizeof(io_uring_sqe));
+        m_sqes = nullptr;
+    }
+    if (m_cq_ptr && (m_cq_ptr != m_sq_ptr)) {
+        ::munmap(m_cq_ptr, m_cq_size);
+    }
+    m_cq_ptr = nullptr;
+    if (m_sq_ptr) {
+        ::munmap(m_sq_ptr, m_sq_size);
+        m_sq_ptr = nullptr;
+    }
+    if (m_ring_fd >= 0) {
+        ::close(m_ring_fd);
+        m_ring_fd = -1;
+    }
+}
+
+// number of in-flight requests is limited by free slots, so submission ring never overflows
+void io_queue_uring::push_sqe(uint8 const opcode, uint64 const user_data,
+                              ::iovec const * const iov, size_t const count,
+                              int const fd, size_t const offset)
+{
+    unsigned const tail = *m_sq_tail; // written only by this process
+    unsigned const index = tail & *m_sq_mask;
+    io_uring_sqe * const sqe = m_sqes + index;
+    memset_zero(*sqe);
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64>(iov);
+    sqe->len = static_cast<uint32>(count);
+    sqe->off = offset;
+    sqe->user_data = user_data;
+    m_sq_array[index] = index;
+    __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+    for (;;) {
+        const int n = uring_enter(m_ring_fd, 1, 0, 0);
+        if (n >= 0) {
+            break;
+        }
+        if ((errno != EINTR) && (errno != EAGAIN) && (errno != EBUSY)) {
+            SDL_ASSERT(0);
+            throw_error_t<io_queue_uring>("io_uring_enter failed");
+        }
+    }
+}
+
+void io_queue_uring::submit(io_request const & r)
+{
+    SDL_ASSERT(r.count && (r.count <= io_request::max_vec));
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_free_cv.wait(lock, [this]{
+        return !m_free.empty() || m_fallback;
+    });
+    if (m_fallback) {
+        begin_request(); // completed by callback of m_fallback
+        lock.unlock();
+        m_fallback->submit(r);
+        return;
+    }
+    const size_t i = m_free.back();
+    m_free.pop_back();
+    slot_t & s = m_slot[i];
+    s.req = r;
+    for (size_t j = 0; j < r.count; ++j) {
+        s.iov[j].iov_base = r.v[j].data;
+        s.iov[j].iov_len = r.v[j].size;
+    }
+    begin_request();
+    try {
+        push_sqe(IORING_OP_READV, i, s.iov, r.count, m_file.read_fd(r.v, r.count, r.offset), r.offset);
+    }
+    catch (...) {
+        io_request const failed = s.req;
+        m_free.push_back(i);
+        lock.unlock();
+        m_free_cv.notify_one();
+        complete(failed, false);
+        throw;
+    }
+}
+
+void io_queue_uring::run_thread()
+{
+    for (;;) {
+        unsigned const head = *m_cq_head; // written only by this thread
+        unsigned const tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            if ((uring_enter(m_ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0) && (errno != EINTR)) {
+                fail_ring(errno);
+                return;
+            }
+            continue;
+        }
+        io_uring_cqe const cqe = m_cqes[head & *m_cq_mask];
+        __atomic_store_n(m_cq_head, head + 1, __ATOMIC_RELEASE);
+        if (cqe.user_data == shutdown_tag) {
+            return;
+        }
+        complete_cqe(cqe.user_data, cqe.res);
+    }
+}
+
+void io_queue_uring::complete_cqe(uint64 const user_data, int const res)
+{
+    SDL_ASSERT(user_data < m_slot.size());
+    slot_t & s = m_slot[static_cast<size_t>(user_data)];
+    bool ok = (res >= 0) && (static_cast<size_t>(res) == s.req.size());
+    if (!ok) { // short read or error (e.g. O_DIRECT is rejected), request is read again synchronously
+        try {
+            read_sync(s.req);
+            ok = true;
+        }
+        catch (std::exception & e) {
+            SDL_TRACE("io_uring read error = ", e.what());
+        }
+    }
+    complete(s.req, ok);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_free.push_back(static_cast<size_t>(user_data));
+    }
+    m_free_cv.notify_one();
+}
+
+// completions can not be reaped, so requests in-flight are completed as failed
+// (owner of queue releases their blocks) and queue switches to worker threads
+void io_queue_uring::fail_ring(int const error)
+{
+    SDL_TRACE("io_uring_enter failed, errno = ", error);
+    SDL_ASSERT(!m_fallback);
+    std::vector<io_request> failed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_fallback.reset(new io_queue_thread(m_file, depth(), [this](io_request const & r, bool const ok){
+            this->complete(r, ok);
+        }));
+        m_failed = true;
+        std::vector<bool> is_free(m_slot.size());
+        for (size_t const i : m_free) {
+            is_free[i] = true;
+        }
+        for (size_t i = 0; i < m_slot.size(); ++i) {
+            if (!is_free[i]) {
+                failed.push_back(m_slot[i].req);
+                m_free.push_back(i);
+            }
+        }
+    }
+    m_free_cv.notify_all();
+    for (auto const & r : failed) {
+        complete(r, false);
+    }
+}
+
+#endif // SDL_BPOOL_IO_URING
+
+} // namespace
+
+bool io_queue::uring_supported()
+{
+#if SDL_BPOOL_IO_URING
+    static const bool result = [](){
+        io_uring_params p;
+        memset_zero(p);
+        const int fd = uring_setup(1, &p);
+        if (fd < 0) { // ENOSYS or EPERM (e.g. disabled by seccomp)
+            return false;
+        }
+        ::close(fd);
+        return true;
+    }();
+    return result;
+#else
+    return false;
+#endif
+}
+
+std::unique_ptr<io_queue>
+io_queue::make(PagePoolFile & file, backend const type, size_t const depth, complete_fun && fun)
+{
+    SDL_ASSERT(type != backend::sync);
+    SDL_ASSERT(depth);
+#if SDL_BPOOL_IO_URING
+    if ((type == backend::uring) && uring_supported()) {
+        try {
+            return std::make_unique<io_queue_uring>(file, depth, complete_fun(fun));
+        }
+        catch (std::exception & e) {
+            SDL_TRACE("io_uring is not used: ", e.what());
+        }
+    }
+#endif
+    return std::make_unique<io_queue_thread>(file, depth, std::move(fun));
+}
+
+}}} // sdl
@@ -0,0 +1,69 @@
+// io_queue.h
+//
+#pragma once
+#ifndef __SDL_BPOOL_IO_QUEUE_H__
+#define __SDL_BPOOL_IO_QUEUE_H__
+
+#include "dataserver/bpool/io_batch.h"
+#include "dataserver/system/database_cfg.h"
+#include <functional>
+#include <atomic>
+
+namespace sdl { namespace db { namespace bpool {
+
+struct io_request { // read of adjacent file ranges into separate buffers
+    enum { max_vec = io_batch::max_run };
+    size_t offset = 0;
+    size_t count = 0; // used elements of v
+    io_vec v[max_vec];
+    size_t tag = 0; // defined by owner of queue
+    std::atomic<size_t> * counter = nullptr; // optional, defined by owner of queue
+    size_t size() const {
+        size_t s = 0;
+        for (size_t i = 0; i < count; ++i) {
+            s += v[i].size;
+        }
+        return s;
+    }
+};
+
+// asynchronous reads of page pool file; many reads are in-flight at once,
+// each request is completed by callback from thread of the queue;
+// io_uring (system calls, liburing is not required) or worker threads with positional reads
+class io_queue : noncopyable {
+public:
+    using backend = database_cfg::io_backend;
+    using complete_fun = std::function<void(io_request const &, bool ok)>;
+    virtual ~io_queue() {}
+    virtual backend type() const = 0;
+    virtual void submit(io_request const &) = 0; // blocks while depth() requests are in-flight
+    size_t depth() const {
+        return m_depth;
+    }
+    size_t pending() const { // submitted but not completed
+        return m_pending.load(std::memory_order_acquire);
+    }
+    void wait(); // for completion of all submitted requests
+    size_t submit_count() const {
+        return m_submit.load(std::memory_order_relaxed);
+    }
+    static bool uring_supported();
+    static std::unique_ptr<io_queue> make(PagePoolFile &, backend, size_t depth, complete_fun &&); // uring falls back to thread
+protected:
+    io_queue(PagePoolFile &, size_t depth, complete_fun &&);
+    void begin_request(); // called by submit
+    void complete(io_request const &, bool ok); // called from thread of queue
+    void read_sync(io_request const &); // used after short or failed asynchronous read, throws on error
+    PagePoolFile & m_file;
+private:
+    size_t const m_depth;
+    complete_fun const m_complete;
+    std::atomic<size_t> m_pending{0};
+    std::atomic<size_t> m_submit{0};
+    std::mutex m_wait_mutex;
+    std::condition_variable m_wait_cv;
+};
+
+}}} // sdl
+
+#endif // __SDL_BPOOL_IO_QUEUE_H__
@@ -0,0 +1,76 @@
+// lock_page.h
+//
+#pragma once
+#ifndef __SDL_BPOOL_LOCK_PAGE_H__
+#define __SDL_BPOOL_LOCK_PAGE_H__
+
+#include "dataserver/system/page_head.h"
+
+namespace sdl { namespace db { namespace bpool {
+
+class page_bpool;
+
+// page pinned by this thread while handle exists (see page_bpool::pin_page);
+// pins are counted per thread, page is unlocked by the last handle
+// unless it was locked by this thread before the first pin;
+// note: handle must be used in the thread which pinned the page
+class lock_page_head {
+    friend page_bpool;
+    page_bpool * m_pool = nullptr; // nullptr if page is not unpinned by handle
+    page_head const * m_p = nullptr;
+    pageIndex::value_type m_id = 0; // valid if m_pool
+    lock_page_head(page_bpool * const pool, page_head const * const p, pageIndex const id) noexcept
+        : m_pool(p ? pool : nullptr), m_p(p), m_id(id.value()) {}
+public:
+    lock_page_head() = default;
+    explicit lock_page_head(page_head const * const p) noexcept // page is not unpinned (file mapping, fixed or zero block)
+        : m_p(p) {}
+    lock_page_head(lock_page_head && src) noexcept
+        : m_pool(src.m_pool), m_p(src.m_p), m_id(src.m_id) {
+        src.m_pool = nullptr;
+        src.m_p = nullptr;
+    }
+    lock_page_head(lock_page_head const &); // pins page once more, see page_bpool.cpp
+    ~lock_page_head() {
+        if (m_pool) {
+            unpin();
+        }
+    }
+    void swap(lock_page_head & src) noexcept {
+        std::swap(m_pool, src.m_pool);
+        std::swap(m_p, src.m_p);
+        std::swap(m_id, src.m_id);
+    }
+    lock_page_head & operator = (lock_page_head src) noexcept {
+        src.swap(*this);
+        return *this;
+    }
+    page_head const * get() const {
+        return m_p;
+    }
+    page_head const * operator->() const {
+        SDL_ASSERT(m_p);
+        return m_p;
+    }
+    explicit operator bool() const {
+        return m_p != nullptr;
+    }
+    bool is_pinned() const {
+        return m_pool != nullptr;
+    }
+    void reset() {
+        lock_page_head().swap(*this);
+    }
+    bool operator == (lock_page_head const & src) const {
+        return m_p == src.m_p;
+    }
+    bool operator != (lock_page_head const & src) const {
+        return m_p != src.m_p;
+    }
+private:
+    void unpin() noexcept; // see page_bpool.cpp
+};
+
+}}} // sdl
+
+#endif // __SDL_BPOOL_LOCK_PAGE_H__
@@ -0,0 +1,126 @@
+// numa.cpp
+//
+#include "dataserver/bpool/numa.h"
+
+#if defined(SDL_OS_UNIX) && defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#define SDL_BPOOL_NUMA_SYSCALL  1
+#else
+#define SDL_BPOOL_NUMA_SYSCALL  0
+#endif
+
+namespace sdl { namespace db { namespace bpool {
+
+#if SDL_BPOOL_NUMA_SYSCALL
+namespace {
+
+enum { MPOL_PREFERRED_ = 1 }; // see <linux/mempolicy.h>
+enum { MPOL_F_NODE_ = 1 << 0 };
+enum { MPOL_F_ADDR_ = 1 << 1 };
+enum { MPOL_F_MEMS_ALLOWED_ = 1 << 2 };
+
+using nodemask_t = unsigned long;
+static_assert(sizeof(nodemask_t) * 8 == numa::max_node, "");
+
+size_t sys_node_count() {
+    nodemask_t mask = 0;
+    int mode = 0;
+    if (::syscall(SYS_get_mempolicy, &mode, &mask, numa::max_node, nullptr, MPOL_F_MEMS_ALLOWED_)) {
+        return 1; // no NUMA support
+    }
+    size_t count = 0; // max allowed node + 1
+    for (size_t i = 0; i < numa::max_node; ++i) {
+        if (mask & (nodemask_t(1) << i)) {
+            count = i + 1;
+        }
+    }
+    return count ? count : 1;
+}
+
+} // namespace
+#endif // SDL_BPOOL_NUMA_SYSCALL
+
+size_t numa::node_count()
+{
+#if SDL_BPOOL_NUMA_SYSCALL
+    static const size_t count = sys_node_count();
+    return count;
+#else
+    return 1;
+#endif
+}
+
+size_t numa::current_node()
+{
+#if SDL_BPOOL_NUMA_SYSCALL
+    unsigned cpu = 0, node = 0;
+    if (!::syscall(SYS_getcpu, &cpu, &node, nullptr)) {
+        if (node < node_count()) {
+            return node;
+        }
+    }
+#endif
+    return 0;
+}
+
+bool numa::bind(void * const p, size_t const size, size_t const node)
+{
+    SDL_ASSERT(p && size);
+    if (node >= node_count()) {
+        return false;
+    }
+#if SDL_BPOOL_NUMA_SYSCALL
+    const nodemask_t mask = nodemask_t(1) << node;
+    return !::syscall(SYS_mbind, p, size, MPOL_PREFERRED_, &mask, numa::max_node + 1, 0);
+#else
+    return false;
+#endif
+}
+
+size_t numa::address_node(void const * const p)
+{
+    SDL_ASSERT(p);
+#if SDL_BPOOL_NUMA_SYSCALL
+    int node = -1;
+    if (!::syscall(SYS_get_mempolicy, &node, nullptr, 0, p, MPOL_F_NODE_ | MPOL_F_ADDR_)) {
+        if ((node >= 0) && (node < max_node)) {
+            return static_cast<size_t>(node);
+        }
+    }
+#endif
+    return max_node;
+}
+
+#if SDL_DEBUG
+namespace {
+class unit_test {
+public:
+    unit_test() {
+        const size_t count = numa::node_count();
+        SDL_ASSERT(count && (count <= numa::max_node));
+        SDL_ASSERT(numa::current_node() < count);
+#if SDL_BPOOL_NUMA_SYSCALL
+        enum { size = 1 << 16 };
+        void * const p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED) {
+            SDL_ASSERT(!numa::bind(p, size, count)); // no such node
+            const bool bound = numa::bind(p, size, count - 1);
+            memset(p, 1, size);
+            const size_t node = numa::address_node(p);
+            SDL_ASSERT((node == numa::max_node) || (node < count));
+            SDL_ASSERT(!bound || (1 < count) || (node == 0) || (node == numa::max_node));
+            ::munmap(p, size);
+        }
+#endif
+        SDL_TRACE("numa::node_count = ", count);
+    }
+};
+static unit_test s_test;
+}
+#endif // SDL_DEBUG
+
+}}} // sdl
+
+#undef SDL_BPOOL_NUMA_SYSCALL
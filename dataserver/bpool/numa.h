@@ -0,0 +1,23 @@
+// numa.h
+//
+#pragma once
+#ifndef __SDL_BPOOL_NUMA_H__
+#define __SDL_BPOOL_NUMA_H__
+
+#include "dataserver/common/common.h"
+
+namespace sdl { namespace db { namespace bpool {
+
+// NUMA memory policy with system calls (libnuma is not required);
+// one node is reported if kernel or platform has no NUMA support
+struct numa final : is_static {
+    enum { max_node = 64 };
+    static size_t node_count(); // nodes allowed for process, (max allowed node + 1)
+    static size_t current_node(); // node of CPU which runs calling thread
+    static bool bind(void *, size_t, size_t node); // preferred node of memory range, call before first touch
+    static size_t address_node(void const *); // node of touched memory page or max_node if unknown
+};
+
+}}} // sdl
+
+#endif // __SDL_BPOOL_NUMA_H__
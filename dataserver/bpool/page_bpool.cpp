@@ -1,28 +1,12 @@
 // page_bpool.cpp
 //
 #include "dataserver/bpool/page_bpool.h"
+#include "dataserver/bpool/pressure.h"
 
 namespace sdl { namespace db { namespace bpool {
 
-pool_info_t::pool_info_t(const size_t s)
-    : filesize(s)
-    , page_count(s / T::page_size)
-    , block_count((s + T::block_size - 1) / T::block_size)
-{
-    SDL_ASSERT(filesize > T::block_size);
-    SDL_ASSERT(!(filesize % T::page_size));
-    static_assert(is_power_two(T::block_page_num), "");
-    const size_t n = page_count % T::block_page_num;
-    last_block = block_count - 1;
-    last_block_page_count = n ? n : T::block_page_num;
-    last_block_size = T::page_size * last_block_page_count;
-    SDL_ASSERT((last_block_size >= T::page_size) && (last_block_size <= T::block_size));
-}
-
-//---------------------------------------------------
-
-page_bpool_file::page_bpool_file(const std::string & fname)
-    : m_file(fname) 
+page_bpool_file::page_bpool_file(const std::string & fname, bool const direct)
+    : m_file(fname, direct) 
 {
     throw_error_if_not_t<base_page_bpool>(m_file.is_open() && m_file.filesize(), "bad file");
     throw_error_if_not_t<base_page_bpool>(valid_filesize(m_file.filesize()), "bad filesize");
@@ -41,27 +25,29 @@ bool page_bpool_file::valid_filesize(const size_t filesize) {
 }
 
 //------------------------------------------------------
-#if 0
-lock_page_head::~lock_page_head() {
-    if (m_p && !page_bpool::is_zero_block(m_p->pageId())) { // page in memory and locked
-        block_head const * const h = block_head::get_block_head(m_p);
-        if (h->bpool && !h->is_fixed()) { // bpool can be nullptr if block is fixed in memory
-            const_cast<page_bpool *>(h->bpool)->unlock_page(m_p->pageId());
-        }
+lock_page_head::lock_page_head(lock_page_head const & src)
+    : m_pool(src.m_pool), m_p(src.m_p), m_id(src.m_id)
+{
+    if (m_pool && !m_pool->repin_page(pageIndex(m_id))) { // pins of this thread were removed by unlock_thread
+        m_pool = nullptr;
     }
 }
-#endif
-//------------------------------------------------------
 
-block_head *
-page_bpool_friend::first_block_head(block32 const blockId) const {
-    return m_p->first_block_head(blockId);
+void lock_page_head::unpin() noexcept {
+    SDL_ASSERT(m_pool && m_p);
+    try {
+        m_pool->unpin_page(pageIndex(m_id));
+    }
+    catch (std::exception & e) {
+        SDL_TRACE("unpin_page error = ", e.what());
+        SDL_ASSERT(0);
+    }
+    m_pool = nullptr;
 }
-
 //------------------------------------------------------
 
 base_page_bpool::base_page_bpool(const std::string & fname, database_cfg const & cfg)
-    : page_bpool_file(fname)
+    : page_bpool_file(fname, cfg.pool_direct)
     , info(filesize())
 {
     SDL_ASSERT(cfg.min_memory <= cfg.max_memory);
@@ -80,212 +66,155 @@ page_bpool::page_bpool(const std::string & fname, database_cfg const & cfg)
     : base_page_bpool(fname, cfg)
     , init_thread_id(std::this_thread::get_id())
     , m_block(info.block_count)
+    , m_budget(min_pool_size(), max_pool_size())
+    , m_quota(info.block_count)
+    , m_group(cfg.pool_group)
+    , m_shard_mask(shard_count(cfg, info) - 1)
     , m_thread_id(info.filesize)
-    , m_alloc(info.filesize)
-    , m_lock_block_list(this, "lock")
-    , m_unlock_block_list(this, "unlock")
-    , m_free_block_list(this, "free")
-    , m_fixed_block_list(this, "fixed")
+    , m_page_read(cfg.pool_page_read)
+    , m_defrag_slice(a_max(cfg.pool_defrag_slice, size_t(1)))
+    , m_target_max(max_pool_size())
+    , m_pressure_path(cfg.pool_pressure)
+    , m_pressure_limit(static_cast<double>(a_max(cfg.pool_pressure_limit, size_t(1))))
     , m_td(this, cfg)
+    , m_warm_path(fname + ".warm")
+    , m_warmup(cfg.pool_warm)
 {
     SDL_TRACE_FUNCTION;
+    const size_t count = m_shard_mask + 1;
+    m_shard.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        reset_new(m_shard[i], info, m_budget, m_block, m_quota, i, count, cfg);
+    }
+    if (m_group.get()) {
+        m_group.attach(this, fname, a_max(cfg.pool_weight, size_t(1)));
+    }
     throw_error_if_not_t<page_bpool>(is_open(), "page_bpool");
+    if (cfg.pool_io_batch) {
+        reset_new(m_io, m_file, cfg.pool_io_batch);
+    }
     load_zero_block();
+    if (cfg.pool_io != database_cfg::io_backend::sync) {
+        m_aio = io_queue::make(m_file, cfg.pool_io, a_max(cfg.pool_io_depth, size_t(1)),
+            [this](io_request const & r, bool const ok){
+                complete_prefetch(r, ok);
+            });
+    }
     m_td.launch();
+    if (block32 const window = readahead_size(cfg, max_pool_size())) {
+        reset_new(m_ra, this, window);
+        m_ra->launch();
+    }
+    if (m_warmup != database_cfg::warmup::none) {
+        load_warm();
+    }
 }
 
 page_bpool::~page_bpool()
 {
+    if (m_warmup != database_cfg::warmup::none) {
+        m_warm.reset(); // stop restore
+        try {
+            save_warm();
+        }
+        catch (std::exception & e) {
+            SDL_TRACE("save_warm error = ", e.what());
+        }
+    }
+}
+
+size_t page_bpool::shard_count(database_cfg const & cfg, pool_info_t const & info)
+{
+    size_t count = cfg.pool_shards ? cfg.pool_shards : std::thread::hardware_concurrency();
+    count = a_min_max(count, size_t(1), size_t(max_shard));
+    while (count > info.block_count) {
+        count >>= 1;
+    }
+    size_t result = 1;
+    while ((result << 1) <= count) { // round down to power of two
+        result <<= 1;
+    }
+    SDL_ASSERT(is_power_two(result));
+    SDL_ASSERT(result && (result <= info.block_count));
+    return result;
+}
+
+page_bpool::block32
+page_bpool::readahead_size(database_cfg const & cfg, size_t const max_pool_size)
+{
+    const size_t max_block = max_pool_size / pool_limits::block_size / 4; // don't evict blocks in use
+    return static_cast<block32>(a_min(cfg.pool_readahead, max_block));
 }
 
 void page_bpool::load_zero_block()
 {
     SDL_ASSERT(is_init_thread(std::this_thread::get_id()));
     SDL_ASSERT(!m_block.empty());
-    m_zero_block_address = m_alloc.alloc_block();
+    {
+        page_bpool_shard & shard = get_shard(0);
+        lock_guard lock(shard.mutex());
+        m_zero_block_address = shard.alloc_block();
+    }
     throw_error_if_t<page_bpool>(!m_zero_block_address, "bad alloc");
-    m_file.read(m_zero_block_address, 0, info.block_size_in_bytes(0));
+    read_block_from_file(m_zero_block_address, 0);
     m_block[0].set_lock_page_all();
-    get_block_head(m_zero_block_address, 0)->set_zero_fixed();
+    page_bpool_shard::get_block_head(m_zero_block_address, 0)->set_zero_fixed();
 }
 
-#if SDL_DEBUG
-void page_bpool::trace_block(const char * const title, block32 const blockId, pageIndex const pageId) {
-    if (trace_enable) {
-        SDL_TRACE(title, "[",page_bpool::realBlock(pageId),"],",blockId,",", pageId,",",page_bit(pageId),
-            " L ", m_lock_block_list.head(),
-            " U ", m_unlock_block_list.head(),
-            " F ", m_free_block_list.head());
+warm_header page_bpool::make_warm_header()
+{
+    SDL_ASSERT(m_zero_block_address);
+    page_head const * const fileheader = reinterpret_cast<page_head const *>(m_zero_block_address);
+    if (info.page_count <= warm_file::boot_page) {
+        return warm_file::make_header(info.filesize, fileheader, nullptr);
     }
+    std::vector<char> boot(pool_limits::page_size);
+    m_file.read(boot.data(), warm_file::boot_page * pool_limits::page_size, pool_limits::page_size);
+    return warm_file::make_header(info.filesize, fileheader, reinterpret_cast<page_head const *>(boot.data()));
 }
-#endif
 
-page_head const *
-page_bpool::lock_block_init(block32 const blockId,
-                            pageIndex const pageId,
-                            threadId_mask const * const threadId,
-                            thread_id const this_thread,
-                            fixedf const page_fixed)
-{
-    SDL_ASSERT(blockId);
-    SDL_ASSERT(this_thread == std::this_thread::get_id());
-    SDL_ASSERT((threadId == nullptr) == is_init_thread(this_thread)); 
-    char * const block_adr = m_alloc.get_block(blockId);
-    char * const page_adr = block_adr + page_head::page_size * page_bit(pageId);
-    page_head * const page = reinterpret_cast<page_head *>(page_adr);
-    block_head * const first = first_block_head(block_adr);
-    { // clear/init block_head for all pages
-        first->set_zero();
-        for (size_t i = 1, end = info.block_page_count(pageId); i < end; ++i) {
-            get_block_head(block_adr, i)->set_zero();
-        }
-    }
-    SDL_DEBUG_CPP(first->d_blockId = blockId);
-    first->realBlock = page_bpool::realBlock(pageId);
-    SDL_ASSERT(first->realBlock);
-    if (!threadId || is_fixed(page_fixed)) {
-        first->set_fixed();
-        m_fixed_block_list.insert(first, blockId);
+void page_bpool::load_warm()
+{
+    SDL_ASSERT(!m_warm);
+    warm_file::vector_block data;
+    if (!warm_file::load(m_warm_path, make_warm_header(), data)) {
+        return;
     }
-    else {
-        SDL_ASSERT(threadId->first.value() < pool_limits::max_thread);
-        SDL_ASSERT(threadId->second);
-        block_head * const head = block_head::get_block_head(page);
-        head->set_lock_thread(threadId->first.value());
-        m_lock_block_list.insert(first, blockId);
-        threadId->second->set_block(first->realBlock); // skip it for fixed block
+    const size_t max_block = max_pool_size() / pool_limits::block_size;
+    warm_file::vector_block32 list = warm_file::select(std::move(data),
+        max_block - max_block / 4, // leave room for blocks in use
+        info.last_block);
+    SDL_TRACE("load_warm = ", list.size());
+    if (list.empty()) {
+        return;
+    }
+    reset_new(m_warm, this, std::move(list));
+    m_warm->launch(m_aio ? 1 : // one thread submits asynchronous reads
+        a_min_max(size_t(std::thread::hardware_concurrency()), size_t(1), size_t(warm_thread_count)));
+    if (m_warmup == database_cfg::warmup::wait) {
+        m_warm->wait();
     }
-    return page;
 }
 
-page_head const *
-page_bpool::lock_block_head(block32 const blockId,
-                            pageIndex const pageId,
-                            threadId_mask const * const threadId,
-                            thread_id const this_thread,
-                            fixedf const page_fixed,
-                            uint8 const oldLock)
-{
-    SDL_ASSERT(blockId);
-    SDL_ASSERT(this_thread == std::this_thread::get_id());
-    SDL_ASSERT((threadId == nullptr) == is_init_thread(this_thread)); 
-    char * const block_adr = m_alloc.get_block(blockId);
-    char * const page_adr = block_adr + page_head::page_size * page_bit(pageId);
-    page_head * const page = reinterpret_cast<page_head *>(page_adr);
-    block_head * const first = first_block_head(block_adr);
-    SDL_ASSERT(first->d_blockId == blockId);
-    SDL_ASSERT(first->realBlock == page_bpool::realBlock(pageId));
-    if (threadId) {
-        block_head * const head = block_head::get_block_head(page); // clear/init before first use
-        head->set_lock_thread(threadId->first.value());
-    }
-    if (first->is_fixed()) {
-        SDL_ASSERT(m_fixed_block_list.find_block(blockId));
-        return page;
-    }
-    if (!threadId || is_fixed(page_fixed)) {
-        first->set_fixed();
-        if (oldLock) { // was already locked
-            m_lock_block_list.remove(first, blockId);
-        }
-        else { // was unlocked
-            m_unlock_block_list.remove(first, blockId);
-        }
-        m_fixed_block_list.insert(first, blockId);
-    }
-    else {
-        SDL_ASSERT(threadId->first.value() < pool_limits::max_thread);
-        SDL_ASSERT(threadId->second);
-        if (oldLock) { // was already locked
-            SDL_ASSERT_DEBUG_2(m_lock_block_list.find_block(blockId));
-            m_lock_block_list.promote(first, blockId);
-        }
-        else { // was unlocked
-            SDL_ASSERT_DEBUG_2(m_unlock_block_list.find_block(blockId));
-            m_unlock_block_list.remove(first, blockId);
-            m_lock_block_list.insert(first, blockId);
-        }
-        threadId->second->set_block(first->realBlock); // skip it for fixed block
-    }
-    return page;
-}
-
-page_bpool::unlock_result
-page_bpool::unlock_block_head(block_index & bi,
-                              block32 const blockId,
-                              pageIndex const pageId, 
-                              threadIndex const threadId)
-{
-    SDL_ASSERT(blockId);
-    SDL_ASSERT(bi.pageLock());
-    SDL_ASSERT(!is_init_thread(std::this_thread::get_id())); 
-    SDL_ASSERT(threadId.value() < pool_limits::max_thread);
-    char * const block_adr = m_alloc.get_block(blockId);
-    char * const page_adr = block_adr + page_head::page_size * page_bit(pageId);
-    page_head * const page = reinterpret_cast<page_head *>(page_adr); 
-    block_head * const head = block_head::get_block_head(page);
-    block_head * const first = first_block_head(block_adr);
-    if (!head->clr_lock_thread(threadId.value())) { // no more locks for this page
-        if (bi.clr_lock_page(page_bit(pageId))) {
-            SDL_ASSERT(!bi.is_lock_page(page_bit(pageId))); // this page unlocked
-            return unlock_result::false_; // other page(s) are still locked 
-        }
-        SDL_ASSERT(!head->pageLockThread);
-        if (first->is_fixed()) {
-            SDL_ASSERT(m_fixed_block_list.find_block(blockId)); 
-            SDL_ASSERT(!first->pageLockThread);
-            SDL_ASSERT(!head->pageLockThread);
-            return unlock_result::fixed_;
-        }
-        m_lock_block_list.remove(first, blockId);
-        m_unlock_block_list.insert(first, blockId);
-        return unlock_result::true_;
-    }
-    return unlock_result::false_;
-}
-
-bool page_bpool::can_alloc_block()
-{
-    SDL_ASSERT(m_alloc.capacity() >= info.filesize);
-    if (max_pool_size() < info.filesize) {
-        if (m_free_block_list) {
-            return true;
-        }
-        const size_t current = m_alloc.used_size();
-        if (current >= max_pool_size()) {
-            if (free_unlock_blocks(free_pool_block(current))) {
-                SDL_ASSERT(m_free_block_list);
-                return true;
-            }
-            SDL_WARNING_DEBUG_2(!"low on memory");
-        }
-        if (m_alloc.can_alloc(pool_limits::block_size)) {
-            return true;
-        }
-        SDL_ASSERT_DEBUG_2(!"can_alloc_block");
-        return false;
-    }
-    SDL_ASSERT(m_alloc.can_alloc(pool_limits::block_size));
-    return true;
+bool page_bpool::save_warm(std::string const & path)
+{
+    warm_file::vector_block data;
+    for_each_shard([&data](page_bpool_shard const & shard){
+        shard.warm_blocks(data);
+    });
+    return warm_file::save(path, make_warm_header(), data);
 }
 
-char * page_bpool::alloc_block()
+size_t page_bpool::warm_count() const
 {
-    if (can_alloc_block()) {
-        if (m_free_block_list) { // must reuse free block (memory already allocated)
-            const auto p = m_free_block_list.pop_head();
-            SDL_ASSERT(p.first && p.second);
-            SDL_ASSERT(p.first->d_blockId == p.second);
-            A_STATIC_CHECK_TYPE(block_head *, p.first);
-            p.first->set_zero(); // prepare block to reuse
-            page_head * const page_adr = block_head::get_page_head(p.first);
-            SDL_ASSERT(m_alloc.get_block(p.second) == reinterpret_cast<char *>(page_adr));
-            return reinterpret_cast<char *>(page_adr);
-        }
-        return m_alloc.alloc_block();
+    return m_warm ? m_warm->count() : 0;
+}
+
+void page_bpool::wait_warm()
+{
+    if (m_warm) {
+        m_warm->wait();
     }
-    SDL_ASSERT(!"bad alloc");
-    return nullptr;
 }
 
 bool page_bpool::page_is_locked(pageIndex const pageId) const
@@ -299,13 +228,14 @@ bool page_bpool::page_is_locked(pageIndex const pageId) const
         SDL_ASSERT(0);
         return false;
     }
-    lock_guard lock(m_mutex); // should be improved
-    block_index const & bi = m_block[real_blockId];
+    page_bpool_shard const & shard = get_shard(real_blockId);
+    lock_guard lock(shard.mutex());
+    block_index const bi = m_block[real_blockId].load();
     if (bi.blockId()) { // block is loaded
         if (bi.pageLock()) {
             return true;
         }
-        if (first_block_head(bi.blockId())->is_fixed()) {
+        if (shard.first_block_head(bi.blockId())->is_fixed()) {
             return true;
         }
     }
@@ -323,10 +253,11 @@ bool page_bpool::page_is_fixed(pageIndex const pageId) const
         SDL_ASSERT(0);
         return false;
     }
-    lock_guard lock(m_mutex); // should be improved
-    block_index const & bi = m_block[real_blockId];
+    page_bpool_shard const & shard = get_shard(real_blockId);
+    lock_guard lock(shard.mutex());
+    block_index const bi = m_block[real_blockId].load();
     if (bi.blockId()) { // block is loaded
-        if (first_block_head(bi.blockId())->is_fixed()) {
+        if (shard.first_block_head(bi.blockId())->is_fixed()) {
             return true;
         }
     }
@@ -334,13 +265,13 @@ bool page_bpool::page_is_fixed(pageIndex const pageId) const
 }
 
 page_head const *
-page_bpool::lock_page_fixed(pageIndex const pageId, fixedf const page_fixed)
+page_bpool::lock_page_fixed(pageIndex const pageId, fixedf const page_fixed, accessf const access)
 {
     const uint32 real_blockId = page_bpool::realBlock(pageId);
     if (!real_blockId) { // zero block must be always in memory
         page_head const * const page = zero_block_page(pageId);
         SDL_ASSERT(page->valid_checksum());
-        SDL_ASSERT(!get_block_head(real_blockId, pageId)->pageLockThread);
+        SDL_ASSERT(!block_head::get_block_head(page)->lock_count());
         return page;
     }
     SDL_ASSERT(real_blockId < m_block.size());
@@ -348,52 +279,415 @@ page_bpool::lock_page_fixed(pageIndex const pageId, fixedf const page_fixed)
         throw_error_t<block_index>("page not found");
         return nullptr;
     }
+    const bool sequential = (m_ra || m_page_read) && read_ahead(real_blockId);
+    const bool bulk_read = is_bulk_read(access) && !is_fixed(page_fixed);
     const auto this_thread = std::this_thread::get_id();
-    const bool is_init = is_init_thread(this_thread);
-    lock_guard lock(m_mutex); // should be improved
-    thread_id_t::pos_mask const thread_index(is_init ? thread_id_t::pos_mask{} :
-        m_thread_id.insert(this_thread));
-    block_index & bi = m_block[real_blockId];
-    if (bi.blockId()) { // block is loaded
-        if (page_head const * const page = lock_block_head(bi.blockId(), pageId, 
-            is_init ? nullptr : &thread_index,
-            this_thread, page_fixed, bi.set_lock_page(page_bit(pageId)))) {
+    thread_mask_t * const thread_mask = is_init_thread(this_thread) ? nullptr :
+        m_thread_id.insert(this_thread);
+    page_bpool_shard & shard = get_shard(real_blockId);
+    atomic_block_index & bi = m_block[real_blockId];
+    if (thread_mask && !is_fixed(page_fixed)) { // try lock-free hit
+        if (page_head const * const page = shard.lock_page_fast(bi, pageId, *thread_mask)) {
             SDL_ASSERT_DEBUG_2(page->valid_checksum());
-            SDL_ASSERT(bi.pageLock());
-            SDL_DEBUG_CPP(block_head const * const first = first_block_head(bi.blockId()));
-            SDL_DEBUG_CPP(block_head const * const test = get_block_head(bi.blockId(), pageId));
-            SDL_ASSERT(first->realBlock == real_blockId);
-            SDL_ASSERT(first->fixedBlock || test->is_lock_thread(thread_index.first.value()));
-            SDL_ASSERT(first->fixedBlock || thread_index.second->is_block(real_blockId));
+            if (bulk_read) {
+                ring_push(real_blockId, thread_mask);
+            }
             return page;
         }
     }
-    else { // block is NOT loaded
-        if (char * const block_adr = alloc_block()) {
-            read_block_from_file(block_adr, real_blockId);
-            block32 const allocId = m_alloc.get_block_id(block_adr);
-            SDL_ASSERT(m_alloc.get_block(allocId) == block_adr);
-            bi.set_blockId(allocId);
-            bi.set_lock_page(page_bit(pageId));
-            if (page_head const * const page = lock_block_init(allocId, pageId,
-                is_init ? nullptr : &thread_index,
-                this_thread, page_fixed)) {
-                SDL_ASSERT_DEBUG_2(page->valid_checksum());
-                SDL_ASSERT(bi.pageLock());
-                SDL_DEBUG_CPP(block_head const * const first = first_block_head(bi.blockId()));
-                SDL_DEBUG_CPP(block_head const * const test = get_block_head(bi.blockId(), pageId));
-                SDL_ASSERT(first->realBlock == real_blockId);
-                SDL_ASSERT(first->fixedBlock || thread_index.second->is_block(real_blockId));
-                SDL_ASSERT(first->fixedBlock || test->is_lock_thread(thread_index.first.value()));
-                return page;
+    // random miss reads only one page, sequential or bulk access reads whole block
+    const bool page_read = m_page_read && thread_mask && !is_fixed(page_fixed) && !bulk_read && !sequential;
+    uint8 const page_mask = static_cast<uint8>(1 << page_bit(pageId));
+    page_head const * page = nullptr;
+    {
+        unique_lock lock(shard.mutex());
+        uint8 read_pages = 0; // pages of partial block read into page buffer of this thread
+        for (;;) {
+            while (bi.is_loading()) { // block is read by another thread
+                shard.wait_load(lock);
+            }
+            if (!bi.blockId()) {
+                break;
+            }
+            bool filled = false;
+            if (bi.is_partial() && !(shard.loaded_pages(bi.blockId()) & page_mask)) { // page is not read from file
+                if (!(read_pages & page_mask)) {
+                    read_pages = read_pages_unlocked(lock, page_buffer(), pageId, page_read);
+                    continue; // block may be evicted or page loaded by another thread
+                }
+                if (shard.fill_block_pages(bi.blockId(), page_buffer(), read_pages)) {
+                    bi.clr_partial(); // all pages are visible for lock-free hits
+                }
+                filled = true;
             }
+            page = shard.lock_block_head(bi.blockId(), pageId, 
+                thread_mask, page_fixed, bi.set_lock_page(page_bit(pageId)), access);
+            if (filled) {
+                shard.update_priority(bi.blockId());
+            }
+            break;
         }
+        if (!page) { // block is NOT loaded
+            SDL_ASSERT(!bi.blockId() && !bi.is_loading());
+            if (char * const block_adr = shard.alloc_block()) {
+                block32 const allocId = read_block_unlocked(lock, shard, bi, block_adr, real_blockId,
+                    page_read ? &pageId : nullptr);
+                page = shard.lock_block_init(allocId, pageId, thread_mask, page_fixed, access, page_read);
+                SDL_ASSERT(page);
+                if (page_read) { // visible for lock-free hits after block_head(s) init
+                    bi.publish_partial(allocId, page_bit(pageId));
+                }
+                else {
+                    bi.publish(allocId, page_bit(pageId));
+                }
+                shard.end_load();
+            }
+        }
+        if (page) {
+            SDL_ASSERT_DEBUG_2(page->valid_checksum());
+            SDL_ASSERT(bi.pageLock());
+            SDL_DEBUG_CPP(block_head const * const first = shard.first_block_head(bi.blockId()));
+            SDL_ASSERT(first->realBlock == real_blockId);
+            SDL_ASSERT(first->loaded & page_mask);
+            SDL_ASSERT(first->fixedBlock || thread_mask->is_page(real_blockId, page_bit(pageId)));
+        }
+    }
+    if (page) {
+        if (bulk_read) { // shard mutex is unlocked
+            ring_push(real_blockId, thread_mask);
+        }
+        return page;
     }
     SDL_ASSERT(0);
     throw_error_t<block_index>("bad alloc");
     return nullptr;
 }
 
+page_bpool::block32
+page_bpool::read_block_unlocked(unique_lock & lock,
+                                page_bpool_shard & shard,
+                                atomic_block_index & bi,
+                                char * const block_adr,
+                                size_t const real_blockId,
+                                pageIndex const * const page) // nullptr to read whole block
+{
+    SDL_ASSERT(lock.owns_lock());
+    SDL_ASSERT(!page || (realBlock(*page) == real_blockId));
+    shard.begin_load(bi); // block is in-flight
+    lock.unlock(); // don't stall other blocks of shard during file I/O
+    try {
+        if (page) {
+            read_page_from_file(block_adr, *page);
+        }
+        else {
+            read_block_from_file(block_adr, real_blockId);
+        }
+    }
+    catch (...) {
+        lock.lock();
+        shard.cancel_load(bi, block_adr);
+        throw;
+    }
+    lock.lock();
+    block32 const allocId = shard.get_block_id(block_adr);
+    SDL_ASSERT(shard.get_block(allocId) == block_adr);
+    return allocId;
+}
+
+namespace {
+struct thread_page_buffer { // block image used to complete partial blocks
+    std::unique_ptr<char[]> data;
+    char * aligned = nullptr; // allows O_DIRECT read
+};
+thread_local thread_page_buffer t_page_buffer;
+} // namespace
+
+char * page_bpool::page_buffer()
+{
+    thread_page_buffer & t = t_page_buffer;
+    if (!t.data) {
+        enum { align = pool_limits::page_size };
+        t.data.reset(new char[pool_limits::block_size + align]);
+        t.aligned = t.data.get() + align - reinterpret_cast<size_t>(t.data.get()) % align;
+    }
+    return t.aligned;
+}
+
+// called if page of partial block is not read from file;
+// page which follows a loaded page (or third page of block) means extent scan, so rest of block is read
+uint8 page_bpool::read_pages_unlocked(unique_lock & lock, char * const buf, pageIndex const pageId, bool const page_read)
+{
+    SDL_ASSERT(lock.owns_lock());
+    const size_t real_blockId = realBlock(pageId);
+    page_bpool_shard const & shard = get_shard(real_blockId);
+    const uint8 loaded = shard.loaded_pages(m_block[real_blockId].blockId());
+    const size_t bit = page_bit(pageId);
+    const bool extent = (bit && (loaded & (1 << (bit - 1)))) || (number_of_1(loaded) >= 2);
+    lock.unlock(); // block is not pinned, so it is validated again after I/O
+    try {
+        if (page_read && !extent) {
+            read_page_from_file(buf, pageId);
+        }
+        else {
+            read_block_from_file(buf, real_blockId);
+        }
+    }
+    catch (...) {
+        lock.lock();
+        throw;
+    }
+    lock.lock();
+    if (page_read && !extent) {
+        return static_cast<uint8>(1 << bit);
+    }
+    return static_cast<uint8>((1 << info.block_page_count(real_blockId)) - 1);
+}
+
+namespace {
+struct thread_readahead { // sequential access of this thread
+    page_bpool const * pool = nullptr;
+    readahead_t state;
+};
+thread_local thread_readahead t_readahead;
+} // namespace
+
+// sequential access is detected even if read-ahead is disabled (used by page-granular reads)
+bool page_bpool::read_ahead(uint32 const real_blockId)
+{
+    SDL_ASSERT(m_ra || m_page_read);
+    thread_readahead & t = t_readahead;
+    if (t.pool != this) { // thread switched to another pool
+        t.pool = this;
+        t.state.reset();
+    }
+    const block32 max_window = m_ra ? m_ra->max_window : block32(readahead_t::min_window);
+    const readahead_t::range_t r = t.state.access(real_blockId, max_window);
+    if (m_ra) {
+        const block32 last = a_min(r.second, static_cast<block32>(info.block_count));
+        if (r.first < last) {
+            m_ra->push(r.first, last);
+        }
+    }
+    return t.state.window() != 0;
+}
+
+namespace {
+thread_local accessf t_access = accessf::normal;
+struct thread_ring { // blocks locked by bulk_read access of this thread
+    page_bpool const * pool = nullptr;
+    uint32 block[page_bpool::bulk_ring_size]; // least recently used first
+    size_t size = 0;
+};
+thread_local thread_ring t_ring;
+} // namespace
+
+accessf page_bpool::thread_access()
+{
+    return t_access;
+}
+
+accessf page_bpool::set_thread_access(accessf const f)
+{
+    const accessf old = t_access;
+    t_access = f;
+    return old;
+}
+
+void page_bpool::ring_push(uint32 const real_blockId, thread_mask_t * const thread_mask)
+{
+    thread_ring & t = t_ring;
+    if (t.pool != this) { // blocks of previous pool are left as is
+        t.pool = this;
+        t.size = 0;
+    }
+    uint32 * const last = t.block + t.size;
+    uint32 * const it = std::find(t.block, last, real_blockId);
+    if (it != last) { // becomes most recently used
+        std::rotate(it, it + 1, last);
+        return;
+    }
+    if (t.size < bulk_ring_size) {
+        t.block[t.size++] = real_blockId;
+        return;
+    }
+    const uint32 displaced = t.block[0];
+    std::rotate(t.block, t.block + 1, last);
+    t.block[t.size - 1] = real_blockId;
+    release_ring_block(displaced, thread_mask);
+}
+
+// pages of displaced block are unlocked by this thread;
+// block loaded by bulk_read (and not shared) is freed at once
+void page_bpool::release_ring_block(uint32 const real_blockId, thread_mask_t * const thread_mask)
+{
+    SDL_ASSERT(real_blockId && (real_blockId <= info.last_block));
+    page_bpool_shard & shard = get_shard(real_blockId);
+    lock_guard lock(shard.mutex());
+    atomic_block_index & bi = m_block[real_blockId];
+    if (!bi.blockId() || bi.is_loading()) { // block was evicted
+        return;
+    }
+    if (thread_mask) {
+        if (uint8 const pages = thread_mask->block_page(real_blockId)) {
+            thread_unlock_block(shard, *thread_mask, real_blockId, pages);
+        }
+    }
+    if (shard.free_ring_block(bi, bi.blockId()) && m_ra) {
+        m_ra->cancel(real_blockId); // scan is already ahead of pending read-ahead
+    }
+}
+
+char * page_bpool::prefetch_reserve(size_t const real_blockId) // called without shard mutex
+{
+    SDL_ASSERT(real_blockId && (real_blockId <= info.last_block));
+    atomic_block_index & bi = m_block[real_blockId];
+    if (bi.blockId() || bi.is_loading()) { // already loaded or in-flight
+        return nullptr;
+    }
+    if (m_quota.overflow(m_quota.find(real_blockId), 1)) { // set is already at its limit
+        return nullptr;
+    }
+    page_bpool_shard & shard = get_shard(real_blockId);
+    lock_guard lock(shard.mutex());
+    if (bi.blockId() || bi.is_loading()) {
+        return nullptr;
+    }
+    char * const block_adr = shard.try_alloc_block();
+    if (block_adr) { // nullptr if pool is full of locked blocks
+        shard.begin_load(bi);
+    }
+    return block_adr;
+}
+
+// blocks not in memory are reserved as in-flight, each run of adjacent blocks is read by one readv;
+// runs are read asynchronously if io_queue is used; returns number of blocks requested
+size_t page_bpool::prefetch_blocks(block32 const first, block32 const count, std::atomic<size_t> * const counter)
+{
+    SDL_ASSERT(first && count);
+    size_t result = 0;
+    io_request r;
+    r.counter = counter;
+    auto read_run = [this, &r, &result]() {
+        if (!r.count) {
+            return;
+        }
+        result += r.count;
+        if (m_aio) {
+            m_aio->submit(r); // completed by complete_prefetch
+        }
+        else {
+            bool ok = false;
+            try {
+                m_file.readv(r.v, r.count, r.offset);
+                ok = true;
+            }
+            catch (std::exception & e) { // blocks will be read on demand
+                SDL_TRACE("prefetch error = ", e.what());
+            }
+            complete_prefetch(r, ok);
+        }
+        r.count = 0;
+    };
+    for (size_t i = 0; i < count; ++i) {
+        const size_t real_blockId = first + i;
+        if (real_blockId > info.last_block) {
+            break;
+        }
+        if (char * const block_adr = prefetch_reserve(real_blockId)) {
+            if (!r.count) {
+                r.tag = real_blockId;
+                r.offset = real_blockId * pool_limits::block_size;
+            }
+            r.v[r.count].data = block_adr;
+            r.v[r.count].size = info.block_size_in_bytes(real_blockId);
+            if (++r.count == io_request::max_vec) {
+                read_run();
+            }
+        }
+        else {
+            read_run();
+        }
+    }
+    read_run();
+    return result;
+}
+
+// blocks of request are published or released if read failed
+void page_bpool::complete_prefetch(io_request const & r, bool const ok)
+{
+    SDL_ASSERT(r.tag && r.count);
+    for (size_t i = 0; i < r.count; ++i) {
+        const size_t real_blockId = r.tag + i;
+        page_bpool_shard & shard = get_shard(real_blockId);
+        atomic_block_index & bi = m_block[real_blockId];
+        lock_guard lock(shard.mutex());
+        if (ok) {
+            block32 const allocId = shard.get_block_id(r.v[i].data);
+            shard.unlock_block_init(allocId, real_blockId);
+            bi.publish(allocId);
+            shard.end_load();
+        }
+        else {
+            shard.cancel_load(bi, r.v[i].data);
+        }
+    }
+    if (ok) {
+        m_ra_merge.fetch_add(r.count - 1, std::memory_order_relaxed);
+        if (r.counter) {
+            r.counter->fetch_add(r.count, std::memory_order_relaxed);
+        }
+    }
+}
+
+size_t page_bpool::prefetch(pageIndex const first, size_t const page_count)
+{
+    SDL_ASSERT(first.value() < info.page_count);
+    if (!page_count) {
+        return 0;
+    }
+    size_t const last_page = a_min(first.value() + page_count, info.page_count) - 1;
+    size_t block = a_max(size_t(realBlock(first)), size_t(1)); // zero block is always in memory
+    size_t const last = last_page / pool_limits::block_page_num;
+    size_t result = 0;
+    while (block <= last) {
+        const size_t n = a_min(last - block + 1, size_t(io_request::max_vec));
+        result += prefetch_blocks(static_cast<block32>(block), static_cast<block32>(n));
+        block += n;
+    }
+    return result;
+}
+
+std::vector<page_bpool::block32>
+page_bpool::unique_blocks(vector_pageIndex const & pages) const
+{
+    std::vector<block32> blocks;
+    blocks.reserve(pages.size());
+    for (pageIndex const p : pages) {
+        const block32 b = realBlock(p);
+        if (b && (b <= info.last_block)) { // zero block is always in memory
+            blocks.push_back(b);
+        }
+    }
+    algo::sort(blocks);
+    blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+    return blocks;
+}
+
+size_t page_bpool::prefetch(vector_pageIndex const & pages)
+{
+    const std::vector<block32> blocks = unique_blocks(pages);
+    size_t result = 0;
+    for (size_t i = 0; i < blocks.size(); ) {
+        size_t j = i + 1;
+        while ((j < blocks.size()) && (blocks[j] == blocks[j - 1] + 1)) {
+            ++j;
+        }
+        result += prefetch_blocks(blocks[i], static_cast<block32>(j - i));
+        i = j;
+    }
+    return result;
+}
+
 bool page_bpool::unlock_page(pageIndex const pageId)
 {
     SDL_ASSERT(pageId.value() < info.page_count);
@@ -410,102 +704,112 @@ bool page_bpool::unlock_page(pageIndex const pageId)
     if (is_init_thread(this_thread)) {
         return false;
     }
-    lock_guard lock(m_mutex); // should be improved
-    block_index & bi = m_block[real_blockId];
-    if (bi.blockId() && bi.is_lock_page(page_bit(pageId))) { // block is loaded and page is locked
-        threadId_mask thread_index = m_thread_id.find(this_thread);
-        if (!thread_index.second) { // thread NOT found
-            SDL_ASSERT(!"thread NOT found");
-            return false;
-        }
-        SDL_DEBUG_CPP(block_head const * const first = first_block_head(bi.blockId()));
-        SDL_DEBUG_CPP(auto const test = get_block_head(bi.blockId(), pageId));
-        SDL_ASSERT(first->fixedBlock || test->pageLockThread);
-        const unlock_result res = unlock_block_head(bi, bi.blockId(), pageId, thread_index.first);
-        if (unlock_result::true_ == res) { // block is NOT used
-            SDL_ASSERT(!bi.pageLock());
-            SDL_ASSERT(!test->is_fixed());
-            SDL_ASSERT(thread_index.second->is_block(real_blockId));
-            thread_index.second->clr_block(real_blockId);
-            SDL_ASSERT(!test->pageLockThread);
-            return true;
+    thread_mask_t * const thread_mask = m_thread_id.find(this_thread);
+    if (!thread_mask) { // thread NOT found
+        return false;
+    }
+    if (!thread_mask->is_page(real_blockId, page_bit(pageId))) { // page is not locked by this thread
+        return false;
+    }
+    page_bpool_shard & shard = get_shard(real_blockId);
+    lock_guard lock(shard.mutex());
+    atomic_block_index & bi = m_block[real_blockId];
+    SDL_ASSERT(bi.blockId() && bi.is_lock_page(page_bit(pageId)));
+    const unlock_result res = shard.unlock_block_head(bi, bi.blockId(), pageId, *thread_mask);
+    SDL_ASSERT(!thread_mask->is_page(real_blockId, page_bit(pageId)));
+    if (unlock_result::true_ == res) { // block is NOT used
+        SDL_ASSERT(!bi.pageLock());
+        return true;
+    }
+    SDL_ASSERT((res == unlock_result::fixed_) || bi.pageLock());
+    return false; // block is used or fixed
+}
+
+size_t page_bpool::free_unlocked(decommitf const f) // returns blocks number
+{
+    size_t size = 0;
+    for_each_shard([f, &size](page_bpool_shard & shard){
+        size += shard.free_unlocked(f);
+    });
+    return size;
+}
+
+lock_page_head page_bpool::pin_page(pageIndex const pageId, accessf const access)
+{
+    const uint32 real_blockId = page_bpool::realBlock(pageId);
+    const auto this_thread = std::this_thread::get_id();
+    if (!real_blockId || is_init_thread(this_thread)) { // page is not locked by thread
+        return lock_page_head(lock_page(pageId, access));
+    }
+    thread_mask_t * const thread_mask = m_thread_id.insert(this_thread);
+    size_t const page = pageId.value();
+    bool const keep = thread_mask->is_page(real_blockId, page_bit(pageId)) && !thread_mask->is_pin(page);
+    page_head const * const p = lock_page(pageId, access);
+    if (p && thread_mask->is_page(real_blockId, page_bit(pageId))) {
+        thread_mask->add_pin(page, keep);
+        return lock_page_head(this, p, pageId);
+    }
+    return lock_page_head(p); // fixed block
+}
+
+void page_bpool::unpin_page(pageIndex const pageId)
+{
+    SDL_ASSERT(!is_zero_block(pageId));
+    if (thread_mask_t * const thread_mask = m_thread_id.find(std::this_thread::get_id())) {
+        if (thread_mask->sub_pin(pageId.value())) {
+            unlock_page(pageId);
         }
-        // block is used or fixed
-        SDL_ASSERT((res == unlock_result::fixed_) || bi.pageLock());
-        SDL_ASSERT(!test->is_lock_thread(thread_index.first.value()));
-        if (thread_index.second->is_block(real_blockId)) {
-            char * const block_adr = m_alloc.get_block(bi.blockId());
-            const size_t count = info.block_page_count(pageId);
-            for (size_t i = 0; i < count; ++i) { // can this thread release block ?
-                block_head const * const h = get_block_head(block_adr, i);
-                if (h->is_lock_thread(thread_index.first.value())) {
-                    return false;
-                }
-            }
-            thread_index.second->clr_block(real_blockId);
+    }
+}
+
+bool page_bpool::repin_page(pageIndex const pageId)
+{
+    SDL_ASSERT(!is_zero_block(pageId));
+    if (thread_mask_t * const thread_mask = m_thread_id.find(std::this_thread::get_id())) {
+        if (thread_mask->is_pin(pageId.value())) {
+            thread_mask->add_pin(pageId.value(), false);
+            return true;
         }
     }
     return false;
 }
 
-size_t page_bpool::free_unlocked(decommitf const f) // returns blocks number
+size_t page_bpool::pin_count()
 {
-    lock_guard lock(m_mutex);
-    const size_t size = free_unlock_blocks(info.block_count);
-    if (is_decommit(f) && m_free_block_list) {
-        m_alloc.release(m_free_block_list);
-        SDL_ASSERT(!m_free_block_list);
-        SDL_ASSERT(!size || m_alloc.can_alloc(size * pool_limits::block_size));
+    if (thread_mask_t const * const thread_mask = m_thread_id.find(std::this_thread::get_id())) {
+        return thread_mask->pin_count();
     }
-    return size;
+    return 0;
 }
 
-// mutex already locked
-bool page_bpool::thread_unlock_page(threadIndex const thread_index, pageIndex const pageId)
+// shard mutex already locked
+bool page_bpool::thread_unlock_block(page_bpool_shard & shard,
+                                     thread_mask_t & thread_mask,
+                                     size_t const real_blockId,
+                                     uint8 const pages)
 {
     SDL_ASSERT(!is_init_thread(std::this_thread::get_id()));
-    SDL_ASSERT(pageId.value() < info.page_count);
-    const size_t real_blockId = page_bpool::realBlock(pageId);
-    if (!real_blockId) { // zero block must be always in memory
-        SDL_ASSERT(0);
-        return false;
-    }
+    SDL_ASSERT(real_blockId && pages);
     if (info.last_block < real_blockId) {
         throw_error_t<block_index>("page not found");
         return false;
     }
-    block_index & bi = m_block[real_blockId];
-    if (bi.blockId()) { // block is loaded
-        if (bi.is_lock_page(page_bit(pageId))) {
-            SDL_DEBUG_CPP(auto const test = get_block_head(bi.blockId(), pageId));
-            SDL_ASSERT(test->pageLockThread);
-            const unlock_result result = unlock_block_head(bi, bi.blockId(), pageId, thread_index);
-            if (result == unlock_result::true_) {
+    SDL_ASSERT(&shard == &get_shard(real_blockId));
+    atomic_block_index & bi = m_block[real_blockId];
+    SDL_ASSERT(bi.blockId());
+    bool result = false;
+    for (size_t i = 0; i < pool_limits::block_page_num; ++i) {
+        if (pages & (1 << i)) {
+            SDL_ASSERT(bi.is_lock_page(i));
+            pageIndex const pageId = static_cast<page32>(real_blockId * pool_limits::block_page_num + i);
+            if (shard.unlock_block_head(bi, bi.blockId(), pageId, thread_mask) == unlock_result::true_) {
                 SDL_ASSERT(!bi.pageLock());
-                SDL_ASSERT(!test->pageLockThread);
-                return true;
+                result = true;
             }
-            else { // block is used or fixed
-                SDL_ASSERT(bi.pageLock());
-                SDL_ASSERT(!test->is_lock_thread(thread_index.value()));
-                return false;
-            }
-        }
-    }
-    return false;
-}
-
-// mutex already locked
-bool page_bpool::thread_unlock_block(threadIndex const thread_index, size_t const blockId) {
-    SDL_ASSERT(blockId);
-    const size_t count = info.block_page_count(blockId);
-    for (size_t i = 0; i < count; ++i) {
-        pageIndex const pageId = static_cast<page32>(blockId * pool_limits::block_page_num + i);
-        if (thread_unlock_page(thread_index, pageId)) {
-            return true;
         }
     }
-    return false;
+    SDL_ASSERT(!thread_mask.is_block(real_blockId));
+    return result;
 }
 
 size_t page_bpool::unlock_thread(thread_id const id, const removef f) 
@@ -514,169 +818,292 @@ size_t page_bpool::unlock_thread(thread_id const id, const removef f)
         SDL_ASSERT(!"unlock_thread");
         return 0;
     }
+    if (id != std::this_thread::get_id()) { // mask of other thread is used by lock-free fast_pin
+        SDL_ASSERT(!"unlock_thread");
+        return 0;
+    }
     SDL_TRACE_IF(trace_enable, "* unlock_thread ", id);
-    lock_guard lock(m_mutex); // should be improved
-    threadId_mask thread_index = m_thread_id.find(id);
-    if (!thread_index.second) { // thread NOT found
+    thread_mask_t * const thread_mask = m_thread_id.find(id);
+    if (!thread_mask) { // thread NOT found
         SDL_WARNING_DEBUG_2(0);
         return 0;
     }
-    size_t unlock_count = 0;
-    thread_mask_t & mask = *(thread_index.second);
-    mask.for_each_block([this, &thread_index, &unlock_count](size_t const blockId){
+    using block_pages = std::pair<block32, uint8>;
+    std::vector<block_pages> blocks; // grouped by shard to lock each shard once
+    thread_mask->for_each_block([&blocks](size_t const blockId, uint8 const pages){
         SDL_ASSERT(blockId);
-        if (blockId && thread_unlock_block(thread_index.first, blockId)) {
-            ++unlock_count;
-        }
+        blocks.emplace_back(static_cast<block32>(blockId), pages);
     });
+    if (m_shard_mask) {
+        const size_t shard_mask = m_shard_mask;
+        std::stable_sort(blocks.begin(), blocks.end(), [shard_mask](block_pages const & x, block_pages const & y){
+            return (x.first & shard_mask) < (y.first & shard_mask);
+        });
+    }
+    size_t unlock_count = 0;
+    auto first = blocks.begin();
+    while (first != blocks.end()) {
+        page_bpool_shard & shard = get_shard(first->first);
+        lock_guard lock(shard.mutex());
+        auto last = first;
+        for (; (last != blocks.end()) && (&get_shard(last->first) == &shard); ++last) {
+            if (thread_unlock_block(shard, *thread_mask, last->first, last->second)) {
+                ++unlock_count;
+            }
+        }
+        first = last;
+    }
     if (is_remove(f)) {
         m_thread_id.erase(id); // safer
     }
     else {
-        mask.clear();
+        thread_mask->clear();
     }
     SDL_TRACE_IF(trace_enable, "* unlock_thread ", id, " blocks = ", unlock_count);
     return unlock_count;
 }
 
-size_t page_bpool::free_unlock_blocks(size_t const block_count)
-{
-    if (!block_count) {
-        SDL_ASSERT(0);
-        return 0;
-    }
-    SDL_ASSERT(block_count <= info.block_count);
-    SDL_ASSERT(m_unlock_block_list.assert_list());
-    block_list_t free_block_list(this);
-    size_t const free_count = m_unlock_block_list.truncate(free_block_list, block_count);
-    if (free_count) {
-        SDL_ASSERT(free_block_list);
-        free_block_list.for_each([this](block_head * const h, block32 const p){
-            SDL_ASSERT(h->realBlock);
-            SDL_ASSERT(!h->is_fixed());
-            SDL_ASSERT(p);
-            block_index & bi = m_block[h->realBlock];
-            SDL_ASSERT(!bi.pageLock());
-            SDL_ASSERT(bi.blockId() == p);
-            bi.clr_blockId(); // must be reused
-            h->realBlock = block_list_t::null;
-            return true;
-        });
-        m_free_block_list.append(std::move(free_block_list));
-        SDL_ASSERT_DEBUG_2(m_unlock_block_list.assert_list());
-        SDL_ASSERT_DEBUG_2(m_free_block_list.assert_list());
-        SDL_ASSERT(m_free_block_list);
-        SDL_TRACE("free_unlock_blocks = ", free_count);
-        return free_count;
-    }
-    SDL_ASSERT(m_unlock_block_list.empty());
-    return 0;
-}
-
 #if SDL_DEBUG
 void page_bpool::trace_free_block_list()
 {
-    lock_guard lock(m_mutex);
-    m_free_block_list.trace();
+    for_each_shard([](page_bpool_shard & shard){
+        shard.trace_free_block_list();
+    });
 }
 #endif
 
+size_t page_bpool::hit_count() const {
+    size_t size = 0;
+    for_each_shard([&size](page_bpool_shard const & shard){
+        size += shard.hit_count();
+    });
+    return size;
+}
+
+size_t page_bpool::miss_count() const {
+    size_t size = 0;
+    for_each_shard([&size](page_bpool_shard const & shard){
+        size += shard.miss_count();
+    });
+    return size;
+}
+
+size_t page_bpool::page_miss_count() const {
+    size_t size = 0;
+    for_each_shard([&size](page_bpool_shard const & shard){
+        size += shard.page_miss_count();
+    });
+    return size;
+}
+
+size_t page_bpool::io_merge_count() const {
+    return m_ra_merge.load(std::memory_order_relaxed) + (m_io ? m_io->merge_count() : 0);
+}
+
 size_t page_bpool::alloc_used_size() const {
-    lock_guard lock(m_mutex);
-    return m_alloc.used_size();
+    size_t size = 0;
+    for_each_shard([&size](page_bpool_shard const & shard){
+        size += shard.alloc_used_size();
+    });
+    return size;
 }
 
 size_t page_bpool::alloc_unused_size() const {
-    lock_guard lock(m_mutex);
-    return m_alloc.unused_size();
+    size_t size = 0;
+    for_each_shard([&size](page_bpool_shard const & shard){
+        size += shard.alloc_unused_size();
+    });
+    return size;
 }
 
 size_t page_bpool::alloc_free_size() const {
-    lock_guard lock(m_mutex);
-    if (m_free_block_list) {
-        return m_free_block_list.length() * pool_limits::block_size;
-    }
-    return 0;
+    size_t size = 0;
+    for_each_shard([&size](page_bpool_shard const & shard){
+        size += shard.alloc_free_size();
+    });
+    return size;
 }
 
 size_t page_bpool::alloc_commited_size() const {
-    lock_guard lock(m_mutex);
-    return m_alloc.commited_size();
+    size_t size = 0;
+    for_each_shard([&size](page_bpool_shard const & shard){
+        size += shard.alloc_commited_size();
+    });
+    return size;
 }
 
 void page_bpool::async_release() // called from thread_data
 {
-    size_t free_length = 0;
-    {
-        lock_guard lock(m_mutex);
-        if (can_alloc_block() && m_free_block_list) {
-            free_length = a_max(size_t(1), m_free_block_list.length() / 2); // experimental
-        }
-        else {
-            SDL_ASSERT(!m_free_block_list);
-            SDL_TRACE(".", no_endl());
-            return;
+    for_each_shard([](page_bpool_shard & shard){
+        shard.async_release();
+    });
+}
+
+bool page_bpool::defragment()
+{
+    return defragment(nullptr);
+}
+
+// each shard is defragmented in time slices of at most m_defrag_slice block moves;
+// shard mutex is released between slices, so readers wait for one slice only
+bool page_bpool::defragment(std::atomic_bool const * const stop)
+{
+    using clock = std::chrono::steady_clock;
+    std::lock_guard<std::mutex> defrag_lock(m_defrag_mutex);
+    defrag_stat & stat = m_defrag_stat;
+    stat.last_pause_us = 0;
+    size_t moved = 0;
+    for (unique_shard const & p : m_shard) {
+        page_bpool_shard & shard = *p;
+        size_t max_total = 0; // moves are bounded even if blocks are loaded between slices
+        for (;;) {
+            if (stop && stop->load()) {
+                return moved > 0;
+            }
+            size_t n = 0;
+            const auto start = clock::now();
+            {
+                lock_guard lock(shard.mutex());
+                if (!max_total) {
+                    max_total = shard.alloc_used_size() / pool_limits::block_size + 1;
+                }
+                n = shard.defragment(m_defrag_slice);
+            }
+            const size_t us = static_cast<size_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                clock::now() - start).count());
+            ++stat.slice;
+            stat.total_pause_us += us;
+            set_max(stat.max_pause_us, us);
+            set_max(stat.last_pause_us, us);
+            moved += n;
+            stat.moved += n;
+            if ((n < m_defrag_slice) || (max_total <= n)) {
+                break;
+            }
+            max_total -= n;
+            std::this_thread::yield();
         }
     }
-    if (free_length) {
-        lock_guard lock(m_mutex);
-        block_list_t list(this);
-        if (m_free_block_list.truncate(list, free_length)) {
-            m_alloc.release(list);
-            SDL_ASSERT(!list);
+    ++stat.run;
+    return moved > 0;
+}
+
+page_bpool::defrag_stat page_bpool::defrag_statistics() const
+{
+    std::lock_guard<std::mutex> lock(m_defrag_mutex);
+    return m_defrag_stat;
+}
+
+// limits are clamped like database_cfg in base_page_bpool
+bool page_bpool::resize(size_t const min_memory, size_t const max_memory)
+{
+    const size_t min_size = a_min(min_memory, info.filesize);
+    const size_t max_size = max_memory ? a_min_max(max_memory, min_size, info.filesize) : info.filesize;
+    std::lock_guard<std::mutex> lock(m_budget_mutex);
+    m_target_max = max_size;
+    return apply_budget(min_size, max_size);
+}
+
+bool page_bpool::apply_budget(size_t const min_size, size_t const max_size)
+{
+    SDL_ASSERT(min_size <= max_size);
+    SDL_ASSERT(max_size <= info.filesize);
+    const bool changed = (min_size != m_budget.min_pool_size()) || (max_size != m_budget.max_pool_size());
+    m_budget.resize(min_size, max_size);
+    size_t evicted = 0;
+    const size_t count = m_shard.size();
+    for_each_shard([count, &evicted](page_bpool_shard & shard){
+        evicted += shard.resize(count);
+    });
+    SDL_TRACE_IF(trace_enable, "page_bpool::resize max = ", max_size, " evicted = ", evicted);
+    return changed || (evicted > 0);
+}
+
+page_bpool::quota_id
+page_bpool::set_quota(vector_pageIndex const & pages, size_t const max_memory, bool const pin)
+{
+    const std::vector<block32> blocks = unique_blocks(pages);
+    const size_t max_block = max_memory ? round_up_div(max_memory, size_t(pool_limits::block_size)) : 0;
+    const quota_id q = m_quota.insert(blocks, max_block, pin);
+    if (q) { // resident blocks join the set
+        for (block32 const b : blocks) {
+            page_bpool_shard & shard = get_shard(b);
+            lock_guard lock(shard.mutex());
+            shard.set_quota(m_block[b], q);
         }
     }
-    SDL_TRACE("~release ", free_length);
+    return q;
 }
 
-bool page_bpool::defragment_nolock() //FIXME: interrupt on event ?
+bool page_bpool::erase_quota(quota_id const q)
 {
-    if (can_alloc_block() && m_free_block_list) {
-        m_alloc.release(m_free_block_list);
-        SDL_ASSERT(!m_free_block_list);
-    }
-    if (!m_unlock_block_list) {
-        SDL_TRACE("!", no_endl());
-        return false; // nothing to defragment
+    const std::vector<block32> blocks = m_quota.erase(q);
+    for (block32 const b : blocks) {
+        page_bpool_shard & shard = get_shard(b);
+        lock_guard lock(shard.mutex());
+        shard.set_quota(m_block[b], 0);
     }
-    SDL_DEBUG_CPP(auto const test_unlock_count = m_unlock_block_list.length());
-    std::vector<block32> moved_unlock;
-    const bool result =
-    m_alloc.defragment([this, &moved_unlock](block32 const from, block32 const to) {
-        SDL_ASSERT(from != to);
-        if (m_unlock_block_list.find_block(from)) {
-            SDL_TRACE_DEBUG_2("defragment: ", from, " -> ", to);
-            if (block_head * const first = first_block_head(from)) { // must be allocated block
-                block_index & bi = m_block[first->realBlock];
-                if (bi.blockId() == from) {
-                    SDL_ASSERT(first->d_blockId == from);
-                    if (m_unlock_block_list.remove(first, from)) {
-                        SDL_DEBUG_CPP(first->d_blockId = to);
-                        moved_unlock.push_back(to);
-                        bi.set_blockId(to);
-                        return true;
-                    }
-                }
+    return !blocks.empty();
+}
+
+page_bpool::quota_stat
+page_bpool::quota_statistics(quota_id const q) const
+{
+    return m_quota.statistics(q);
+}
+
+// shard mutex is not waited: requester of pool_group holds mutex of its own shard
+size_t page_bpool::reclaim(size_t const block_count)
+{
+    SDL_ASSERT(block_count);
+    size_t result = 0;
+    for (unique_shard const & p : m_shard) {
+        unique_lock lock(p->mutex(), std::try_to_lock);
+        if (lock.owns_lock()) {
+            result += p->reclaim(block_count - result);
+            if (result >= block_count) {
+                break;
             }
-            SDL_ASSERT(0); //return false;
         }
-        SDL_ASSERT(m_lock_block_list.find_block(from) || m_fixed_block_list.find_block(from));
-        return false; // don't move used block
-    });
-    SDL_ASSERT(result == !moved_unlock.empty());
-    if (!moved_unlock.empty()) {
-        for (auto const & b : moved_unlock) {
-            m_unlock_block_list.insert(first_block_head(b), b);
-        }
-    }    
-    SDL_ASSERT(test_unlock_count == m_unlock_block_list.length());
+    }
     return result;
 }
 
-bool page_bpool::defragment()
+bool page_bpool::check_pressure()
 {
-    lock_guard lock(m_mutex);
-    return defragment_nolock();
+    double avg10 = 0;
+    if (m_pressure_path.empty() || !memory_pressure::read(m_pressure_path, avg10)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_budget_mutex);
+    const size_t min_size = m_budget.min_pool_size();
+    const size_t current = m_budget.max_pool_size();
+    const size_t next = memory_pressure::next_budget(current, min_size, m_target_max, avg10, m_pressure_limit);
+    if (next == current) {
+        return false;
+    }
+    if (next < current) {
+        ++m_pressure_shrink;
+    }
+    return apply_budget(min_size, next);
+}
+
+//---------------------------------------------------
+
+void page_bpool::group_data::attach(page_bpool * const pool, std::string const & filename, size_t const weight)
+{
+    SDL_ASSERT(m_group && !m_pool);
+    m_pool = pool;
+    m_pool->m_budget.set_group(m_group.get(), weight);
+    m_group->attach(pool, &pool->m_budget, filename, weight);
+}
+
+page_bpool::group_data::~group_data()
+{
+    if (m_pool) {
+        m_group->detach(m_pool, m_pool->m_budget.used_size());
+        m_pool->m_budget.set_group(nullptr, 0);
+    }
 }
 
 //---------------------------------------------------
@@ -685,6 +1112,8 @@ page_bpool::thread_data::thread_data(page_bpool * const parent, database_cfg con
     : m_parent(*parent)
     , m_period(cfg.pool_period ? cfg.pool_period : database_cfg::default_period)
     , m_defrag_period(cfg.pool_defrag) // can be 0
+    , m_pressure_period(cfg.pool_pressure.empty() ? 0 : a_max(cfg.pool_pressure_period, size_t(1)))
+    , m_tick(m_pressure_period ? a_min(m_period, m_pressure_period) : m_period)
     , m_shutdown(false)
     , m_ready(false)
 {
@@ -723,22 +1152,36 @@ void page_bpool::thread_data::run_thread()
     try {
         bool timeout = false;
         size_t defrag_timeout = 0; 
+        size_t release_timeout = 0;
+        size_t pressure_timeout = 0;
         while (!m_shutdown) {
             {
                 std::unique_lock<std::mutex> lock(m_cv_mutex);
-                m_cv.wait_for(lock, std::chrono::seconds(m_period), [this]{
+                m_cv.wait_for(lock, std::chrono::seconds(m_tick), [this]{
                     return m_ready.load();
                 });
                 timeout = !m_ready;
                 m_ready = false;
             }
+            if (timeout && m_pressure_period) {
+                pressure_timeout += m_tick;
+                if (pressure_timeout >= m_pressure_period) {
+                    pressure_timeout = 0;
+                    m_parent.check_pressure();
+                }
+            }
+            if (timeout) {
+                release_timeout += m_tick;
+                timeout = (release_timeout >= m_period);
+            }
             if (timeout) {
+                release_timeout = 0;
                 m_parent.async_release();
                 if (m_defrag_period > 0) {
                     defrag_timeout += m_period;
                     if (defrag_timeout >= m_defrag_period) {
                         defrag_timeout = 0;
-                        m_parent.defragment(); //FIXME: interrupt on event ?
+                        m_parent.defragment(&m_shutdown);
                     }
                 }
             }
@@ -750,6 +1193,97 @@ void page_bpool::thread_data::run_thread()
     }
 }
 
+//---------------------------------------------------
+
+page_bpool::readahead_data::readahead_data(page_bpool * const parent, block32 const window)
+    : m_parent(*parent)
+    , m_queue(window * 4)
+    , max_window(window)
+{
+    SDL_ASSERT(parent);
+    SDL_ASSERT(max_window);
+}
+
+page_bpool::readahead_data::~readahead_data(){
+    m_queue.shutdown();
+}
+
+void page_bpool::readahead_data::launch() {
+    SDL_ASSERT(!m_thread);
+    m_thread.reset(new joinable_thread([this](){
+        this->run_thread();
+    }));
+}
+
+void page_bpool::readahead_data::run_thread()
+{
+    block32 realBlock = 0;
+    block32 count = 0;
+    while (m_queue.pop(realBlock, count, max_range)) {
+        try {
+            m_parent.prefetch_blocks(realBlock, count);
+        }
+        catch (std::exception & e) { // block will be read on demand
+            SDL_TRACE("read-ahead error = ", e.what());
+        }
+    }
+}
+
+//---------------------------------------------------
+
+page_bpool::warm_data::warm_data(page_bpool * const parent, warm_file::vector_block32 && list)
+    : m_parent(*parent)
+    , m_list(std::move(list))
+{
+    SDL_ASSERT(parent);
+    SDL_ASSERT(!m_list.empty());
+}
+
+page_bpool::warm_data::~warm_data() {
+    m_shutdown = true;
+    wait(); // m_count is used by asynchronous reads
+}
+
+void page_bpool::warm_data::launch(size_t const thread_count) {
+    SDL_ASSERT(m_thread.empty());
+    SDL_ASSERT(thread_count);
+    m_thread.resize(a_min(thread_count, m_list.size()));
+    for (auto & t : m_thread) {
+        t.reset(new joinable_thread([this](){
+            this->run_thread();
+        }));
+    }
+}
+
+void page_bpool::warm_data::wait() {
+    m_thread.clear(); // join
+    if (m_parent.m_aio) {
+        m_parent.m_aio->wait();
+    }
+}
+
+void page_bpool::warm_data::run_thread() // threads take chunks of blocks in file order
+{
+    enum { chunk = io_request::max_vec };
+    size_t i;
+    while (!m_shutdown && ((i = m_next.fetch_add(chunk)) < m_list.size())) {
+        const size_t last = a_min(i + chunk, m_list.size());
+        while (!m_shutdown && (i < last)) {
+            size_t n = 1; // adjacent blocks
+            while ((i + n < last) && (m_list[i + n] == m_list[i] + n)) {
+                ++n;
+            }
+            try {
+                m_parent.prefetch_blocks(m_list[i], static_cast<block32>(n), &m_count);
+            }
+            catch (std::exception & e) { // blocks will be read on demand
+                SDL_TRACE("warm error = ", e.what());
+            }
+            i += n;
+        }
+    }
+}
+
 #if SDL_DEBUG
 namespace {
     class unit_test {
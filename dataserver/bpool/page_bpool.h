@@ -5,55 +5,21 @@
 #define __SDL_BPOOL_PAGE_BPOOL_H__
 
 #include "dataserver/bpool/file.h"
-#include "dataserver/bpool/thread_id.h"
-#include "dataserver/bpool/block_list.h"
-#include "dataserver/bpool/flag_type.h"
+#include "dataserver/bpool/io_queue.h"
+#include "dataserver/bpool/lock_page.h"
+#include "dataserver/bpool/page_shard.h"
+#include "dataserver/bpool/readahead.h"
 #include "dataserver/common/thread.h"
 #include "dataserver/common/algorithm.h"
 #include "dataserver/system/database_cfg.h"
 
-#if 0 //defined(SDL_OS_WIN32)
-#include "dataserver/bpool/alloc_win32.h"
-#else
-#include "dataserver/bpool/alloc_unix.h"
-#endif
-
 namespace sdl { namespace db { namespace bpool {
 
-#if 0 //defined(SDL_OS_WIN32)
-using page_bpool_alloc = page_bpool_alloc_win32;
-#else
-using page_bpool_alloc = page_bpool_alloc_unix;
-#endif
-
-struct pool_info_t final {
-    using T = pool_limits;
-    size_t const filesize = 0;
-    size_t const page_count = 0;
-    size_t const block_count = 0;
-    size_t last_block = 0;
-    size_t last_block_page_count = 0;
-    size_t last_block_size = 0;
-    explicit pool_info_t(size_t);
-    size_t block_size_in_bytes(const size_t b) const {
-        SDL_ASSERT(b < block_count);
-        return (b == last_block) ? last_block_size : T::block_size;
-    }
-    size_t block_page_count(const size_t b) const {
-        SDL_ASSERT(b < block_count);
-        return (b == last_block) ? last_block_page_count : T::block_page_num;
-    }
-    size_t block_page_count(pageIndex const p) const {
-        SDL_ASSERT(p.value() < page_count);
-        return block_page_count(p.value() / pool_limits::block_page_num);
-    }
-};
-
 //----------------------------------------------------------
 
 class page_bpool_file {
 protected:
-    explicit page_bpool_file(const std::string & fname);
+    page_bpool_file(const std::string & fname, bool direct);
     ~page_bpool_file(){}
 public:
     static bool valid_filesize(size_t);
@@ -68,7 +34,6 @@ class base_page_bpool : public page_bpool_file {
 protected:
     base_page_bpool(const std::string & fname, database_cfg const &);
     ~base_page_bpool(){}
-    size_t free_pool_block(size_t) const;
     const pool_info_t info;
     size_t min_pool_size() const { return m_min_pool_size; }
     size_t max_pool_size() const { return m_max_pool_size; }
@@ -77,11 +42,6 @@ private:
     size_t m_max_pool_size = 0;
 };
 
-inline size_t base_page_bpool::free_pool_block(size_t const current) const {
-    SDL_ASSERT(current <= info.filesize);
-    return a_max((current - m_min_pool_size) / pool_limits::block_size, size_t(2));
-}
-
 //----------------------------------------------------------
 
 class page_bpool final : base_page_bpool {
@@ -89,6 +49,8 @@ class page_bpool final : base_page_bpool {
     using thread_id = std::thread::id;
     SDL_NONCOPYABLE(page_bpool)
 public:
+    enum { max_shard = 64 };
+    enum { bulk_ring_size = 16 }; // blocks of one thread cycled by bulk_read access
     const thread_id init_thread_id;
     page_bpool(const std::string & fname, database_cfg const &);
     ~page_bpool();
@@ -96,17 +58,86 @@ public:
     static bool is_zero_block(pageIndex);
     bool is_open() const;
     size_t page_count() const;
-    page_head const * lock_page(pageIndex);
+    page_head const * lock_page(pageIndex); // uses access strategy of this thread
+    page_head const * lock_page(pageIndex, accessf);
     bool unlock_page(pageIndex);
+    lock_page_head pin_page(pageIndex); // page is unpinned by the last handle of this thread
+    lock_page_head pin_page(pageIndex, accessf);
+    size_t pin_count(); // pages pinned by handles of this thread
     page_head const * lock_page_fixed(pageIndex, fixedf);
+    page_head const * lock_page_fixed(pageIndex, fixedf, accessf);
+    static accessf thread_access(); // access strategy of this thread
+    static accessf set_thread_access(accessf); // returns previous strategy
     bool page_is_locked(pageIndex) const;
     bool page_is_fixed(pageIndex) const;
-    bool defragment();
+    bool defragment(); // incremental, shard mutex is released between time slices
+    struct defrag_stat { // pauses of readers caused by defragmentation
+        size_t run = 0;             // completed defragment() calls
+        size_t slice = 0;           // time slices (shard mutex is held during one slice)
+        size_t moved = 0;           // moved blocks
+        size_t max_pause_us = 0;    // longest slice
+        size_t total_pause_us = 0;
+        size_t last_pause_us = 0;   // longest slice of last run
+    };
+    defrag_stat defrag_statistics() const;
+    bool resize(size_t min_memory, size_t max_memory); // shrinking evicts unlocked blocks, max_memory = 0 means filesize
+    size_t min_memory() const {
+        return m_budget.min_pool_size();
+    }
+    size_t max_memory() const { // can be lower than resize() target under memory pressure
+        return m_budget.max_pool_size();
+    }
+    std::string const & pressure_path() const { // database_cfg::pool_pressure
+        return m_pressure_path;
+    }
+    bool check_pressure(); // reads pressure_path() and adapts max_memory(), returns true if budget changed
+    size_t pressure_shrink_count() const { // budget reductions caused by memory pressure
+        return m_pressure_shrink.load(std::memory_order_relaxed);
+    }
+    pool_group * group() const { // nullptr if page pool has own budget
+        return m_group.get();
+    }
+    size_t reclaim(size_t block_count); // called by pool_group, busy shards are skipped
+    using quota_id = block_quota::quota_id;
+    using quota_stat = block_quota::quota_stat;
+    using vector_pageIndex = std::vector<pageIndex>;
+    quota_id set_quota(vector_pageIndex const &, size_t max_memory, bool pin); // blocks of pages are limited to max_memory (0 = no limit) or never evicted if pin; returns 0 if all quotas are used
+    bool erase_quota(quota_id); // blocks of set become ordinary blocks
+    quota_stat quota_statistics(quota_id) const;
+    size_t prefetch(vector_pageIndex const &); // blocks of pages are read by runs of adjacent blocks
     size_t thread_size() const {
         return m_thread_id.size();
     }
+    size_t thread_capacity() const {
+        return m_thread_id.capacity();
+    }
+    size_t shard_size() const {
+        return m_shard.size();
+    }
+    bool is_direct() const { // file is read bypassing OS page cache (database_cfg::pool_direct)
+        return m_file.is_direct();
+    }
+    size_t prefetch(pageIndex, size_t page_count); // blocks of page range are read without lock (asynchronously if io_queue is used)
+    database_cfg::io_backend io_backend() const {
+        return m_aio ? m_aio->type() : database_cfg::io_backend::sync;
+    }
+    size_t io_batch_window() const { // in microseconds, 0 if reads are not batched
+        return m_io ? m_io->window() : 0;
+    }
+    size_t readahead_window() const { // in blocks, 0 if read-ahead is disabled
+        return m_ra ? m_ra->max_window : 0;
+    }
+    std::string const & warm_path() const { // sidecar file of database_cfg::pool_warm
+        return m_warm_path;
+    }
+    bool save_warm() { // resident blocks are written to warm_path()
+        return save_warm(m_warm_path);
+    }
+    bool save_warm(std::string const &);
+    size_t warm_count() const; // blocks restored from warm file
+    void wait_warm(); // blocks until warm file is restored
 public:
-    size_t unlock_thread(thread_id, removef);
+    size_t unlock_thread(thread_id, removef); // thread_id must be calling thread (thread mask is not locked)
     size_t unlock_thread(removef);
     size_t free_unlocked(decommitf); // returns blocks number
 public:
@@ -114,57 +145,97 @@ public:
     size_t alloc_unused_size() const;
     size_t alloc_free_size() const;
     size_t alloc_commited_size() const;
+    size_t hit_count() const; // pages found in memory
+    size_t miss_count() const; // blocks read from file on demand
+    size_t page_miss_count() const; // single pages read from file on demand (database_cfg::pool_page_read)
+    size_t io_merge_count() const; // block reads merged into readv of adjacent block
+    database_cfg::replacement policy() const {
+        return m_shard[0]->policy();
+    }
 private:
-    enum class unlock_result { false_, true_, fixed_ };
-    using threadId_mask = thread_id_t::pos_mask;
+    using unlock_result = page_bpool_shard::unlock_result;
+    using lock_guard = page_bpool_shard::lock_guard;
+    using unique_lock = page_bpool_shard::unique_lock;
+    using unique_shard = std::unique_ptr<page_bpool_shard>;
     bool is_init_thread(thread_id const & id) const {
         return this->init_thread_id == id;
     }
-    bool thread_unlock_page(threadIndex, pageIndex); // called from unlock_thread
-    bool thread_unlock_block(threadIndex, size_t); // called from unlock_thread
+    static size_t shard_count(database_cfg const &, pool_info_t const &);
+    friend lock_page_head;
+    void unpin_page(pageIndex); // called by lock_page_head
+    bool repin_page(pageIndex); // copy of lock_page_head
+    page_bpool_shard & get_shard(size_t realBlock) const;
+    bool thread_unlock_block(page_bpool_shard &, thread_mask_t &, size_t, uint8); // called from unlock_thread
     static pageIndex block_pageIndex(pageIndex);
     static pageIndex block_pageIndex(pageIndex, size_t);
     void load_zero_block();
-    void read_block_from_file(char * block_adr, size_t);
+    void read_file(char * dest, size_t offset, size_t size); // called without shard mutex
+    void read_block_from_file(char * block_adr, size_t); // called without shard mutex
+    void read_page_from_file(char * block_adr, pageIndex); // page at its offset in block
+    block32 read_block_unlocked(unique_lock &, page_bpool_shard &, atomic_block_index &, char *, size_t, pageIndex const * page = nullptr);
+    static char * page_buffer(); // block_size buffer of this thread (page aligned)
+    uint8 read_pages_unlocked(unique_lock &, char * buf, pageIndex, bool page_read); // pages missing in partial block
+    bool read_ahead(uint32); // returns true if access of this thread is sequential
+    size_t prefetch_blocks(block32, block32 count, std::atomic<size_t> * counter = nullptr); // adjacent blocks are read by one readv
+    char * prefetch_reserve(size_t); // in-flight block or nullptr
+    void complete_prefetch(io_request const &, bool ok); // called by io_queue
+    std::vector<block32> unique_blocks(vector_pageIndex const &) const; // sorted file blocks of pages (without zero block)
+    void ring_push(uint32, thread_mask_t *); // block is used by bulk_read access of this thread
+    void release_ring_block(uint32, thread_mask_t *); // block displaced from ring
     static uint32 realBlock(pageIndex); // file block 
-    block_head const * get_block_head(block32, pageIndex) const;
-    static page_head * get_block_page(char * block_adr, size_t);
-    static block_head * get_block_head(char * block_adr, size_t);
-    static block_head * first_block_head(char * block_adr);
-    block_head * first_block_head(block32) const;
     page_head const * zero_block_page(pageIndex);
-    page_head const * lock_block_init(block32, pageIndex, threadId_mask const *, thread_id, fixedf); // block is loaded from file
-    page_head const * lock_block_head(block32, pageIndex, threadId_mask const *, thread_id, fixedf, uint8); // block was loaded before
-    unlock_result unlock_block_head(block_index &, block32, pageIndex, threadIndex);
-    size_t free_unlock_blocks(size_t); // returns number of free blocks
-    uint32 pageAccessTime() const;
-    bool can_alloc_block();
-    char * alloc_block();
+    warm_header make_warm_header(); // validates warm file
+    void load_warm();
+    template<class fun_type> void for_each_shard(fun_type &&) const;
 #if SDL_DEBUG
     void trace_free_block_list();
-    void trace_block(const char *, block32, pageIndex);
 #endif
     void async_release(); // called from thread_data
-    bool defragment_nolock();
+    bool defragment(std::atomic_bool const * stop); // stop is checked between time slices
+    bool apply_budget(size_t min_size, size_t max_size); // called under m_budget_mutex
 private:
-    friend page_bpool_friend; // for first_block_head
-    using lock_guard = std::lock_guard<std::mutex>;
-    mutable std::mutex m_mutex; // should be improved
-    mutable uint32 m_pageAccessTime = 0;
     char * m_zero_block_address = nullptr;
-    std::vector<block_index> m_block;
+    std::vector<atomic_block_index> m_block; // modified under mutex of its shard or by lock-free hit
+    pool_budget m_budget;
+    block_quota m_quota;
+    std::vector<unique_shard> m_shard;
+private:
+    class group_data : noncopyable { // membership in database_cfg::pool_group
+        std::shared_ptr<pool_group> const m_group;
+        page_bpool * m_pool = nullptr;
+    public:
+        explicit group_data(std::shared_ptr<pool_group> const & g): m_group(g) {}
+        ~group_data(); // detached after threads of page pool are stopped
+        void attach(page_bpool *, std::string const & filename, size_t weight);
+        pool_group * get() const {
+            return m_group.get();
+        }
+    };
+    group_data m_group;
+    friend group_data;
+private:
+    size_t const m_shard_mask;
     thread_id_t m_thread_id;
-    page_bpool_alloc m_alloc;
-    block_list_t m_lock_block_list;
-    block_list_t m_unlock_block_list;
-    block_list_t m_free_block_list;
-    block_list_t m_fixed_block_list;
+    bool const m_page_read; // database_cfg::pool_page_read
+    size_t const m_defrag_slice; // database_cfg::pool_defrag_slice
+    mutable std::mutex m_defrag_mutex; // one defragment() at a time
+    defrag_stat m_defrag_stat; // under m_defrag_mutex
+    std::unique_ptr<io_batch> m_io; // nullptr if database_cfg::pool_io_batch = 0
+    std::atomic<size_t> m_ra_merge{0}; // blocks merged by prefetch_blocks
+    std::unique_ptr<io_queue> m_aio; // nullptr if database_cfg::pool_io = sync
+    std::mutex m_budget_mutex; // one resize at a time
+    size_t m_target_max = 0; // max_memory set by resize(), under m_budget_mutex
+    std::string const m_pressure_path; // empty if memory pressure is not watched
+    double const m_pressure_limit; // percent of stalled time (avg10)
+    std::atomic<size_t> m_pressure_shrink{0};
 private:
     enum { trace_enable = 0 };
     class thread_data {
         page_bpool & m_parent;
         const size_t m_period; // in seconds
         const size_t m_defrag_period; // in seconds
+        const size_t m_pressure_period; // in seconds (= 0 if memory pressure is not watched)
+        const size_t m_tick; // wait period of thread, in seconds
         std::atomic_bool m_shutdown;
         std::atomic_bool m_ready;
         std::mutex m_cv_mutex;
@@ -181,11 +252,73 @@ private:
     };
     thread_data m_td;
     friend thread_data;
+private:
+    class readahead_data { // background read-ahead thread
+        page_bpool & m_parent;
+        readahead_queue m_queue;
+        std::unique_ptr<joinable_thread> m_thread;
+    public:
+        block32 const max_window;
+        readahead_data(page_bpool *, block32 window);
+        ~readahead_data();
+        void launch();
+        enum { max_range = io_batch::max_run }; // adjacent blocks prefetched at once
+        void push(block32 first, block32 last) {
+            m_queue.push(first, last);
+        }
+        void cancel(block32 realBlock) {
+            m_queue.cancel(realBlock);
+        }
+    private:
+        void run_thread();
+    };
+    static block32 readahead_size(database_cfg const &, size_t max_pool_size);
+    std::unique_ptr<readahead_data> m_ra; // nullptr if read-ahead is disabled
+    friend readahead_data;
+private:
+    class warm_data { // restores blocks of warm file in parallel
+        page_bpool & m_parent;
+        warm_file::vector_block32 const m_list; // in file order
+        std::atomic<size_t> m_next{0};
+        std::atomic<size_t> m_count{0};
+        std::atomic_bool m_shutdown{false};
+        std::vector<unique_thread> m_thread;
+    public:
+        warm_data(page_bpool *, warm_file::vector_block32 &&);
+        ~warm_data();
+        void launch(size_t thread_count);
+        void wait();
+        size_t count() const { // blocks loaded
+            return m_count.load(std::memory_order_relaxed);
+        }
+    private:
+        void run_thread();
+    };
+    enum { warm_thread_count = 4 };
+    std::string const m_warm_path;
+    database_cfg::warmup const m_warmup;
+    std::unique_ptr<warm_data> m_warm; // nullptr if nothing to restore
+    friend warm_data;
 };
 
 inline page_head const *
 page_bpool::lock_page(pageIndex const pageId) {
-    return lock_page_fixed(pageId, fixedf::false_);
+    return lock_page_fixed(pageId, fixedf::false_, thread_access());
+}
+
+inline page_head const *
+page_bpool::lock_page(pageIndex const pageId, accessf const f) {
+    return lock_page_fixed(pageId, fixedf::false_, f);
+}
+
+inline lock_page_head
+page_bpool::pin_page(pageIndex const pageId) {
+    return pin_page(pageId, thread_access());
+}
+
+inline page_head const *
+page_bpool::lock_page_fixed(pageIndex const pageId, fixedf const f) {
+    return lock_page_fixed(pageId, f, thread_access()); // bulk_read is ignored for fixed pages
 }
 
 inline size_t page_bpool::unlock_thread(const removef f) {
@@ -7,7 +7,7 @@
 namespace sdl { namespace db { namespace bpool {
 
 inline bool page_bpool::is_open() const {
-    return m_file.is_open() && m_alloc.is_open();
+    return m_file.is_open() && !m_shard.empty();
 }
 
 inline size_t page_bpool::page_count() const {
@@ -24,38 +24,18 @@ inline uint32 page_bpool::realBlock(pageIndex const pageId) { // file block
     return pageId.value() / pool_limits::block_page_num;
 }
 
-inline page_head *
-page_bpool::get_block_page(char * const block_adr, size_t const i) {
-    SDL_ASSERT(block_adr);
-    SDL_ASSERT(i < pool_limits::block_page_num);
-    return reinterpret_cast<page_head *>(block_adr + i * pool_limits::page_size);
-}
-
-inline block_head const *
-page_bpool::get_block_head(block32 const blockId, pageIndex const pageId) const {
-    char const * const block_adr = m_alloc.get_block(blockId);
-    char const * const page_adr = block_adr + page_head::page_size * page_bit(pageId);
-    page_head const * const page = reinterpret_cast<page_head const *>(page_adr);
-    return block_head::get_block_head(page);
-}
-
-inline block_head *
-page_bpool::get_block_head(char * const block_adr, size_t const i) {
-    return block_head::get_block_head(get_block_page(block_adr, i));
+inline page_bpool_shard &
+page_bpool::get_shard(size_t const realBlock) const {
+    SDL_ASSERT(realBlock < m_block.size());
+    return *m_shard[realBlock & m_shard_mask];
 }
 
-inline block_head *
-page_bpool::first_block_head(char * const block_adr) {
-    SDL_ASSERT(block_adr);
-    return block_head::get_block_head(reinterpret_cast<page_head *>(block_adr));
-}
-
-inline block_head *
-page_bpool::first_block_head(block32 const blockId) const {
-    SDL_ASSERT(blockId);
-    block_head * const p = first_block_head(m_alloc.get_block(blockId));
-    SDL_ASSERT(p->d_blockId == blockId);
-    return p;
+template<class fun_type>
+void page_bpool::for_each_shard(fun_type && fun) const {
+    for (unique_shard const & p : m_shard) {
+        lock_guard lock(p->mutex());
+        fun(*p);
+    }
 }
 
 inline pageIndex
@@ -76,16 +56,23 @@ page_bpool::zero_block_page(pageIndex const pageId) {
     return reinterpret_cast<page_head *>(page_adr);
 }
 
-inline void page_bpool::read_block_from_file(char * const block_adr, size_t const blockId) {
-     m_file.read(block_adr, blockId * pool_limits::block_size, info.block_size_in_bytes(blockId)); 
+inline void page_bpool::read_file(char * const dest, size_t const offset, size_t const size) { // thread safe
+    if (m_io) {
+        m_io->read(dest, offset, size);
+    }
+    else {
+        m_file.read(dest, offset, size);
+    }
+}
+
+inline void page_bpool::read_block_from_file(char * const block_adr, size_t const blockId) { // thread safe
+    read_file(block_adr, blockId * pool_limits::block_size, info.block_size_in_bytes(blockId)); 
 }
 
-inline uint32 page_bpool::pageAccessTime() const {
-#if 0
-    return unix_time();
-#else
-    return ++m_pageAccessTime;
-#endif
+inline void page_bpool::read_page_from_file(char * const block_adr, pageIndex const pageId) { // thread safe
+    SDL_ASSERT(pageId.value() < info.page_count);
+    read_file(block_adr + page_bit(pageId) * pool_limits::page_size,
+        static_cast<size_t>(pageId.value()) * pool_limits::page_size, pool_limits::page_size);
 }
 
 //----------------------------------------------------------------
@@ -0,0 +1,711 @@
+// page_shard.cpp
+//
+#include "dataserver/bpool/page_shard.h"
+
+namespace sdl { namespace db { namespace bpool {
+
+pool_info_t::pool_info_t(const size_t s)
+    : filesize(s)
+    , page_count(s / T::page_size)
+    , block_count((s + T::block_size - 1) / T::block_size)
+{
+    SDL_ASSERT(filesize > T::block_size);
+    SDL_ASSERT(!(filesize % T::page_size));
+    static_assert(is_power_two(T::block_page_num), "");
+    const size_t n = page_count % T::block_page_num;
+    last_block = block_count - 1;
+    last_block_page_count = n ? n : T::block_page_num;
+    last_block_size = T::page_size * last_block_page_count;
+    SDL_ASSERT((last_block_size >= T::page_size) && (last_block_size <= T::block_size));
+}
+
+//------------------------------------------------------
+
+block_head *
+page_bpool_friend::first_block_head(block32 const blockId) const {
+    return m_p->first_block_head(blockId);
+}
+
+//------------------------------------------------------
+
+size_t page_bpool_shard::block_count(pool_info_t const & info,
+                                     size_t const shard_index,
+                                     size_t const shard_count)
+{
+    SDL_ASSERT(shard_index < shard_count);
+    SDL_ASSERT(shard_count <= info.block_count);
+    return (info.block_count - shard_index + shard_count - 1) / shard_count;
+}
+
+page_bpool_shard::page_bpool_shard(pool_info_t const & in,
+                                   pool_budget & budget,
+                                   std::vector<atomic_block_index> & block,
+                                   block_quota & quota,
+                                   size_t const shard_index,
+                                   size_t const shard_count,
+                                   database_cfg const & cfg)
+    : info(in)
+    , m_budget(budget)
+    , m_block(block)
+    , m_quota(quota)
+    , m_index(shard_index)
+    , m_min_pool_size(budget.min_pool_size() / shard_count)
+    , m_max_pool_size(round_up_div(budget.max_pool_size(), shard_count))
+    , m_alloc(block_count(in, shard_index, shard_count) * pool_limits::block_size, cfg)
+    , m_lock_block_list(this, "lock")
+    , m_free_block_list(this, "free")
+    , m_fixed_block_list(this, "fixed")
+    , m_pin_block_list(this, "pin")
+    , m_policy(block_policy::make(cfg, this, 
+        m_max_pool_size / pool_limits::block_size,
+        block_count(in, shard_index, shard_count), shard_count))
+{
+    SDL_ASSERT(shard_index < shard_count);
+    SDL_ASSERT(m_min_pool_size <= m_max_pool_size);
+}
+
+block_head *
+page_bpool_shard::init_block_head(char * const block_adr, size_t const realBlock, uint8 const loaded)
+{
+    SDL_ASSERT(realBlock);
+    block_head * const first = first_block_head(block_adr);
+    { // clear/init block_head for all pages
+        first->set_zero();
+        for (size_t i = 1, end = info.block_page_count(realBlock); i < end; ++i) {
+            get_block_head(block_adr, i)->set_zero();
+        }
+    }
+    SDL_DEBUG_CPP(first->d_blockId = get_block_id(block_adr));
+    first->realBlock = static_cast<block32>(realBlock);
+    first->loaded = loaded;
+    first->quota = m_quota.find(realBlock);
+    m_quota.add_resident(static_cast<quota_id>(first->quota));
+    first->priority = static_cast<unsigned>(priority_policy::block_priority(block_adr, info.block_page_count(realBlock), loaded));
+    return first;
+}
+
+page_head const *
+page_bpool_shard::lock_block_init(block32 const blockId,
+                                  pageIndex const pageId,
+                                  thread_mask * const threadId,
+                                  fixedf const page_fixed,
+                                  accessf const access,
+                                  bool const page_read)
+{
+    SDL_ASSERT(blockId);
+    char * const block_adr = m_alloc.get_block(blockId);
+    char * const page_adr = block_adr + page_head::page_size * page_bit(pageId);
+    page_head * const page = reinterpret_cast<page_head *>(page_adr);
+    size_t const realBlock = pageId.value() / pool_limits::block_page_num;
+    block_head * const first = init_block_head(block_adr, realBlock,
+        page_read ? static_cast<uint8>(1 << page_bit(pageId)) : all_pages(realBlock));
+    SDL_ASSERT(first->d_blockId == blockId);
+    if (is_bulk_read(access)) {
+        first->ring = 1;
+    }
+    else {
+        m_policy->on_miss(first);
+    }
+    if (page_read) {
+        ++m_page_miss;
+    }
+    else {
+        ++m_miss;
+    }
+    if (!threadId || is_fixed(page_fixed)) {
+        first->set_fixed();
+        m_fixed_block_list.insert(first, blockId);
+    }
+    else {
+        if (threadId->set_page(first->realBlock, page_bit(pageId))) {
+            block_head::get_block_head(page)->add_lock();
+        }
+        m_lock_block_list.insert(first, blockId);
+    }
+    return page;
+}
+
+void page_bpool_shard::unlock_block_init(block32 const blockId, size_t const realBlock)
+{
+    SDL_ASSERT(blockId);
+    block_head * const first = init_block_head(m_alloc.get_block(blockId), realBlock, all_pages(realBlock));
+    SDL_ASSERT(first->d_blockId == blockId);
+    first->prefetch = 1;
+    insert_unlocked(first, blockId); // most recently used
+}
+
+page_head const *
+page_bpool_shard::lock_block_head(block32 const blockId,
+                                  pageIndex const pageId,
+                                  thread_mask * const threadId,
+                                  fixedf const page_fixed,
+                                  uint8 const oldLock,
+                                  accessf const access)
+{
+    SDL_ASSERT(blockId);
+    char * const block_adr = m_alloc.get_block(blockId);
+    char * const page_adr = block_adr + page_head::page_size * page_bit(pageId);
+    page_head * const page = reinterpret_cast<page_head *>(page_adr);
+    block_head * const first = first_block_head(block_adr);
+    SDL_ASSERT(first->d_blockId == blockId);
+    SDL_ASSERT(first->realBlock == pageId.value() / pool_limits::block_page_num);
+    ++m_hit;
+    if (first->is_fixed()) { // fixed block is not counted
+        SDL_ASSERT(m_fixed_block_list.find_block(blockId));
+        if (threadId || !is_bulk_read(access)) { // ring block of init thread is shared (page is not locked)
+            first->ring = 0;
+        }
+        return page;
+    }
+    const bool prefetched = first->prefetch; // first access of prefetched block is not a hit for policy
+    first->prefetch = 0;
+    if (is_bulk_read(access)) {
+        if (prefetched) { // adopted by ring of this thread
+            first->ring = 1;
+        }
+    }
+    else { // block is shared with normal access
+        first->ring = 0;
+    }
+    if (!threadId || is_fixed(page_fixed)) {
+        first->set_fixed();
+        if (oldLock) { // was already locked
+            m_lock_block_list.remove(first, blockId);
+        }
+        else { // was unlocked
+            remove_unlocked(first, blockId);
+        }
+        m_fixed_block_list.insert(first, blockId);
+    }
+    else {
+        if (threadId->set_page(first->realBlock, page_bit(pageId))) {
+            block_head::get_block_head(page)->add_lock();
+        }
+        if (oldLock) { // was already locked
+            SDL_ASSERT_DEBUG_2(m_lock_block_list.find_block(blockId));
+            m_lock_block_list.promote(first, blockId);
+        }
+        else { // was unlocked
+            SDL_ASSERT_DEBUG_2(first->pinned ? m_pin_block_list.find_block(blockId) : m_policy->find_block(blockId));
+            remove_unlocked(first, blockId);
+            if (!(prefetched || is_bulk_read(access))) {
+                m_policy->on_hit(first);
+            }
+            m_lock_block_list.insert(first, blockId);
+        }
+    }
+    return page;
+}
+
+uint8 page_bpool_shard::loaded_pages(block32 const blockId) const
+{
+    return static_cast<uint8>(first_block_head(blockId)->loaded);
+}
+
+// pages are copied from block image read without mutex;
+// block_head of page is kept because it is used by pool (first one holds block metadata)
+bool page_bpool_shard::fill_block_pages(block32 const blockId, char const * const buf, uint8 const pages)
+{
+    SDL_ASSERT(blockId && buf && pages);
+    char * const block_adr = m_alloc.get_block(blockId);
+    block_head * const first = first_block_head(block_adr);
+    SDL_ASSERT(first->d_blockId == blockId);
+    const size_t page_count = info.block_page_count(first->realBlock);
+    for (size_t i = 0; i < page_count; ++i) {
+        const unsigned int bit = 1u << i;
+        if ((pages & bit) && !(first->loaded & bit)) {
+            block_head * const head = get_block_head(block_adr, i);
+            const block_head saved = *head;
+            memcpy(block_adr + i * pool_limits::page_size, buf + i * pool_limits::page_size, pool_limits::page_size);
+            *head = saved;
+            first->loaded |= bit;
+        }
+    }
+    if (number_of_1(pages) == 1) {
+        ++m_page_miss;
+    }
+    else {
+        ++m_miss;
+    }
+    return first->loaded == all_pages(first->realBlock);
+}
+
+void page_bpool_shard::update_priority(block32 const blockId)
+{
+    block_head * const first = first_block_head(blockId);
+    SDL_ASSERT(first->is_fixed() || m_lock_block_list.find_block(blockId)); // not in m_policy
+    first->priority = static_cast<unsigned>(priority_policy::block_priority(m_alloc.get_block(blockId),
+        info.block_page_count(first->realBlock), static_cast<uint8>(first->loaded)));
+}
+
+bool page_bpool_shard::free_ring_block(atomic_block_index & bi, block32 const blockId)
+{
+    block_head * const first = first_block_head(blockId);
+    if (!first->ring) {
+        return false;
+    }
+    first->ring = 0;
+    if (first->is_fixed()) { // loaded by init thread
+        char * const block_adr = m_alloc.get_block(blockId);
+        for (size_t i = 0; i < pool_limits::block_page_num; ++i) {
+            if (bi.is_lock_page(i)) {
+                block_head const * const head = get_block_head(block_adr, i);
+                if (head->lock_count()) { // page is used by other thread
+                    return false;
+                }
+                bi.clr_lock_page(i, head);
+            }
+        }
+        if (bi.pageLock()) { // locked again by lock-free hit
+            return false;
+        }
+        m_fixed_block_list.remove(first, blockId);
+    }
+    else {
+        if (bi.pageLock()) { // block is used by other thread
+            return false;
+        }
+        if (!m_policy->remove(first, blockId)) {
+            SDL_ASSERT(0);
+            return false;
+        }
+    }
+    m_quota.sub_resident(static_cast<quota_id>(first->quota));
+    bi.clr_blockId(); // must be reused
+    first->realBlock = block_list_t::null;
+    m_free_block_list.insert(first, blockId);
+    return true;
+}
+
+page_head const *
+page_bpool_shard::lock_page_fast(atomic_block_index & bi,
+                                 pageIndex const pageId,
+                                 thread_mask & threadId)
+{
+    if (block32 const blockId = bi.fast_pin(page_bit(pageId))) { // block is loaded and locked
+        page_head * const page = get_block_page(m_alloc.get_block_address(blockId), page_bit(pageId));
+        if (threadId.set_page(pageId.value() / pool_limits::block_page_num, page_bit(pageId))) {
+            block_head::get_block_head(page)->add_lock();
+        }
+        bi.fast_unpin(); // page is locked by this thread
+        m_fast_hit.fetch_add(1, std::memory_order_relaxed);
+        return page; // lock list is not promoted, block moves to unlock list when unlocked
+    }
+    return nullptr;
+}
+
+page_bpool_shard::unlock_result
+page_bpool_shard::unlock_block_head(atomic_block_index & bi,
+                                    block32 const blockId,
+                                    pageIndex const pageId, 
+                                    thread_mask & threadId)
+{
+    SDL_ASSERT(blockId);
+    SDL_ASSERT(bi.pageLock());
+    const size_t realBlock = pageId.value() / pool_limits::block_page_num;
+    if (!threadId.clr_page(realBlock, page_bit(pageId))) { // page is not locked by this thread
+        return unlock_result::false_;
+    }
+    char * const block_adr = m_alloc.get_block(blockId);
+    char * const page_adr = block_adr + page_head::page_size * page_bit(pageId);
+    page_head * const page = reinterpret_cast<page_head *>(page_adr); 
+    block_head * const head = block_head::get_block_head(page);
+    block_head * const first = first_block_head(block_adr);
+    if (!head->sub_lock()) { // no more locks for this page
+        if (bi.clr_lock_page(page_bit(pageId), head)) {
+            return unlock_result::false_; // other page(s) are still locked or page is locked again
+        }
+        SDL_ASSERT(!head->lock_count());
+        if (first->is_fixed()) {
+            SDL_ASSERT(m_fixed_block_list.find_block(blockId)); 
+            return unlock_result::fixed_;
+        }
+        m_lock_block_list.remove(first, blockId);
+        if (!free_over_quota(bi, first, blockId)) {
+            insert_unlocked(first, blockId);
+        }
+        return unlock_result::true_;
+    }
+    return unlock_result::false_;
+}
+
+bool page_bpool_shard::can_alloc_block()
+{
+    if (m_budget.is_limited(info.filesize)) {
+        if (m_free_block_list) {
+            return true;
+        }
+        const size_t current = m_alloc.used_size();
+        if ((current >= m_max_pool_size) || m_budget.overflow()) { // respect global max_memory
+            if (current && free_unlock_blocks(m_policy->evict_batch(free_pool_block(current)))) {
+                SDL_ASSERT(m_free_block_list);
+                return true;
+            }
+            SDL_WARNING_DEBUG_2(!"low on memory");
+        }
+        else if (m_budget.group_overflow()) { // databases above their share of pool_group give memory back
+            m_budget.reclaim();
+        }
+        if (m_alloc.can_alloc(pool_limits::block_size)) {
+            return true;
+        }
+        SDL_ASSERT_DEBUG_2(!"can_alloc_block");
+        return false;
+    }
+    SDL_ASSERT(m_alloc.can_alloc(pool_limits::block_size));
+    return true;
+}
+
+char * page_bpool_shard::alloc_block()
+{
+    if (char * const p = try_alloc_block()) {
+        return p;
+    }
+    SDL_ASSERT(!"bad alloc");
+    return nullptr;
+}
+
+char * page_bpool_shard::try_alloc_block()
+{
+    if (can_alloc_block()) {
+        if (m_free_block_list) { // must reuse free block (memory already allocated)
+            const auto p = pop_free_block();
+            SDL_ASSERT(p.first && p.second);
+            SDL_ASSERT(p.first->d_blockId == p.second);
+            A_STATIC_CHECK_TYPE(block_head *, p.first);
+            p.first->set_zero(); // prepare block to reuse
+            page_head * const page_adr = block_head::get_page_head(p.first);
+            SDL_ASSERT(m_alloc.get_block(p.second) == reinterpret_cast<char *>(page_adr));
+            return reinterpret_cast<char *>(page_adr);
+        }
+        if (char * const p = m_alloc.alloc_block()) {
+            m_budget.add(pool_limits::block_size);
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+block_list_t::block_head_Id
+page_bpool_shard::pop_free_block()
+{
+    SDL_ASSERT(m_free_block_list);
+    if (m_alloc.node_count() > 1) { // prefer free block on NUMA node of calling thread
+        enum { max_scan = 64 };
+        size_t const node = m_alloc.current_node();
+        size_t count = 0;
+        block_list_t::block_head_Id local{};
+        m_free_block_list.for_each([this, node, &count, &local](block_head * const h, block32 const p){
+            if (m_alloc.block_node(p) == node) {
+                local = { h, p };
+                return bc::break_;
+            }
+            return (++count < max_scan) ? bc::continue_ : bc::break_;
+        });
+        if (local.first && m_free_block_list.remove(local.first, local.second)) {
+            return local;
+        }
+    }
+    return m_free_block_list.pop_head();
+}
+
+void page_bpool_shard::begin_load(atomic_block_index & bi)
+{
+    bi.set_loading();
+    ++m_load_count;
+}
+
+void page_bpool_shard::end_load()
+{
+    SDL_ASSERT(m_load_count);
+    --m_load_count;
+    m_load_cv.notify_all();
+}
+
+void page_bpool_shard::cancel_load(atomic_block_index & bi, char * const block_adr)
+{
+    SDL_ASSERT(block_adr);
+    bi.clr_loading();
+    block32 const blockId = get_block_id(block_adr);
+    block_head * const first = first_block_head(block_adr);
+    first->set_zero(); // block_head may be overwritten by partial read
+    SDL_DEBUG_CPP(first->d_blockId = blockId);
+    m_free_block_list.insert(first, blockId);
+    end_load();
+}
+
+void page_bpool_shard::wait_load(unique_lock & lock)
+{
+    SDL_ASSERT(lock.owns_lock());
+    SDL_ASSERT(m_load_count);
+    m_load_cv.wait(lock); // spurious wakeup is checked by caller
+}
+
+void page_bpool_shard::release(block_list_t & list)
+{
+    SDL_ASSERT(list);
+    const size_t used = m_alloc.used_size();
+    m_alloc.release(list);
+    SDL_ASSERT(!list);
+    SDL_ASSERT(used >= m_alloc.used_size());
+    m_budget.sub(used - m_alloc.used_size());
+}
+
+size_t page_bpool_shard::free_unlocked(decommitf const f) // returns blocks number
+{
+    const size_t size = free_unlock_blocks(info.block_count);
+    if (is_decommit(f) && m_free_block_list) {
+        release(m_free_block_list);
+        SDL_ASSERT(!m_free_block_list);
+        SDL_ASSERT(!size || m_alloc.can_alloc(size * pool_limits::block_size));
+    }
+    return size;
+}
+
+size_t page_bpool_shard::free_unlock_blocks(size_t const block_count)
+{
+    if (!block_count) {
+        SDL_ASSERT(0);
+        return 0;
+    }
+    SDL_ASSERT(block_count <= info.block_count);
+    SDL_ASSERT(m_policy->assert_list());
+    block_list_t free_block_list(this);
+    size_t const free_count = m_policy->evict(free_block_list, block_count);
+    if (free_count) {
+        SDL_ASSERT(free_block_list);
+        free_block_list.for_each([this](block_head * const h, block32 const p){
+            SDL_ASSERT(h->realBlock);
+            SDL_ASSERT(!h->is_fixed());
+            SDL_ASSERT(p);
+            atomic_block_index & bi = m_block[h->realBlock];
+            SDL_ASSERT(!bi.pageLock());
+            SDL_ASSERT(bi.blockId() == p);
+            m_quota.sub_resident(static_cast<quota_id>(h->quota));
+            bi.clr_blockId(); // must be reused
+            h->realBlock = block_list_t::null;
+            return true;
+        });
+        m_free_block_list.append(std::move(free_block_list));
+        SDL_ASSERT_DEBUG_2(m_policy->assert_list());
+        SDL_ASSERT_DEBUG_2(m_free_block_list.assert_list());
+        SDL_ASSERT(m_free_block_list);
+        SDL_TRACE_DEBUG_2("free_unlock_blocks = ", free_count);
+        return free_count;
+    }
+    SDL_ASSERT(m_policy->empty());
+    return 0;
+}
+
+void page_bpool_shard::warm_blocks(warm_file::vector_block & dest) const
+{
+    auto const used = [](block_head const * const h) { // skip zero block and bulk_read ring
+        return h->realBlock && !h->ring;
+    };
+    auto const push_locked = [&dest, &used](block_head const * const h, block32) {
+        if (used(h)) {
+            dest.push_back({ h->realBlock, warm_file::locked_weight });
+        }
+        return bc::continue_;
+    };
+    m_lock_block_list.for_each(push_locked);
+    m_fixed_block_list.for_each(push_locked);
+    m_pin_block_list.for_each(push_locked);
+    size_t const count = m_policy->length();
+    size_t rank = 0;
+    m_policy->for_each([&dest, &used, count, &rank](block_head const * const h) {
+        SDL_ASSERT(rank < count);
+        if (used(h)) { // weight in [1, locked_weight)
+            const size_t weight = 1 + ((count - rank) * (warm_file::locked_weight - 2)) / count;
+            dest.push_back({ h->realBlock, static_cast<uint32>(weight) });
+        }
+        ++rank;
+    });
+}
+
+size_t page_bpool_shard::alloc_free_size() const
+{
+    if (m_free_block_list) {
+        return m_free_block_list.length() * pool_limits::block_size;
+    }
+    return 0;
+}
+
+// unlocked blocks above new max share are evicted, free blocks are decommitted
+size_t page_bpool_shard::resize(size_t const shard_count)
+{
+    SDL_ASSERT(shard_count);
+    m_min_pool_size = m_budget.min_pool_size() / shard_count;
+    m_max_pool_size = round_up_div(m_budget.max_pool_size(), shard_count);
+    SDL_ASSERT(m_min_pool_size <= m_max_pool_size);
+    size_t result = 0;
+    const size_t used = m_alloc.used_size(); // free blocks are counted until released
+    if (used > m_max_pool_size) {
+        const size_t excess = round_up_div(used - m_max_pool_size, size_t(pool_limits::block_size));
+        const size_t free_count = m_free_block_list.length();
+        if ((excess > free_count) && !m_policy->empty()) {
+            result = free_unlock_blocks(a_min(excess - free_count, info.block_count));
+        }
+        if (m_free_block_list) {
+            release(m_free_block_list);
+            SDL_ASSERT(!m_free_block_list);
+        }
+    }
+    return result;
+}
+
+size_t page_bpool_shard::reclaim(size_t const block_count)
+{
+    SDL_ASSERT(block_count);
+    size_t result = m_free_block_list.length();
+    if ((result < block_count) && !m_policy->empty()) {
+        result += free_unlock_blocks(a_min(block_count - result, info.block_count));
+    }
+    if (m_free_block_list) {
+        release(m_free_block_list);
+        SDL_ASSERT(!m_free_block_list);
+    }
+    return result;
+}
+
+void page_bpool_shard::insert_unlocked(block_head * const first, block32 const blockId)
+{
+    SDL_ASSERT(!first->pinned && !first->is_fixed());
+    if (m_quota.is_pinned(static_cast<quota_id>(first->quota))) {
+        first->ring = 0; // pinned block is not recycled by bulk_read ring
+        first->pinned = 1;
+        m_pin_block_list.insert(first, blockId);
+    }
+    else {
+        m_policy->insert(first, blockId);
+    }
+}
+
+bool page_bpool_shard::remove_unlocked(block_head * const first, block32 const blockId)
+{
+    if (first->pinned) {
+        first->pinned = 0;
+        return m_pin_block_list.remove(first, blockId);
+    }
+    return m_policy->remove(first, blockId);
+}
+
+// soft quota: set above its limit reuses memory of its own blocks instead of evicting other blocks
+bool page_bpool_shard::free_over_quota(atomic_block_index & bi, block_head * const first, block32 const blockId)
+{
+    const quota_id q = static_cast<quota_id>(first->quota);
+    if (!m_quota.overflow(q) || first->ring || bi.pageLock()) { // ring block is freed by its thread
+        return false;
+    }
+    m_quota.sub_resident(q);
+    bi.clr_blockId(); // must be reused
+    first->realBlock = block_list_t::null;
+    m_free_block_list.insert(first, blockId);
+    return true;
+}
+
+void page_bpool_shard::set_quota(atomic_block_index & bi, quota_id const q)
+{
+    block32 const blockId = bi.blockId();
+    if (!blockId || bi.is_loading()) { // in-flight block takes its set when loaded
+        return;
+    }
+    block_head * const first = first_block_head(blockId);
+    SDL_ASSERT(first->realBlock == static_cast<size_t>(&bi - m_block.data()));
+    if (first->quota != q) {
+        m_quota.sub_resident(static_cast<quota_id>(first->quota));
+        first->quota = q;
+        m_quota.add_resident(q);
+    }
+    if (first->is_fixed() || bi.pageLock()) { // list is changed when block is unlocked
+        return;
+    }
+    if (first->pinned != m_quota.is_pinned(q)) {
+        if (remove_unlocked(first, blockId)) {
+            insert_unlocked(first, blockId);
+        }
+        else {
+            SDL_ASSERT(0);
+        }
+    }
+}
+
+void page_bpool_shard::async_release()
+{
+    if (can_alloc_block() && m_free_block_list) {
+        const size_t free_length = a_max(size_t(1), m_free_block_list.length() / 2); // experimental
+        block_list_t list(this);
+        if (m_free_block_list.truncate(list, free_length)) {
+            release(list);
+        }
+    }
+}
+
+// one time slice of incremental defragmentation, mutex is held by caller
+size_t page_bpool_shard::defragment(size_t const max_move)
+{
+    SDL_ASSERT(max_move);
+    if (can_alloc_block() && m_free_block_list) {
+        release(m_free_block_list);
+        SDL_ASSERT(!m_free_block_list);
+    }
+    if (m_policy->empty()) {
+        return 0; // nothing to defragment
+    }
+    SDL_DEBUG_CPP(auto const test_unlock_count = m_policy->length());
+    std::vector<block32> moved_unlock;
+    const size_t result =
+    m_alloc.defragment([this, &moved_unlock](block32 const from, block32 const to) {
+        SDL_ASSERT(from != to);
+        if (m_policy->find_block(from)) {
+            SDL_TRACE_DEBUG_2("defragment: ", from, " -> ", to);
+            if (block_head * const first = first_block_head(from)) { // must be allocated block
+                atomic_block_index & bi = m_block[first->realBlock];
+                if (bi.blockId() == from) {
+                    SDL_ASSERT(first->d_blockId == from);
+                    if (m_policy->remove(first, from)) {
+                        SDL_DEBUG_CPP(first->d_blockId = to);
+                        moved_unlock.push_back(to);
+                        bi.set_blockId(to);
+                        return true;
+                    }
+                }
+            }
+            SDL_ASSERT(0); //return false;
+        }
+        SDL_ASSERT(m_load_count || // in-flight block is not in any list
+            m_lock_block_list.find_block(from) || m_fixed_block_list.find_block(from) ||
+            m_pin_block_list.find_block(from));
+        return false; // don't move used block
+    }, max_move);
+    SDL_ASSERT(result == moved_unlock.size());
+    if (!moved_unlock.empty()) {
+        for (auto const & b : moved_unlock) {
+            m_policy->insert(first_block_head(b), b);
+        }
+    }    
+    SDL_ASSERT(test_unlock_count == m_policy->length());
+    return result;
+}
+
+#if SDL_DEBUG
+namespace {
+    class unit_test {
+    public:
+        unit_test() {
+            pool_info_t const info(pool_limits::block_size * 10 + pool_limits::page_size);
+            SDL_ASSERT(info.block_count == 11);
+            size_t total = 0;
+            for (size_t i = 0; i < 4; ++i) {
+                total += page_bpool_shard::block_count(info, i, 4);
+            }
+            SDL_ASSERT(total == info.block_count);
+            SDL_ASSERT(page_bpool_shard::block_count(info, 0, 4) == 3);
+            SDL_ASSERT(page_bpool_shard::block_count(info, 3, 4) == 2);
+            SDL_ASSERT(page_bpool_shard::block_count(info, 0, 1) == info.block_count);
+        }
+    };
+    static unit_test s_test;
+}
+#endif //#if SDL_DEBUG
+}}} // sdl
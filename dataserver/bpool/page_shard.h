@@ -0,0 +1,240 @@
+// page_shard.h
+//
+#pragma once
+#ifndef __SDL_BPOOL_PAGE_SHARD_H__
+#define __SDL_BPOOL_PAGE_SHARD_H__
+
+#include "dataserver/bpool/thread_id.h"
+#include "dataserver/bpool/block_policy.h"
+#include "dataserver/bpool/warm.h"
+#include "dataserver/bpool/flag_type.h"
+#include "dataserver/bpool/pool_group.h"
+#include "dataserver/bpool/block_quota.h"
+#include <mutex>
+#include <condition_variable>
+
+#if 0 //defined(SDL_OS_WIN32)
+#include "dataserver/bpool/alloc_win32.h"
+#else
+#include "dataserver/bpool/alloc_unix.h"
+#endif
+
+namespace sdl { namespace db { namespace bpool {
+
+#if 0 //defined(SDL_OS_WIN32)
+using page_bpool_alloc = page_bpool_alloc_win32;
+#else
+using page_bpool_alloc = page_bpool_alloc_unix;
+#endif
+
+struct pool_info_t final {
+    using T = pool_limits;
+    size_t const filesize = 0;
+    size_t const page_count = 0;
+    size_t const block_count = 0;
+    size_t last_block = 0;
+    size_t last_block_page_count = 0;
+    size_t last_block_size = 0;
+    explicit pool_info_t(size_t);
+    size_t block_size_in_bytes(const size_t b) const {
+        SDL_ASSERT(b < block_count);
+        return (b == last_block) ? last_block_size : T::block_size;
+    }
+    size_t block_page_count(const size_t b) const {
+        SDL_ASSERT(b < block_count);
+        return (b == last_block) ? last_block_page_count : T::block_page_num;
+    }
+    size_t block_page_count(pageIndex const p) const {
+        SDL_ASSERT(p.value() < page_count);
+        return block_page_count(p.value() / pool_limits::block_page_num);
+    }
+};
+
+//----------------------------------------------------------
+
+class pool_budget : noncopyable { // shared by all shards, limits can be changed at runtime
+public:
+    pool_budget(size_t const s1, size_t const s2)
+        : m_min_pool_size(s1), m_max_pool_size(s2), m_used_size(0) {
+        SDL_ASSERT(s1 <= s2);
+    }
+    size_t min_pool_size() const {
+        return m_min_pool_size.load(std::memory_order_relaxed);
+    }
+    size_t max_pool_size() const {
+        return m_max_pool_size.load(std::memory_order_relaxed);
+    }
+    void resize(size_t const s1, size_t const s2) { // shards must be resized after
+        SDL_ASSERT(s1 <= s2);
+        m_min_pool_size.store(s1, std::memory_order_relaxed);
+        m_max_pool_size.store(s2, std::memory_order_relaxed);
+    }
+    size_t used_size() const {
+        return m_used_size.load(std::memory_order_relaxed);
+    }
+    bool is_limited(size_t const filesize) const { // blocks must be evicted before whole file is loaded
+        return (max_pool_size() < filesize) || m_group;
+    }
+    bool overflow() const { // pool above its share of pool_group is evicted first
+        if (used_size() >= max_pool_size()) {
+            return true;
+        }
+        return group_overflow() && (used_size() >= m_group->share(m_weight));
+    }
+    bool group_overflow() const {
+        return m_group && m_group->overflow();
+    }
+    size_t reclaim() { // other pools of group evict blocks, returns number of blocks
+        return m_group ? m_group->reclaim(this) : 0;
+    }
+    void add(size_t const s) {
+        m_used_size.fetch_add(s, std::memory_order_relaxed);
+        if (m_group) {
+            m_group->add(s);
+        }
+    }
+    void sub(size_t const s) {
+        SDL_ASSERT(s <= used_size());
+        m_used_size.fetch_sub(s, std::memory_order_relaxed);
+        if (m_group) {
+            m_group->sub(s);
+        }
+    }
+    void set_group(pool_group * const g, size_t const weight) { // called while page pool is not used by other threads
+        m_group = g;
+        m_weight = weight;
+    }
+private:
+    pool_group * m_group = nullptr;
+    size_t m_weight = 0;
+    std::atomic<size_t> m_min_pool_size;
+    std::atomic<size_t> m_max_pool_size;
+    std::atomic<size_t> m_used_size;
+};
+
+//----------------------------------------------------------
+
+// shard owns real blocks with (realBlock % shard_count == shard_index);
+// all methods except constructor and lock_page_fast require mutex() to be locked
+class page_bpool_shard final : noncopyable {
+    using block32 = block_index::block32;
+public:
+    using lock_guard = std::lock_guard<std::mutex>;
+    using unique_lock = std::unique_lock<std::mutex>;
+    using thread_mask = thread_mask_t;
+    using replacement = block_policy::replacement;
+    enum class unlock_result { false_, true_, fixed_ };
+    using quota_id = block_quota::quota_id;
+    page_bpool_shard(pool_info_t const &, pool_budget &, std::vector<atomic_block_index> &, block_quota &,
+        size_t shard_index, size_t shard_count, database_cfg const &);
+    size_t index() const {
+        return m_index;
+    }
+    std::mutex & mutex() const {
+        return m_mutex;
+    }
+    static size_t block_count(pool_info_t const &, size_t shard_index, size_t shard_count);
+    bool is_open() const {
+        return m_alloc.is_open();
+    }
+    char * get_block(block32 const blockId) const {
+        return m_alloc.get_block(blockId);
+    }
+    block32 get_block_id(char const * const block_adr) const {
+        return m_alloc.get_block_id(block_adr);
+    }
+    static page_head * get_block_page(char * block_adr, size_t);
+    static block_head * get_block_head(char * block_adr, size_t);
+    static block_head * first_block_head(char * block_adr);
+    block_head * first_block_head(block32) const;
+    block_head const * get_block_head(block32, pageIndex) const;
+    char * alloc_block();
+    char * try_alloc_block(); // returns nullptr if pool is full
+    void begin_load(atomic_block_index &); // block is in-flight, mutex may be unlocked to read it
+    void end_load(); // wakes up threads waiting for in-flight block(s)
+    void cancel_load(atomic_block_index &, char * block_adr); // read from file failed
+    void wait_load(unique_lock &); // wait for in-flight block(s)
+    page_head const * lock_block_init(block32, pageIndex, thread_mask *, fixedf, accessf, bool page_read); // block (or only page) is loaded from file
+    void unlock_block_init(block32, size_t); // block is prefetched from file
+    page_head const * lock_block_head(block32, pageIndex, thread_mask *, fixedf, uint8, accessf); // block was loaded before
+    uint8 loaded_pages(block32) const; // pages of partial block read from file
+    bool fill_block_pages(block32, char const * buf, uint8 pages); // returns true if all pages are read
+    void update_priority(block32); // block is locked or fixed
+    bool free_ring_block(atomic_block_index &, block32); // block leaves bulk_read ring
+    unlock_result unlock_block_head(atomic_block_index &, block32, pageIndex, thread_mask &);
+    page_head const * lock_page_fast(atomic_block_index &, pageIndex, thread_mask &); // mutex is NOT required
+    size_t free_unlocked(decommitf); // returns blocks number
+    void async_release();
+    size_t resize(size_t shard_count); // takes new share of pool_budget, returns number of evicted blocks
+    size_t reclaim(size_t block_count); // memory of unlocked blocks is given back to pool_group, returns number of blocks
+    void set_quota(atomic_block_index &, quota_id); // resident block joins block_quota set (0 = leaves its set)
+    size_t defragment(size_t max_move); // moves at most max_move unlocked blocks, returns number of moved blocks
+    size_t alloc_used_size() const {
+        return m_alloc.used_size();
+    }
+    size_t alloc_unused_size() const {
+        return m_alloc.unused_size();
+    }
+    size_t alloc_free_size() const;
+    replacement policy() const {
+        return m_policy->type();
+    }
+    size_t hit_count() const { // lock-free hits are counted without mutex
+        return m_hit + m_fast_hit.load(std::memory_order_relaxed);
+    }
+    size_t miss_count() const { // blocks read from file on demand
+        return m_miss;
+    }
+    size_t page_miss_count() const { // single pages read from file on demand
+        return m_page_miss;
+    }
+    size_t alloc_commited_size() const {
+        return m_alloc.commited_size();
+    }
+    void warm_blocks(warm_file::vector_block &) const; // resident blocks weighted by recent use
+#if SDL_DEBUG
+    void trace_free_block_list() const {
+        m_free_block_list.trace();
+    }
+#endif
+private:
+    size_t free_pool_block(size_t) const;
+    block_head * init_block_head(char * block_adr, size_t realBlock, uint8 loaded);
+    uint8 all_pages(size_t realBlock) const {
+        return static_cast<uint8>((1 << info.block_page_count(realBlock)) - 1);
+    }
+    size_t free_unlock_blocks(size_t); // returns number of free blocks
+    block_list_t::block_head_Id pop_free_block();
+    bool can_alloc_block();
+    void release(block_list_t &);
+    void insert_unlocked(block_head *, block32); // replacement policy or pin list
+    bool remove_unlocked(block_head *, block32);
+    bool free_over_quota(atomic_block_index &, block_head *, block32); // unlocked block of set above its limit
+private:
+    pool_info_t const & info;
+    pool_budget & m_budget;
+    std::vector<atomic_block_index> & m_block;
+    block_quota & m_quota;
+    size_t const m_index;
+    size_t m_min_pool_size; // share of pool_budget
+    size_t m_max_pool_size; // share of pool_budget
+    mutable std::mutex m_mutex;
+    std::condition_variable m_load_cv;
+    size_t m_load_count = 0; // in-flight blocks
+    page_bpool_alloc m_alloc;
+    block_list_t m_lock_block_list;
+    block_list_t m_free_block_list;
+    block_list_t m_fixed_block_list;
+    block_list_t m_pin_block_list; // unlocked blocks of pinned block_quota sets
+    std::unique_ptr<block_policy> m_policy; // unlocked blocks
+    size_t m_hit = 0;
+    size_t m_miss = 0;
+    size_t m_page_miss = 0;
+    std::atomic<size_t> m_fast_hit{0};
+};
+
+}}} // sdl
+
+#include "dataserver/bpool/page_shard.inl"
+
+#endif // __SDL_BPOOL_PAGE_SHARD_H__
@@ -0,0 +1,51 @@
+// page_shard.inl
+//
+#pragma once
+#ifndef __SDL_BPOOL_PAGE_SHARD_INL__
+#define __SDL_BPOOL_PAGE_SHARD_INL__
+
+namespace sdl { namespace db { namespace bpool {
+
+inline page_head *
+page_bpool_shard::get_block_page(char * const block_adr, size_t const i) {
+    SDL_ASSERT(block_adr);
+    SDL_ASSERT(i < pool_limits::block_page_num);
+    return reinterpret_cast<page_head *>(block_adr + i * pool_limits::page_size);
+}
+
+inline block_head *
+page_bpool_shard::get_block_head(char * const block_adr, size_t const i) {
+    return block_head::get_block_head(get_block_page(block_adr, i));
+}
+
+inline block_head *
+page_bpool_shard::first_block_head(char * const block_adr) {
+    SDL_ASSERT(block_adr);
+    return block_head::get_block_head(reinterpret_cast<page_head *>(block_adr));
+}
+
+inline block_head *
+page_bpool_shard::first_block_head(block32 const blockId) const {
+    SDL_ASSERT(blockId);
+    block_head * const p = first_block_head(m_alloc.get_block(blockId));
+    SDL_ASSERT(p->d_blockId == blockId);
+    return p;
+}
+
+inline block_head const *
+page_bpool_shard::get_block_head(block32 const blockId, pageIndex const pageId) const {
+    char const * const block_adr = m_alloc.get_block(blockId);
+    char const * const page_adr = block_adr + page_head::page_size * page_bit(pageId);
+    page_head const * const page = reinterpret_cast<page_head const *>(page_adr);
+    return block_head::get_block_head(page);
+}
+
+inline size_t page_bpool_shard::free_pool_block(size_t const current) const {
+    SDL_ASSERT(current <= info.filesize);
+    const size_t reserved = a_min(current, m_min_pool_size);
+    return a_max((current - reserved) / pool_limits::block_size, size_t(2));
+}
+
+}}} // sdl
+
+#endif // __SDL_BPOOL_PAGE_SHARD_INL__
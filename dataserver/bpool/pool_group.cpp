@@ -0,0 +1,110 @@
+// pool_group.cpp
+//
+#include "dataserver/bpool/pool_group.h"
+#include "dataserver/bpool/page_bpool.h"
+#include <algorithm>
+
+namespace sdl { namespace db { namespace bpool {
+
+pool_group::pool_group(size_t const max_memory)
+    : m_max_memory(max_memory)
+{
+    throw_error_if_not_t<pool_group>(max_memory >= pool_limits::block_size, "bad max_memory");
+}
+
+pool_group::~pool_group()
+{
+    SDL_ASSERT(m_member.empty());
+    SDL_ASSERT(!used_size());
+}
+
+size_t pool_group::member_count() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_member.size();
+}
+
+size_t pool_group::share(size_t const weight) const
+{
+    const size_t total = m_total_weight.load(std::memory_order_relaxed);
+    if (total > weight) {
+        return static_cast<size_t>(static_cast<double>(m_max_memory) * weight / total);
+    }
+    return m_max_memory;
+}
+
+void pool_group::attach(page_bpool * const pool, pool_budget const * const budget,
+                        std::string const & filename, size_t const weight)
+{
+    SDL_ASSERT(pool && budget && weight);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SDL_ASSERT(std::find_if(m_member.begin(), m_member.end(), [pool](member const & m){
+        return m.pool == pool; }) == m_member.end());
+    m_member.push_back({ pool, filename, weight, budget, 0 });
+    m_total_weight += weight;
+}
+
+void pool_group::detach(page_bpool * const pool, size_t const used_size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto const it = std::find_if(m_member.begin(), m_member.end(), [pool](member const & m){
+        return m.pool == pool;
+    });
+    if (it != m_member.end()) {
+        m_total_weight -= it->weight;
+        m_member.erase(it);
+        sub(used_size);
+    }
+    else {
+        SDL_ASSERT(0);
+    }
+}
+
+// requester holds mutex of its shard, so neither group mutex nor mutexes of other pools are waited
+size_t pool_group::reclaim(pool_budget const * const requester)
+{
+    std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return 0;
+    }
+    member * victim = nullptr;
+    size_t max_excess = 0;
+    for (member & m : m_member) {
+        if (m.budget != requester) {
+            const size_t used = m.budget->used_size();
+            const size_t limit = share(m.weight);
+            if ((used > limit) && (used - limit > max_excess)) {
+                max_excess = used - limit;
+                victim = &m;
+            }
+        }
+    }
+    if (victim) {
+        const size_t count = victim->pool->reclaim(a_min(size_t(reclaim_batch),
+            round_up_div(max_excess, size_t(pool_limits::block_size))));
+        victim->reclaimed += count;
+        return count;
+    }
+    return 0;
+}
+
+pool_group::vector_member_stat
+pool_group::statistics() const // must not be called under shard mutex
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    vector_member_stat result(m_member.size());
+    for (size_t i = 0; i < m_member.size(); ++i) {
+        member const & m = m_member[i];
+        member_stat & s = result[i];
+        s.filename = m.filename;
+        s.weight = m.weight;
+        s.share = share(m.weight);
+        s.used_size = m.budget->used_size();
+        s.hit_count = m.pool->hit_count();
+        s.miss_count = m.pool->miss_count();
+        s.reclaimed = m.reclaimed;
+    }
+    return result;
+}
+
+}}} // sdl
@@ -0,0 +1,76 @@
+// pool_group.h
+//
+#pragma once
+#ifndef __SDL_BPOOL_POOL_GROUP_H__
+#define __SDL_BPOOL_POOL_GROUP_H__
+
+#include "dataserver/common/common.h"
+#include <mutex>
+#include <atomic>
+
+namespace sdl { namespace db { namespace bpool {
+
+class page_bpool;
+class pool_budget;
+
+// process-wide memory budget shared by page pools of several databases (database_cfg::pool_group);
+// each page pool keeps its own block index, so pool blocks are keyed by (file, real block);
+// share of database is proportional to its weight, pools above their share are evicted first
+class pool_group : noncopyable {
+public:
+    enum { reclaim_batch = 4 }; // blocks evicted from other database at once
+    struct member_stat { // usage of one database
+        std::string filename;
+        size_t weight = 0;
+        size_t share = 0;       // part of max_memory() guaranteed by weight
+        size_t used_size = 0;
+        size_t hit_count = 0;
+        size_t miss_count = 0;
+        size_t reclaimed = 0;   // blocks evicted for other databases
+    };
+    using vector_member_stat = std::vector<member_stat>;
+    explicit pool_group(size_t max_memory);
+    ~pool_group();
+    size_t max_memory() const {
+        return m_max_memory;
+    }
+    size_t used_size() const {
+        return m_used_size.load(std::memory_order_relaxed);
+    }
+    bool overflow() const {
+        return used_size() >= m_max_memory;
+    }
+    size_t member_count() const;
+    size_t share(size_t weight) const; // part of max_memory() for weight
+    vector_member_stat statistics() const;
+private:
+    friend class pool_budget;
+    friend class page_bpool;
+    struct member {
+        page_bpool * pool;
+        std::string filename;
+        size_t weight;
+        pool_budget const * budget;
+        size_t reclaimed;
+    };
+    void attach(page_bpool *, pool_budget const *, std::string const & filename, size_t weight);
+    void detach(page_bpool *, size_t used_size); // memory of page pool is not counted after detach
+    void add(size_t const s) {
+        m_used_size.fetch_add(s, std::memory_order_relaxed);
+    }
+    void sub(size_t const s) {
+        SDL_ASSERT(s <= used_size());
+        m_used_size.fetch_sub(s, std::memory_order_relaxed);
+    }
+    size_t reclaim(pool_budget const * requester); // evicts blocks of database most above its share, returns number of blocks
+private:
+    size_t const m_max_memory;
+    std::atomic<size_t> m_used_size{0};
+    std::atomic<size_t> m_total_weight{0};
+    mutable std::mutex m_mutex;
+    std::vector<member> m_member;
+};
+
+}}} // sdl
+
+#endif // __SDL_BPOOL_POOL_GROUP_H__
@@ -0,0 +1,84 @@
+// pressure.cpp
+//
+#include "dataserver/bpool/pressure.h"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+namespace sdl { namespace db { namespace bpool {
+
+bool memory_pressure::parse(std::string const & text, double & avg10)
+{
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 5, "some ")) {
+            continue;
+        }
+        const size_t pos = line.find("avg10=");
+        if (pos == std::string::npos) {
+            return false;
+        }
+        const char * const first = line.c_str() + pos + 6;
+        char * last = nullptr;
+        const double value = std::strtod(first, &last);
+        if ((last == first) || (value < 0)) {
+            return false;
+        }
+        avg10 = value;
+        return true;
+    }
+    return false;
+}
+
+bool memory_pressure::read(std::string const & path, double & avg10)
+{
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        return false;
+    }
+    std::ostringstream text;
+    text << in.rdbuf();
+    return parse(text.str(), avg10);
+}
+
+size_t memory_pressure::next_budget(size_t const current,
+                                    size_t const min_size,
+                                    size_t const max_size,
+                                    double const avg10,
+                                    double const limit)
+{
+    SDL_ASSERT(min_size <= max_size);
+    if (avg10 >= limit) {
+        return a_max(min_size, current - a_min(current, current / step));
+    }
+    if (avg10 < limit / 2) {
+        return a_min(max_size, current + max_size / step + 1);
+    }
+    return a_min_max(current, min_size, max_size);
+}
+
+#if SDL_DEBUG
+namespace {
+    class unit_test {
+    public:
+        unit_test() {
+            double avg10 = -1;
+            SDL_ASSERT(memory_pressure::parse("some avg10=12.50 avg60=3.00 avg300=0.50 total=1000\n"
+                "full avg10=1.00 avg60=0.00 avg300=0.00 total=10\n", avg10) && (avg10 == 12.5));
+            SDL_ASSERT(memory_pressure::parse("full avg10=1.00\nsome avg10=0.00 avg60=0.00", avg10) && (avg10 == 0));
+            SDL_ASSERT(!memory_pressure::parse("", avg10));
+            SDL_ASSERT(!memory_pressure::parse("some total=0", avg10));
+            SDL_ASSERT(!memory_pressure::read("", avg10));
+            SDL_ASSERT(memory_pressure::next_budget(800, 100, 1000, 20, 10) == 700); // shrink
+            SDL_ASSERT(memory_pressure::next_budget(110, 100, 1000, 20, 10) == 100); // not below min
+            SDL_ASSERT(memory_pressure::next_budget(700, 100, 1000, 7, 10) == 700); // hold
+            SDL_ASSERT(memory_pressure::next_budget(700, 100, 1000, 1, 10) == 826); // grow
+            SDL_ASSERT(memory_pressure::next_budget(990, 100, 1000, 0, 10) == 1000); // not above max
+        }
+    };
+    static unit_test s_test;
+}
+#endif // SDL_DEBUG
+
+}}} // sdl
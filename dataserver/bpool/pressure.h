@@ -0,0 +1,23 @@
+// pressure.h
+//
+#pragma once
+#ifndef __SDL_BPOOL_PRESSURE_H__
+#define __SDL_BPOOL_PRESSURE_H__
+
+#include "dataserver/common/common.h"
+
+namespace sdl { namespace db { namespace bpool {
+
+// memory pressure of Linux PSI file (/proc/pressure/memory or memory.pressure of cgroup v2);
+// line "some avg10=..." is percent of time some tasks were stalled on memory during last 10 seconds
+struct memory_pressure final : is_static {
+    enum { step = 8 }; // pool budget is changed by 1/step
+    static bool parse(std::string const &, double & avg10); // false if format is unexpected
+    static bool read(std::string const & path, double & avg10); // false if file is missing
+    // budget shrinks under pressure (avg10 >= limit) and grows back to max_size if pressure is below limit / 2
+    static size_t next_budget(size_t current, size_t min_size, size_t max_size, double avg10, double limit);
+};
+
+}}} // sdl
+
+#endif // __SDL_BPOOL_PRESSURE_H__
@@ -0,0 +1,163 @@
+// readahead.cpp
+//
+#include "dataserver/bpool/readahead.h"
+
+namespace sdl { namespace db { namespace bpool {
+
+readahead_t::range_t
+readahead_t::access(block32 const realBlock, block32 const max_window)
+{
+    if (realBlock == m_last) { // same block
+        return {};
+    }
+    const bool sequential = (realBlock == m_last + 1) || // allow small gaps inside read-ahead window
+        (m_window && (m_last < realBlock) && (realBlock < m_ahead));
+    m_last = realBlock;
+    if (!sequential || !max_window) {
+        m_ahead = m_window = 0;
+        return {};
+    }
+    m_window = m_window ? a_min(m_window * 2, max_window) : a_min(block32(min_window), max_window);
+    set_max(m_ahead, realBlock + 1);
+    if (m_ahead - realBlock - 1 <= m_window / 2) { // look-ahead is below half of window
+        const range_t result(m_ahead, realBlock + 1 + m_window);
+        m_ahead = result.second;
+        return result;
+    }
+    return {};
+}
+
+//-----------------------------------------------------------------
+
+readahead_queue::readahead_queue(size_t const max_size)
+    : m_max_size(max_size)
+    , m_ring(max_size)
+{
+    SDL_ASSERT(m_max_size);
+}
+
+size_t readahead_queue::push(block32 first, block32 const last)
+{
+    SDL_ASSERT(first <= last);
+    size_t count = 0;
+    {
+        lock_guard lock(m_mutex);
+        for (; (first < last) && (m_size < m_max_size); ++first, ++count) {
+            m_ring[(m_head + m_size++) % m_max_size] = first;
+        }
+    }
+    if (count) {
+        m_cv.notify_one();
+    }
+    return count;
+}
+
+bool readahead_queue::pop(block32 & result)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_cv.wait(lock, [this]{
+            return m_shutdown || m_size;
+        });
+        if (m_shutdown) {
+            return false;
+        }
+        SDL_ASSERT(m_size);
+        result = m_ring[m_head];
+        m_head = (m_head + 1) % m_max_size;
+        --m_size;
+        if (result) { // skip cancelled block
+            return true;
+        }
+    }
+}
+
+bool readahead_queue::pop(block32 & first, block32 & count, size_t const max_count)
+{
+    SDL_ASSERT(max_count);
+    if (!pop(first)) {
+        return false;
+    }
+    count = 1;
+    lock_guard lock(m_mutex);
+    while (m_size && (count < max_count) && (m_ring[m_head] == first + count)) {
+        m_head = (m_head + 1) % m_max_size;
+        --m_size;
+        ++count;
+    }
+    return true;
+}
+
+size_t readahead_queue::cancel(block32 const realBlock)
+{
+    SDL_ASSERT(realBlock);
+    size_t count = 0;
+    lock_guard lock(m_mutex);
+    for (size_t i = 0; i < m_size; ++i) {
+        block32 & b = m_ring[(m_head + i) % m_max_size];
+        if (b == realBlock) {
+            b = 0; // skipped by pop
+            ++count;
+        }
+    }
+    return count;
+}
+
+void readahead_queue::shutdown()
+{
+    {
+        lock_guard lock(m_mutex);
+        m_shutdown = true;
+    }
+    m_cv.notify_all();
+}
+
+#if SDL_DEBUG
+namespace {
+    class unit_test {
+    public:
+        unit_test() {
+            {
+                readahead_t test;
+                SDL_ASSERT(test.access(10, 8) == readahead_t::range_t());
+                SDL_ASSERT(test.access(11, 8) == readahead_t::range_t(12, 14));
+                SDL_ASSERT(test.access(11, 8) == readahead_t::range_t()); // same block
+                SDL_ASSERT(test.access(12, 8) == readahead_t::range_t(14, 17));
+                SDL_ASSERT(test.access(13, 8) == readahead_t::range_t(17, 22));
+                SDL_ASSERT(test.window() == 8);
+                SDL_ASSERT(test.access(15, 8) == readahead_t::range_t()); // gap inside window
+                SDL_ASSERT(test.access(16, 8) == readahead_t::range_t());
+                SDL_ASSERT(test.access(17, 8) == readahead_t::range_t(22, 26));
+                SDL_ASSERT(test.window() == 8);
+                SDL_ASSERT(test.access(5, 8) == readahead_t::range_t()); // random access
+                SDL_ASSERT(!test.window());
+                SDL_ASSERT(test.access(6, 0) == readahead_t::range_t()); // disabled
+            }
+            {
+                readahead_queue test(4);
+                SDL_ASSERT(test.push(1, 3) == 2);
+                SDL_ASSERT(test.push(3, 10) == 2);
+                block_index::block32 b = 0;
+                SDL_ASSERT(test.pop(b) && (b == 1));
+                SDL_ASSERT(test.pop(b) && (b == 2));
+                SDL_ASSERT(test.push(7, 8) == 1);
+                SDL_ASSERT(test.cancel(4) == 1);
+                SDL_ASSERT(test.pop(b) && (b == 3));
+                SDL_ASSERT(test.pop(b) && (b == 7));
+                block_index::block32 n = 0;
+                SDL_ASSERT(test.push(20, 23) == 3);
+                SDL_ASSERT(test.push(30, 31) == 1);
+                SDL_ASSERT(test.pop(b, n, 2) && (b == 20) && (n == 2));
+                SDL_ASSERT(test.pop(b, n, 8) && (b == 22) && (n == 1));
+                SDL_ASSERT(test.pop(b, n, 8) && (b == 30) && (n == 1));
+                test.shutdown();
+                SDL_ASSERT(!test.pop(b));
+            }
+            SDL_TRACE_FUNCTION;
+        }
+    };
+    static unit_test s_test;
+}
+#endif // SDL_DEBUG
+
+}}} // sdl
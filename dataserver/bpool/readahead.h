@@ -0,0 +1,59 @@
+// readahead.h
+//
+#pragma once
+#ifndef __SDL_BPOOL_READAHEAD_H__
+#define __SDL_BPOOL_READAHEAD_H__
+
+#include "dataserver/bpool/block_head.h"
+#include <mutex>
+#include <condition_variable>
+
+namespace sdl { namespace db { namespace bpool {
+
+// sequential access detector, owned by one thread;
+// window grows twice on each sequential block up to max_window
+class readahead_t {
+    using block32 = block_index::block32;
+public:
+    using range_t = std::pair<block32, block32>; // [first, second)
+    enum { min_window = 2 };
+    range_t access(block32 realBlock, block32 max_window);
+    block32 window() const {
+        return m_window;
+    }
+    void reset() {
+        m_last = m_ahead = m_window = 0;
+    }
+private:
+    block32 m_last = 0;     // last accessed block
+    block32 m_ahead = 0;    // first block not requested for read-ahead
+    block32 m_window = 0;   // current read-ahead window
+};
+
+// blocks requested for read-ahead; thread safe, bounded
+class readahead_queue : noncopyable {
+    using block32 = block_index::block32;
+public:
+    explicit readahead_queue(size_t max_size);
+    size_t max_size() const {
+        return m_max_size;
+    }
+    size_t push(block32 first, block32 last); // returns number of queued blocks
+    bool pop(block32 &); // waits for block or shutdown
+    bool pop(block32 & first, block32 & count, size_t max_count); // waits for range of adjacent blocks
+    size_t cancel(block32); // block is not needed any more
+    void shutdown();
+private:
+    using lock_guard = std::lock_guard<std::mutex>;
+    size_t const m_max_size;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<block32> m_ring;
+    size_t m_head = 0;
+    size_t m_size = 0;
+    bool m_shutdown = false;
+};
+
+}}} // sdl
+
+#endif // __SDL_BPOOL_READAHEAD_H__
@@ -0,0 +1,531 @@
+// shared_cache.cpp
+//
+#include "dataserver/bpool/shared_cache.h"
+#include "dataserver/bpool/warm.h"
+#include <chrono>
+
+#if defined(SDL_OS_UNIX)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace sdl { namespace db { namespace bpool {
+
+// segment memory is zero filled by ftruncate; zero is valid value of lock-free atomics below
+struct shared_page_cache::segment_head {
+    static constexpr uint64 magic_value = 0x45484341435F4453; // "SD_CACHE"
+    std::atomic<uint64> magic;  // stored last by creator
+    uint64 filesize;
+    uint64 segment_size;
+    uint32 block_size;
+    uint32 block_count;         // file blocks
+    uint32 slot_count;
+    warm_header file;           // size and LSN of header pages of database file (see warm_file::make_header)
+    std::atomic<uint32> attach; // opened by processes
+    std::atomic<uint32> clock;  // hand of eviction
+    std::atomic<uint32> used;
+    std::atomic<uint64> hit;
+    std::atomic<uint64> miss;
+};
+
+struct shared_page_cache::slot_head {
+    enum state_t : uint32 { free_, loading, ready, evicting };
+    std::atomic<uint32> block; // file block + 1, 0 if slot is free
+    std::atomic<uint32> state;
+    std::atomic<uint32> pin;   // page locks of all processes
+    std::atomic<uint32> ref;   // second chance of clock
+};
+
+namespace {
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "shared_page_cache");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared_page_cache");
+
+enum { segment_align = 4096 };
+
+inline size_t align_segment(size_t const size) {
+    return round_up_div(size, (size_t)segment_align) * segment_align;
+}
+
+using steady_clock = std::chrono::steady_clock;
+
+inline bool wait_expired(steady_clock::time_point const start, size_t const seconds) {
+    return (steady_clock::now() - start) > std::chrono::seconds(seconds);
+}
+
+inline size_t pages_count(uint8 pages) { // number of locked pages in block
+    size_t count = 0;
+    for (; pages; pages &= pages - 1) {
+        ++count;
+    }
+    return count;
+}
+
+std::string segment_name(std::string const & name) {
+    if (!name.empty() && (name[0] != '/')) {
+        return "/" + name;
+    }
+    return name;
+}
+
+// segment of changed database file is not used (same check as warm-start)
+warm_header file_header(PagePoolFile & file, size_t const page_count) {
+    std::vector<char> buf(pool_limits::page_size * 2);
+    page_head const * const fileheader = reinterpret_cast<page_head const *>(buf.data());
+    page_head const * boot = nullptr;
+    file.read(buf.data(), 0, pool_limits::page_size);
+    if (page_count > warm_file::boot_page) {
+        file.read(buf.data() + pool_limits::page_size, warm_file::boot_page * pool_limits::page_size, pool_limits::page_size);
+        boot = reinterpret_cast<page_head const *>(buf.data() + pool_limits::page_size);
+    }
+    return warm_file::make_header(file.filesize(), fileheader, boot);
+}
+
+} // namespace
+
+shared_page_cache::shared_page_cache(const std::string & fname, database_cfg const & cfg)
+    : init_thread_id(std::this_thread::get_id())
+    , m_file(fname)
+    , m_name(segment_name(cfg.pool_shared))
+    , m_page_count(m_file.filesize() / page_head::page_size)
+    , m_block_count(round_up_div(m_file.filesize(), (size_t)pool_limits::block_size))
+    , m_thread_id(m_file.filesize())
+    , m_fixed(m_file.filesize())
+{
+    static_assert(sizeof(slot_head) == 16, "");
+    if (!m_file.is_open() || !m_page_count) {
+        throw_error_t<shared_page_cache>("bad database file");
+    }
+    if (m_name.size() < 2) {
+        throw_error_t<shared_page_cache>("bad segment name");
+    }
+    if (m_file.filesize() > pool_limits::max_filesize) {
+        throw_error_t<shared_page_cache>("bad filesize");
+    }
+    try {
+        open_segment(cfg);
+    }
+    catch (...) {
+        close_segment();
+        throw;
+    }
+}
+
+shared_page_cache::~shared_page_cache()
+{
+    close_segment();
+}
+
+// pins of this process are released; segment which is not ready is removed by its creator
+void shared_page_cache::close_segment()
+{
+#if defined(SDL_OS_UNIX)
+    if (m_head) {
+        release_all(m_fixed);
+        m_thread_id.for_each([this](thread_id, thread_mask_t & mask){
+            release_all(mask);
+        });
+        m_head->attach.fetch_sub(1);
+        m_head = nullptr;
+    }
+    else if (m_creator) {
+        remove(m_name);
+    }
+    if (m_base) {
+        ::munmap(m_base, m_size);
+        m_base = nullptr;
+    }
+    if (m_fd != -1) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+#endif
+}
+
+bool shared_page_cache::is_open() const
+{
+    return m_head != nullptr;
+}
+
+bool shared_page_cache::supported()
+{
+#if defined(SDL_OS_UNIX)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool shared_page_cache::remove(const std::string & name)
+{
+#if defined(SDL_OS_UNIX)
+    const std::string s = segment_name(name);
+    return !s.empty() && !::shm_unlink(s.c_str());
+#else
+    SDL_ASSERT(!name.empty());
+    return false;
+#endif
+}
+
+// creator sizes segment and stores magic when segment is ready, other processes wait for magic;
+// slot count of existing segment is used, file size and LSN of header pages must match
+void shared_page_cache::open_segment(database_cfg const & cfg)
+{
+#if defined(SDL_OS_UNIX)
+    const warm_header file = file_header(m_file, m_page_count);
+    const size_t max_memory = cfg.max_memory ? cfg.max_memory : m_file.filesize();
+    const size_t slot_count = a_min_max(max_memory / pool_limits::block_size,
+        size_t(16), a_max(m_block_count, size_t(16)));
+    m_fd = ::shm_open(m_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (m_fd != -1) {
+        m_creator = true;
+        m_size = align_segment(sizeof(segment_head))
+            + align_segment(m_block_count * sizeof(std::atomic<uint32>))
+            + align_segment(slot_count * sizeof(slot_head))
+            + slot_count * pool_limits::block_size;
+        if (::ftruncate(m_fd, static_cast<off_t>(m_size))) {
+            throw_error_t<shared_page_cache>("ftruncate failed");
+        }
+    }
+    else {
+        if (errno != EEXIST) {
+            throw_error_t<shared_page_cache>("shm_open failed");
+        }
+        m_fd = ::shm_open(m_name.c_str(), O_RDWR, 0600);
+        if (m_fd == -1) {
+            throw_error_t<shared_page_cache>("shm_open failed");
+        }
+        const auto start = steady_clock::now();
+        for (;;) { // creator may not have sized segment yet
+            struct stat st;
+            if (::fstat(m_fd, &st)) {
+                throw_error_t<shared_page_cache>("fstat failed");
+            }
+            if (st.st_size > 0) {
+                m_size = static_cast<size_t>(st.st_size);
+                break;
+            }
+            if (wait_expired(start, wait_timeout)) {
+                throw_error_t<shared_page_cache>("segment is not created");
+            }
+            std::this_thread::yield();
+        }
+    }
+    void * const p = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (p == MAP_FAILED) {
+        throw_error_t<shared_page_cache>("mmap failed");
+    }
+    m_base = static_cast<char *>(p);
+    segment_head * const head = reinterpret_cast<segment_head *>(m_base);
+    if (m_creator) {
+        head->filesize = m_file.filesize();
+        head->segment_size = m_size;
+        head->block_size = pool_limits::block_size;
+        head->block_count = static_cast<uint32>(m_block_count);
+        head->slot_count = static_cast<uint32>(slot_count);
+        head->file = file;
+    }
+    else {
+        const auto start = steady_clock::now();
+        while (head->magic.load(std::memory_order_acquire) != segment_head::magic_value) {
+            if (wait_expired(start, wait_timeout)) {
+                throw_error_t<shared_page_cache>("segment is not ready");
+            }
+            std::this_thread::yield();
+        }
+        if ((head->filesize != m_file.filesize()) ||
+            (head->segment_size != m_size) ||
+            (head->block_size != pool_limits::block_size) ||
+            !warm_file::equal(head->file, file)) { // stale segment must be removed (shared_page_cache::remove)
+            throw_error_t<shared_page_cache>("segment does not match database file");
+        }
+    }
+    m_map = reinterpret_cast<std::atomic<uint32> *>(m_base + align_segment(sizeof(segment_head)));
+    m_slot = reinterpret_cast<slot_head *>(reinterpret_cast<char *>(m_map) + align_segment(m_block_count * sizeof(std::atomic<uint32>)));
+    m_arena = reinterpret_cast<char *>(m_slot) + align_segment(head->slot_count * sizeof(slot_head));
+    SDL_ASSERT(m_arena + head->slot_count * size_t(pool_limits::block_size) == m_base + m_size);
+    if (m_creator) {
+        init_segment(head, slot_count);
+        head->magic.store(segment_head::magic_value, std::memory_order_release);
+    }
+    head->attach.fetch_add(1);
+    m_head = head;
+#else
+    (void)cfg;
+    throw_error_t<shared_page_cache>("shared memory is not supported");
+#endif
+}
+
+void shared_page_cache::init_segment(segment_head * const head, size_t const slot_count)
+{
+    SDL_ASSERT(m_creator && (slot_count == head->slot_count));
+    SDL_ASSERT(slot_count && m_block_count);
+    slot_head & zero = m_slot[0]; // zero block must be always in memory
+    m_file.read(m_arena, 0, a_min(m_file.filesize(), (size_t)pool_limits::block_size));
+    zero.block.store(1);
+    zero.pin.store(1); // never released
+    zero.state.store(slot_head::ready);
+    m_map[0].store(1);
+    head->used.store(1);
+    head->clock.store(1);
+}
+
+char * shared_page_cache::slot_data(uint32 const slot) const
+{
+    SDL_ASSERT(slot < m_head->slot_count);
+    return m_arena + size_t(slot) * pool_limits::block_size;
+}
+
+// slot is claimed for new block: free slot or unpinned ready slot after second chance;
+// state evicting excludes other evictors, pin is checked after state is changed (seq_cst),
+// so process which pins slot concurrently either sees evicting state or stops eviction
+uint32 shared_page_cache::evict()
+{
+    const uint32 slot_count = m_head->slot_count;
+    const size_t max_step = size_t(slot_count) * 4;
+    for (size_t step = 0; step < max_step; ++step) {
+        const uint32 i = m_head->clock.fetch_add(1, std::memory_order_relaxed) % slot_count;
+        slot_head & x = m_slot[i];
+        uint32 st = x.state.load();
+        if (st == slot_head::free_) {
+            if (x.state.compare_exchange_strong(st, slot_head::evicting)) {
+                m_head->used.fetch_add(1, std::memory_order_relaxed);
+                return i;
+            }
+        }
+        else if (st == slot_head::ready) {
+            if (x.pin.load()) {
+                continue;
+            }
+            if (x.ref.exchange(0, std::memory_order_relaxed)) {
+                continue;
+            }
+            if (x.state.compare_exchange_strong(st, slot_head::evicting)) {
+                if (x.pin.load()) { // pinned concurrently
+                    x.state.store(slot_head::ready);
+                    continue;
+                }
+                const uint32 old = x.block.load();
+                SDL_ASSERT(old > 1); // zero block is never evicted
+                uint32 expect = i + 1;
+                m_map[old - 1].compare_exchange_strong(expect, 0);
+                x.block.store(0);
+                return i;
+            }
+        }
+    }
+    throw_error_t<shared_page_cache>("all slots are pinned");
+    return 0;
+}
+
+// slot of block is pinned (pin + 1) and ready; block missing in segment is loaded by this thread,
+// concurrent loaders of the same block agree by compare-exchange of block table
+uint32 shared_page_cache::acquire(uint32 const realBlock)
+{
+    SDL_ASSERT(realBlock < m_block_count);
+    std::atomic<uint32> & map = m_map[realBlock];
+    const uint32 key = realBlock + 1;
+    for (;;) {
+        const uint32 s = map.load();
+        if (s) {
+            slot_head & x = m_slot[s - 1];
+            x.pin.fetch_add(1);
+            if (x.block.load() == key) {
+                uint32 st = x.state.load();
+                if (st == slot_head::loading) {
+                    const auto start = steady_clock::now();
+                    size_t spin = 0;
+                    while ((st = x.state.load()) == slot_head::loading) {
+                        if (!(++spin % 1024) && wait_expired(start, wait_timeout)) {
+                            x.pin.fetch_sub(1);
+                            throw_error_t<shared_page_cache>("block is not loaded");
+                        }
+                        std::this_thread::yield();
+                    }
+                }
+                if ((st == slot_head::ready) && (x.block.load() == key)) {
+                    x.ref.store(1, std::memory_order_relaxed);
+                    m_head->hit.fetch_add(1, std::memory_order_relaxed);
+                    return s - 1;
+                }
+            }
+            x.pin.fetch_sub(1); // slot was reused or load failed
+            std::this_thread::yield();
+            continue;
+        }
+        const uint32 i = evict();
+        slot_head & x = m_slot[i];
+        SDL_ASSERT(x.state.load() == slot_head::evicting);
+        x.pin.fetch_add(1);
+        x.block.store(key);
+        x.state.store(slot_head::loading);
+        uint32 expect = 0;
+        if (!map.compare_exchange_strong(expect, i + 1)) { // loaded by other process
+            x.block.store(0);
+            x.pin.fetch_sub(1);
+            x.state.store(slot_head::free_);
+            m_head->used.fetch_sub(1, std::memory_order_relaxed);
+            continue;
+        }
+        try {
+            const size_t offset = size_t(realBlock) * pool_limits::block_size;
+            m_file.read(slot_data(i), offset, a_min(m_file.filesize() - offset, (size_t)pool_limits::block_size));
+        }
+        catch (...) {
+            expect = i + 1;
+            map.compare_exchange_strong(expect, 0);
+            x.block.store(0);
+            x.pin.fetch_sub(1);
+            x.state.store(slot_head::free_);
+            m_head->used.fetch_sub(1, std::memory_order_relaxed);
+            throw;
+        }
+        x.ref.store(1, std::memory_order_relaxed);
+        x.state.store(slot_head::ready);
+        m_head->miss.fetch_add(1, std::memory_order_relaxed);
+        return i;
+    }
+}
+
+void shared_page_cache::release(uint32 const slot, size_t const pin_count)
+{
+    SDL_ASSERT(slot < m_head->slot_count);
+    SDL_ASSERT(m_slot[slot].pin.load() >= pin_count);
+    m_slot[slot].pin.fetch_sub(static_cast<uint32>(pin_count));
+}
+
+// pinned slot keeps its block table entry, so slot of locked block is found without pin
+void shared_page_cache::release_all(thread_mask_t const & mask)
+{
+    mask.for_each_block([this](size_t const blockId, uint8 const pages){
+        const uint32 s = m_map[blockId].load();
+        SDL_ASSERT(s);
+        if (s) {
+            release(s - 1, pages_count(pages));
+        }
+    });
+}
+
+page_head const *
+shared_page_cache::page_address(uint32 const slot, pageIndex const pageId) const
+{
+    SDL_ASSERT(m_slot[slot].block.load() == pageId.value() / pool_limits::block_page_num + 1);
+    return reinterpret_cast<page_head const *>(slot_data(slot) + page_bit(pageId) * page_head::page_size);
+}
+
+page_head const *
+shared_page_cache::lock_page(pageIndex const pageId)
+{
+    SDL_ASSERT(pageId.value() < m_page_count);
+    if (pageId.value() >= m_page_count) {
+        throw_error_t<shared_page_cache>("page not found");
+    }
+    const uint32 realBlock = static_cast<uint32>(pageId.value() / pool_limits::block_page_num);
+    if (!realBlock) { // zero block is never evicted
+        return page_address(0, pageId);
+    }
+    const auto this_thread = std::this_thread::get_id();
+    if (is_init_thread(this_thread)) {
+        return lock_page_fixed(pageId);
+    }
+    thread_mask_t & mask = *m_thread_id.insert(this_thread);
+    if (mask.is_page(realBlock, page_bit(pageId))) { // slot is pinned by this thread
+        m_head->hit.fetch_add(1, std::memory_order_relaxed);
+        return page_address(m_map[realBlock].load() - 1, pageId);
+    }
+    const uint32 s = acquire(realBlock);
+    mask.set_page(realBlock, page_bit(pageId));
+    return page_address(s, pageId);
+}
+
+page_head const *
+shared_page_cache::lock_page_fixed(pageIndex const pageId)
+{
+    SDL_ASSERT(pageId.value() < m_page_count);
+    if (pageId.value() >= m_page_count) {
+        throw_error_t<shared_page_cache>("page not found");
+    }
+    const uint32 realBlock = static_cast<uint32>(pageId.value() / pool_limits::block_page_num);
+    if (!realBlock) {
+        return page_address(0, pageId);
+    }
+    std::lock_guard<std::mutex> lock(m_fixed_mutex);
+    if (m_fixed.is_page(realBlock, page_bit(pageId))) {
+        m_head->hit.fetch_add(1, std::memory_order_relaxed);
+        return page_address(m_map[realBlock].load() - 1, pageId);
+    }
+    const uint32 s = acquire(realBlock);
+    m_fixed.set_page(realBlock, page_bit(pageId));
+    return page_address(s, pageId);
+}
+
+bool shared_page_cache::unlock_page(pageIndex const pageId)
+{
+    SDL_ASSERT(pageId.value() < m_page_count);
+    const uint32 realBlock = static_cast<uint32>(pageId.value() / pool_limits::block_page_num);
+    if (!realBlock) {
+        return false;
+    }
+    const auto this_thread = std::this_thread::get_id();
+    if (is_init_thread(this_thread)) {
+        return false;
+    }
+    thread_mask_t * const mask = m_thread_id.find(this_thread);
+    if (!mask || !mask->clr_page(realBlock, page_bit(pageId))) {
+        return false;
+    }
+    const uint32 s = m_map[realBlock].load();
+    SDL_ASSERT(s);
+    release(s - 1, 1);
+    return !mask->is_block(realBlock);
+}
+
+size_t shared_page_cache::unlock_thread(thread_id const id, removef const f)
+{
+    if (is_init_thread(id)) {
+        SDL_ASSERT(!"unlock_thread");
+        return 0;
+    }
+    if (id != std::this_thread::get_id()) { // mask of other thread is changed by its lock_page without lock
+        SDL_ASSERT(!"unlock_thread");
+        return 0;
+    }
+    thread_mask_t * const mask = m_thread_id.find(id);
+    if (!mask) {
+        return 0;
+    }
+    const size_t count = mask->block_count();
+    release_all(*mask);
+    if (is_remove(f)) {
+        m_thread_id.erase(id);
+    }
+    else {
+        mask->clear();
+    }
+    return count;
+}
+
+shared_page_cache::stat_t
+shared_page_cache::statistics() const
+{
+    stat_t s;
+    if (m_head) {
+        s.slot_count = m_head->slot_count;
+        s.used = m_head->used.load(std::memory_order_relaxed);
+        s.hit = static_cast<size_t>(m_head->hit.load(std::memory_order_relaxed));
+        s.miss = static_cast<size_t>(m_head->miss.load(std::memory_order_relaxed));
+        s.attach = m_head->attach.load(std::memory_order_relaxed);
+        s.creator = m_creator;
+    }
+    return s;
+}
+
+size_t shared_page_cache::used_size() const
+{
+    return statistics().used * size_t(pool_limits::block_size);
+}
+
+}}} // sdl
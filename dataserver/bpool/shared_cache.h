@@ -0,0 +1,90 @@
+// shared_cache.h
+//
+#pragma once
+#ifndef __SDL_BPOOL_SHARED_CACHE_H__
+#define __SDL_BPOOL_SHARED_CACHE_H__
+
+#include "dataserver/bpool/flag_type.h"
+#include "dataserver/bpool/thread_id.h"
+#include "dataserver/bpool/file.h"
+#include "dataserver/system/database_cfg.h"
+
+namespace sdl { namespace db { namespace bpool {
+
+// page cache of read-only database file shared by processes in named POSIX shared memory segment;
+// segment holds block table (file block => slot), slot heads and arena of 64 KB slots;
+// processes coordinate loads and eviction with lock-free atomics of the segment (no process-shared mutex),
+// page locks of threads are tracked per process and counted in slot pin (pinned slot is never evicted);
+// zero block is loaded by creator of segment and never evicted;
+// segment outlives processes (warm restart), it is removed with shared_page_cache::remove;
+// segment is rejected if database file is changed (file size or LSN of header pages, as warm-start checks);
+// pins and loads of crashed process are not recovered, such segment must be removed
+class shared_page_cache : noncopyable {
+    using thread_id = std::thread::id;
+public:
+    const thread_id init_thread_id;
+    struct stat_t {
+        size_t slot_count = 0;
+        size_t used = 0;     // slots with file blocks
+        size_t hit = 0;      // all processes
+        size_t miss = 0;     // blocks read by all processes
+        size_t attach = 0;   // processes which opened segment
+        bool creator = false; // segment was created by this process
+    };
+    shared_page_cache(const std::string & fname, database_cfg const &); // cfg.pool_shared is segment name
+    ~shared_page_cache();
+    bool is_open() const;
+    size_t page_count() const {
+        return m_page_count;
+    }
+    size_t file_size() const {
+        return m_file.filesize();
+    }
+    page_head const * lock_page(pageIndex); // pages of init thread are fixed
+    page_head const * lock_page_fixed(pageIndex); // page is pinned until close
+    bool unlock_page(pageIndex); // return true if slot is not pinned by this process
+    size_t unlock_thread(thread_id, removef); // thread_id must be calling thread (thread mask is not locked)
+    size_t unlock_thread(removef f) {
+        return unlock_thread(std::this_thread::get_id(), f);
+    }
+    stat_t statistics() const;
+    size_t used_size() const;
+    static bool supported();
+    static bool remove(const std::string & name); // shm_unlink
+private:
+    struct segment_head;
+    struct slot_head;
+    enum { wait_timeout = 10 }; // seconds, wait for segment creator or block loaded by other process
+    bool is_init_thread(thread_id const id) const {
+        return this->init_thread_id == id;
+    }
+    void open_segment(database_cfg const &);
+    void init_segment(segment_head *, size_t slot_count);
+    void close_segment();
+    uint32 acquire(uint32 realBlock); // slot is pinned and loaded
+    uint32 evict(); // free slot is claimed
+    void release(uint32 slot, size_t pin_count);
+    void release_all(thread_mask_t const &);
+    page_head const * page_address(uint32 slot, pageIndex) const;
+    char * slot_data(uint32 slot) const;
+private:
+    PagePoolFile m_file;
+    std::string const m_name;
+    size_t const m_page_count;
+    size_t const m_block_count;
+    int m_fd = -1;
+    size_t m_size = 0;
+    char * m_base = nullptr;
+    segment_head * m_head = nullptr;
+    std::atomic<uint32> * m_map = nullptr; // file block => slot + 1
+    slot_head * m_slot = nullptr;
+    char * m_arena = nullptr;
+    bool m_creator = false;
+    thread_id_t m_thread_id;
+    std::mutex m_fixed_mutex;
+    thread_mask_t m_fixed; // pages pinned until close
+};
+
+}}} // sdl
+
+#endif // __SDL_BPOOL_SHARED_CACHE_H__
@@ -5,102 +5,171 @@
 namespace sdl { namespace db { namespace bpool { 
 
 thread_mask_t::thread_mask_t(size_t const filesize)
-    : m_index_count(round_up_div(filesize, index_size))
-    , m_block_count(round_up_div(filesize, (size_t)block_size))
+    : m_block_count(round_up_div(filesize, (size_t)pool_limits::block_size))
 {
-    SDL_ASSERT(m_index_count <= max_index);
     SDL_ASSERT(m_block_count <= pool_limits::max_block);
-    static_assert(index_block_num == 8192, "");
-    static_assert(!(index_block_num % mask_div), "");
-    static_assert(sizeof(mask_t) == 1024, "");
-    m_index.resize(m_index_count);
+    static_assert(is_power_2<min_capacity>::value, "");
+    static_assert(sizeof(entry) == 8, "");
 }
 
-void thread_mask_t::shrink_to_fit() {
-    for (mask_p & p : m_index) {
-        if (p && empty(*p)) {
-            p.reset();
+void thread_mask_t::erase_entry(entry * const p) {
+    SDL_ASSERT(m_count && p && p->key);
+    size_t const mask = m_data.size() - 1;
+    size_t hole = static_cast<size_t>(p - m_data.data());
+    SDL_ASSERT(hole <= mask);
+    for (size_t k = (hole + 1) & mask; m_data[k].key; k = (k + 1) & mask) {
+        size_t const home = slot(m_data[k].key);
+        if (((k - home) & mask) >= ((k - hole) & mask)) { // entry k may be moved back to hole
+            m_data[hole] = m_data[k];
+            hole = k;
         }
     }
+    m_data[hole].key = 0;
+    m_data[hole].pages = 0;
+    --m_count;
 }
 
-void thread_mask_t::clear() {
-    for (mask_p & p : m_index) {
-        p.reset();
+void thread_mask_t::rehash(size_t const capacity) {
+    SDL_ASSERT(m_count * 2 <= capacity);
+    SDL_ASSERT(capacity && !(capacity & (capacity - 1)));
+    data_type old(capacity, entry{0, 0});
+    old.swap(m_data);
+    size_t const mask = capacity - 1;
+    for (entry const & e : old) {
+        if (e.key) {
+            size_t k = slot(e.key);
+            while (m_data[k].key) {
+                k = (k + 1) & mask;
+            }
+            m_data[k] = e;
+        }
     }
 }
 
+void thread_mask_t::shrink_to_fit() {
+    if (!m_count) {
+        clear();
+        return;
+    }
+    size_t capacity = min_capacity;
+    while (m_count * 2 > capacity) {
+        capacity *= 2;
+    }
+    if (capacity < m_data.size()) {
+        rehash(capacity);
+    }
+}
+
+void thread_mask_t::clear() {
+    data_type().swap(m_data);
+    m_count = 0;
+    pin_map().swap(m_pin);
+}
+
 //-------------------------------------------------------------
 
+namespace {
+    struct thread_cache_t {
+        size_t instance = 0; // 0 if cache is empty
+        size_t generation = 0;
+        thread_mask_t * mask = nullptr;
+    };
+    thread_local thread_cache_t t_thread_cache;
+    std::atomic<size_t> s_thread_id_instance(0);
+} // namespace
+
 thread_id_t::thread_id_t(size_t const s)
     : init_thread_id(std::this_thread::get_id())
     , m_filesize(s)
+    , m_instance(++s_thread_id_instance)
     , m_size(0)
+    , m_capacity(0)
+    , m_generation(0)
 {
     SDL_ASSERT(m_filesize);
+    SDL_ASSERT(m_instance);
     SDL_ASSERT(!empty(init_thread_id));
 }
 
-thread_id_t::pos_mask
+thread_id_t::mask_ptr
+thread_id_t::find_cache(thread_id const id) const {
+    if (id == get_id()) {
+        thread_cache_t const & c = t_thread_cache;
+        if ((c.instance == m_instance) && (c.generation == m_generation.load(std::memory_order_acquire))) {
+            SDL_ASSERT(c.mask);
+            return c.mask;
+        }
+    }
+    return nullptr;
+}
+
+void thread_id_t::set_cache(thread_id const id, mask_ptr const value) const {
+    if ((id == get_id()) && value) {
+        thread_cache_t & c = t_thread_cache;
+        c.instance = m_instance;
+        c.generation = m_generation.load(std::memory_order_relaxed);
+        c.mask = value;
+    }
+}
+
+thread_id_t::mask_ptr
 thread_id_t::find(thread_id const id) {
+    if (mask_ptr const cached = find_cache(id)) {
+        return cached;
+    }
+    lock_guard lock(m_mutex);
+    mask_ptr const found = find_nolock(id);
+    set_cache(id, found);
+    return found;
+}
+
+thread_id_t::mask_ptr
+thread_id_t::insert(thread_id const id) {
+    if (mask_ptr const cached = find_cache(id)) {
+        return cached;
+    }
+    lock_guard lock(m_mutex);
+    mask_ptr const found = insert_nolock(id);
+    set_cache(id, found);
+    return found;
+}
+
+thread_id_t::mask_ptr
+thread_id_t::find_nolock(thread_id const id) const {
     SDL_ASSERT(id != init_thread_id);
     SDL_ASSERT(!empty(id));
-    const auto pos = std::find_if(m_data.begin(), m_data.end(), [id](id_mask const & x){
-        SDL_ASSERT(empty(x.first) == !x.second);
-        return (x.first == id);
-    });
+    const auto pos = m_data.find(id);
     if (pos != m_data.end()) {
         SDL_ASSERT(pos->second);
-        const size_t d = static_cast<size_t>(std::distance(m_data.begin(), pos));
-        return { d, pos->second.get() };
+        return pos->second.get();
     }
-    return{ max_thread, nullptr };
+    return nullptr;
 }
 
-thread_id_t::pos_mask
-thread_id_t::insert(thread_id const id) {
+thread_id_t::mask_ptr
+thread_id_t::insert_nolock(thread_id const id) {
     SDL_ASSERT(id != init_thread_id);
     SDL_ASSERT(!empty(id));
-    auto pos = std::find_if(m_data.begin(), m_data.end(), [id](id_mask const & x) {
-        return (x.first == id) || (x.second == nullptr);
-    });
-    if (pos == m_data.end()) {
-        SDL_ASSERT(0); //FIXME: wait until thread is released ?
-        throw_error_t<thread_id_t>("too many threads");
-        return { max_thread, nullptr };
+    unique_mask & p = m_data[id];
+    if (!p) {
+        reset_new(p, m_filesize);
+        ++m_size;
+        m_capacity = static_cast<size_t>(m_data.bucket_count() * m_data.max_load_factor());
+        SDL_TRACE("thread_insert ", id, ", m_size ", m_size);
     }
-    if (pos->first != id) {
-        SDL_ASSERT(empty(pos->first)); // empty slot is found
-        SDL_ASSERT(!pos->second);
-        const auto pos_id = std::find_if(pos + 1, m_data.end(), [id](id_mask const & x) {
-            return (x.first == id);
-        });
-        if (pos_id == m_data.end()) { // use empty slot
-            pos->first = id;
-            reset_new(pos->second, m_filesize);
-            SDL_ASSERT(m_size < (int)max_size());
-            ++m_size;
-            SDL_TRACE("thread_insert ", id, ", m_size ", m_size);
-        }
-        else {
-            pos = pos_id;
-        }
-    }
-    SDL_ASSERT(pos->second);
-    const auto d = static_cast<size_t>(std::distance(m_data.begin(), pos));
-    return { d, pos->second.get() };
+    SDL_ASSERT(m_size == m_data.size());
+    return p.get();
 }
 
 bool thread_id_t::erase(thread_id const id) {
     SDL_ASSERT(id != init_thread_id);
     SDL_ASSERT(!empty(id));
-    const auto pos = std::find_if(m_data.begin(), m_data.end(), [id](id_mask const & x){
-        return (x.first == id);
-    });
+    lock_guard lock(m_mutex);
+    ++m_generation;
+    const auto pos = m_data.find(id);
     if (pos != m_data.end()) {
         SDL_ASSERT(pos->second);
-        pos->first = {};
-        pos->second.reset();
+        m_data.erase(pos);
         SDL_ASSERT(m_size);
         --m_size;
         SDL_TRACE("* thread_erase ", id, ", m_size ", m_size);
@@ -112,15 +181,12 @@ bool thread_id_t::erase(thread_id const id) {
 
 #if SDL_DEBUG
 namespace {
-    inline constexpr uint32_t knuth_hash(uint32_t v) {
-        return (v * UINT32_C(2654435761)) % thread_id_t::max_size();
-    }
     class unit_test {
         void test_thread();
         void test_mask(size_t);
     public:
         unit_test() {
-            static_assert(power_of<64>::value == 6, "");
+            test_mask(gigabyte<1>::value);
             if (0) {
                 test_mask(gigabyte<8>::value);
                 //test_mask(terabyte<1>::value);
@@ -133,32 +199,65 @@ namespace {
                     std::cout << "exception = " << e.what() << std::endl;
                 }
             }
-            if (0) {
-            }
         }
     };
     void unit_test::test_mask(size_t const filesize) {
         thread_mask_t test(filesize);
         for (size_t i = 0; i < test.size(); ++i) {
             SDL_ASSERT(!test[i]);
-            test.set_block(i);
+            SDL_ASSERT(test.set_page(i, i % 8));
+            SDL_ASSERT(!test.set_page(i, i % 8));
             SDL_ASSERT(test[i]);
-            if (i >= 8192)
-                test.clr_block(i);
+            SDL_ASSERT(test.is_page(i, i % 8));
+            SDL_ASSERT(test.block_page(i) == (1 << (i % 8)));
+            if (i >= 8192) {
+                SDL_ASSERT(test.clr_page(i, i % 8));
+                SDL_ASSERT(!test.clr_page(i, i % 8));
+                SDL_ASSERT(!test[i]);
+            }
+        }
+        size_t count = 0;
+        test.for_each_block([&count](size_t const b, uint8 const pages){
+            SDL_ASSERT(b < 8192);
+            SDL_ASSERT(pages == (1 << (b % 8)));
+            ++count;
+        });
+        SDL_ASSERT(count == a_min(test.size(), size_t(8192)));
+        SDL_ASSERT(count == test.block_count());
+        for (size_t i = 0; i < count; i += 2) {
+            test.clr_block(i);
         }
-        test.clr_block(test.size()-1);
+        for (size_t i = 0; i < count; ++i) {
+            SDL_ASSERT(test[i] == ((i % 2) != 0));
+        }
+        size_t const capacity = test.capacity();
         test.shrink_to_fit();
+        SDL_ASSERT(test.capacity() < capacity);
+        SDL_ASSERT(test.block_count() == count / 2);
+        for (size_t i = 1; i < count; i += 2) {
+            SDL_ASSERT(test.block_page(i) == (1 << (i % 8)));
+        }
+        test.add_pin(1, false);
+        test.add_pin(1, false);
+        test.add_pin(2, true);
+        SDL_ASSERT(test.is_pin(1) && test.is_pin(2) && (test.pin_count() == 2));
+        SDL_ASSERT(!test.sub_pin(1));
+        SDL_ASSERT(test.sub_pin(1));
+        SDL_ASSERT(!test.sub_pin(1));
+        SDL_ASSERT(!test.sub_pin(2)); // page was locked before first pin
+        SDL_ASSERT(!test.pin_count());
+        test.clear();
+        SDL_ASSERT(!test.capacity() && !test.block_count());
     }
     void unit_test::test_thread() {
         thread_id_t test(gigabyte<8>::value);
         auto pos = test.insert();
-        SDL_ASSERT(pos.first.value() == test.insert().first.value());
+        SDL_ASSERT(pos == test.insert());
         const auto id = test.get_id();
-        SDL_ASSERT(test.find(id).first.value() < pool_limits::max_thread);
-        SDL_ASSERT(test.find(id).second);
+        SDL_ASSERT(test.find(id) == pos);
         SDL_ASSERT(test.erase(id));
         SDL_ASSERT(!test.erase(id));
-        SDL_ASSERT(!test.find(id).second);
+        SDL_ASSERT(!test.find(id));
         SDL_TRACE_FUNCTION;
     }
     static unit_test s_test;
@@ -5,31 +5,30 @@
 #define __SDL_BPOOL_THREAD_ID_H__
 
 #include "dataserver/bpool/block_head.h"
-#include "dataserver/common/array.h"
 #include <atomic>
 #include <thread>
+#include <mutex>
+#include <unordered_map>
 
 namespace sdl { namespace db { namespace bpool {
 
-class thread_mask_t : noncopyable {
-    static constexpr size_t index_size = megabyte<512>::value; // 2^29, 536,870,912
-    static constexpr size_t max_index = terabyte<1>::value / index_size; // 2048
-    enum { block_size = pool_limits::block_size };
-    enum { chunk_block_num = 64 }; // # of blocks in uint64 mask
-    enum { chunk_size = block_size * chunk_block_num };
-    enum { index_block_num = index_size / block_size }; // 8192 = 128 * 64
-    enum { mask_div = 8 * sizeof(uint64) }; // 64 = 2^6
-    enum { mask_hex = mask_div - 1 };
-    enum { mask_size = index_block_num / mask_div }; // 128, 1 bit per block
-    static_assert(mask_size * chunk_size == index_size, "");
-    using mask_t = array_t<uint64, mask_size>;
-    using mask_p = std::unique_ptr<mask_t>;
-    using data_type = std::vector<mask_p>; //FIXME: custom allocator
+class thread_mask_t : noncopyable { // pages locked by one thread, 8 bits per locked block
+    // open addressing hash of locked blocks (linear probing, backward shift on erase);
+    // memory is proportional to blocks locked by thread, not to file size
+    struct entry {
+        uint32 key; // block + 1, 0 if slot is empty
+        uint8 pages;
+    };
+    enum { min_capacity = 16 }; // power of 2
+    using data_type = std::vector<entry>;
 public:
     explicit thread_mask_t(size_t filesize);
-    bool is_block(size_t) const;
+    bool is_block(size_t) const; // any page of block is locked
+    uint8 block_page(size_t) const; // page bits of block
+    bool is_page(size_t, size_t) const;
+    bool set_page(size_t, size_t); // return true if page was not locked
+    bool clr_page(size_t, size_t); // return true if page was locked
     void clr_block(size_t);
-    void set_block(size_t);
     size_t size() const {
         return m_block_count;
     }
@@ -37,78 +36,80 @@ public:
         SDL_ASSERT(i < size());
         return is_block(i);
     }
-    data_type const & data() const {
-        return m_index;
+    size_t block_count() const { // locked blocks
+        return m_count;
+    }
+    size_t capacity() const {
+        return m_data.size();
     }
     template<class fun_type>
-    void for_each_block(fun_type &&) const;
+    void for_each_block(fun_type &&) const; // fun(block, page bits), order is not defined
     void shrink_to_fit();
-    void clear();
+    void clear(); // memory is released
+    bool is_pin(size_t) const; // page has handles (lock_page_head) of this thread
+    void add_pin(size_t, bool keep); // keep: page was locked by this thread before first pin
+    bool sub_pin(size_t); // return true if last pin is released and page must be unlocked
+    size_t pin_count() const { // pinned pages
+        return m_pin.size();
+    }
 private:
-    bool empty(mask_t const &) const;
+    size_t slot(uint32 key) const; // first slot of key
+    entry * find_entry(size_t) const;
+    entry & get_entry(size_t);
+    void erase_entry(entry *);
+    void rehash(size_t capacity);
 private:
-    const size_t m_index_count;
+    using pin_map = std::unordered_map<uint32, uint32>; // page => (pin count << 1) | keep
     const size_t m_block_count;
-    data_type m_index;
+    data_type m_data;
+    size_t m_count = 0;
+    pin_map m_pin;
 };
 
-inline bool thread_mask_t::empty(mask_t const & m) const {
-    for (const auto & v : m) {
-        if (v)
-            return false;
-    }
-    return true;
-}
-
-class thread_id_t : noncopyable {
-    enum { max_thread = pool_limits::max_thread };
+class thread_id_t : noncopyable { // thread safe, number of threads is not limited
 public:
     using thread_id = std::thread::id;
-    typedef thread_mask_t * const mask_ptr;
-    struct pos_mask {
-        threadIndex const first;
-        mask_ptr second;
-        pos_mask(): first(max_thread), second(nullptr) {}
-        pos_mask(threadIndex f, mask_ptr s): first(f), second(s) {}
-    };
+    using mask_ptr = thread_mask_t *;
     explicit thread_id_t(size_t filesize);
     static thread_id get_id() {
         return std::this_thread::get_id();
     }
-    static constexpr size_t max_size() {
-        return max_thread;
-    }
     size_t size() const {
-        SDL_ASSERT(m_size <= (int)max_size());
         return m_size;
     }
-    pos_mask insert() {
+    size_t capacity() const { // threads inserted before table is rehashed
+        return m_capacity;
+    }
+    mask_ptr insert() {
         return insert(get_id());
     }
-    pos_mask insert(thread_id); // throw if too many threads
-    bool erase(thread_id);
-    pos_mask find(thread_id);
-    pos_mask find() {
+    mask_ptr insert(thread_id);
+    bool erase(thread_id); // must be called from thread (id) or if thread (id) does not use pool
+    mask_ptr find(thread_id); // returns nullptr if not found
+    mask_ptr find() {
         return find(get_id());
     }
+    template<class fun_type>
+    void for_each(fun_type &&); // fun(thread_id, thread_mask_t &) under lock
 private:
+    mask_ptr insert_nolock(thread_id);
+    mask_ptr find_nolock(thread_id) const;
+    mask_ptr find_cache(thread_id) const;
+    void set_cache(thread_id, mask_ptr) const;
     static bool empty(thread_id id) {
         return id == thread_id();
     }
-#if 0
-    enum { use_hash = 0 }; // to be tested
-    static size_t hash_id(id_type const & id) {
-        std::hash<std::thread::id> hasher;
-        return hasher(id) % max_thread;
-    }
-#endif
     using unique_mask = std::unique_ptr<thread_mask_t>;
-    using id_mask = std::pair<thread_id, unique_mask>;
-    using data_type = array_t<id_mask, max_thread>;
+    using data_type = std::unordered_map<thread_id, unique_mask>;
+    using lock_guard = std::lock_guard<std::mutex>;
     const thread_id init_thread_id;
     const size_t m_filesize;
+    const size_t m_instance; // used by thread local cache
+    std::mutex m_mutex;
     data_type m_data;
-    std::atomic<int> m_size;
+    std::atomic<size_t> m_size;
+    std::atomic<size_t> m_capacity;
+    std::atomic<size_t> m_generation; // incremented by erase to invalidate thread local cache
 };
 
 }}} // sdl
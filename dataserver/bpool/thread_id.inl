@@ -6,65 +6,139 @@
 
 namespace sdl { namespace db { namespace bpool { 
 
-inline bool thread_mask_t::is_block(size_t const i) const {
+inline size_t thread_mask_t::slot(uint32 const key) const {
+    SDL_ASSERT(key && !m_data.empty());
+    return (key * size_t(2654435761u)) & (m_data.size() - 1); // multiplicative hash
+}
+
+inline thread_mask_t::entry *
+thread_mask_t::find_entry(size_t const i) const {
     SDL_ASSERT(i < m_block_count);
-    mask_p const & p = m_index[i / index_block_num];
-    if (p) {
-        const size_t j = (i % index_block_num) >> power_of<mask_div>::value; // divide by mask_div
-        const size_t k = (i & mask_hex);
-        uint64 const & mask = (*p)[j];
-        return (mask & (uint64(1) << k)) != 0;
+    if (m_count) {
+        uint32 const key = static_cast<uint32>(i + 1);
+        size_t const mask = m_data.size() - 1;
+        for (size_t k = slot(key);; k = (k + 1) & mask) {
+            entry const & e = m_data[k];
+            if (e.key == key) {
+                return const_cast<entry *>(&e);
+            }
+            if (!e.key) {
+                break;
+            }
+        }
+    }
+    return nullptr;
+}
+
+inline thread_mask_t::entry &
+thread_mask_t::get_entry(size_t const i) {
+    if (entry * const p = find_entry(i)) {
+        return *p;
+    }
+    if ((m_count + 1) * 2 > m_data.size()) { // load factor <= 1/2
+        rehash(a_max(m_data.size() * 2, size_t(min_capacity)));
+    }
+    uint32 const key = static_cast<uint32>(i + 1);
+    size_t const mask = m_data.size() - 1;
+    size_t k = slot(key);
+    while (m_data[k].key) {
+        k = (k + 1) & mask;
+    }
+    entry & e = m_data[k];
+    e.key = key;
+    e.pages = 0;
+    ++m_count;
+    return e;
+}
+
+inline uint8 thread_mask_t::block_page(size_t const i) const {
+    entry const * const p = find_entry(i);
+    return p ? p->pages : 0;
+}
+
+inline bool thread_mask_t::is_block(size_t const i) const {
+    return block_page(i) != 0;
+}
+
+inline bool thread_mask_t::is_page(size_t const i, size_t const page) const {
+    SDL_ASSERT(page < pool_limits::block_page_num);
+    return (block_page(i) & (1 << page)) != 0;
+}
+
+inline bool thread_mask_t::set_page(size_t const i, size_t const page) {
+    SDL_ASSERT(page < pool_limits::block_page_num);
+    entry & e = get_entry(i);
+    uint8 const bit = static_cast<uint8>(1 << page);
+    if (e.pages & bit) {
+        return false;
+    }
+    e.pages |= bit;
+    return true;
+}
+
+inline bool thread_mask_t::clr_page(size_t const i, size_t const page) {
+    SDL_ASSERT(page < pool_limits::block_page_num);
+    entry * const p = find_entry(i);
+    uint8 const bit = static_cast<uint8>(1 << page);
+    if (p && (p->pages & bit)) {
+        p->pages &= ~bit;
+        if (!p->pages) {
+            erase_entry(p);
+        }
+        return true;
     }
     return false;
 }
 
 inline void thread_mask_t::clr_block(size_t const i) {
-    SDL_ASSERT(i < m_block_count);
-    mask_p & p = m_index[i / index_block_num];
-    if (p) {
-        const size_t j = (i % index_block_num) >> power_of<mask_div>::value; // divide by mask_div
-        const size_t k = (i & mask_hex);
-        uint64 & mask = (*p)[j];
-        mask &= ~(uint64(1) << k);
+    if (entry * const p = find_entry(i)) {
+        erase_entry(p);
     }
 }
 
-inline void thread_mask_t::set_block(size_t const i) {
-    SDL_ASSERT(i < m_block_count);
-    mask_p & p = m_index[i / index_block_num];
-    if (!p) {
-        reset_new(p); //FIXME: should be optimized (custom allocator)
+inline bool thread_mask_t::is_pin(size_t const page) const {
+    return m_pin.find(static_cast<uint32>(page)) != m_pin.end();
+}
+
+inline void thread_mask_t::add_pin(size_t const page, bool const keep) {
+    SDL_ASSERT(page < m_block_count * pool_limits::block_page_num);
+    uint32 & v = m_pin[static_cast<uint32>(page)];
+    v = v ? (v + 2) : (2 | (keep ? 1 : 0));
+}
+
+inline bool thread_mask_t::sub_pin(size_t const page) {
+    const auto pos = m_pin.find(static_cast<uint32>(page));
+    if (pos == m_pin.end()) { // pins are removed by clear (unlock_thread)
+        return false;
     }
-    const size_t j = (i % index_block_num) >> power_of<mask_div>::value; // divide by mask_div
-    const size_t k = (i & mask_hex);
-    uint64 & mask = (*p)[j];
-    mask |= (uint64(1) << k);
+    uint32 & v = pos->second;
+    SDL_ASSERT(v >= 2);
+    if ((v -= 2) < 2) {
+        const bool keep = (v & 1) != 0;
+        m_pin.erase(pos);
+        return !keep;
+    }
+    return false;
 }
 
 template<class fun_type>
 void thread_mask_t::for_each_block(fun_type && fun) const {
-    size_t block_offset = 0;
-    for (mask_p const & p : m_index) {
-        if (p) {
-            mask_t const & m = *p;
-            size_t block_index = block_offset;
-            for (const uint64 & mask : m) {
-                if (mask) {
-                    static_assert(chunk_block_num == 64, "");
-                    size_t b = block_index;
-                    for (size_t k = 0; k < chunk_block_num; ++k, ++b) {
-                        if (mask & (uint64(1) << k)) {
-                            fun(b);
-                        }
-                    }
-                }
-                block_index += chunk_block_num;
+    if (m_count) {
+        for (entry const & e : m_data) {
+            if (e.key) {
+                SDL_ASSERT(e.pages);
+                fun(static_cast<size_t>(e.key - 1), e.pages);
             }
-            SDL_ASSERT(block_index == (block_offset + index_block_num));
         }
-        block_offset += index_block_num;
     }
-    SDL_ASSERT(block_offset >= m_block_count);
+}
+
+template<class fun_type>
+void thread_id_t::for_each(fun_type && fun) {
+    lock_guard lock(m_mutex);
+    for (auto const & p : m_data) {
+        fun(p.first, *p.second);
+    }
 }
 
 }}} // sdl
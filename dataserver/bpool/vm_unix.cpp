@@ -1,6 +1,7 @@
 // vm_unix.cpp
 //
 #include "dataserver/bpool/vm_unix.h"
+#include "dataserver/bpool/numa.h"
 #include "dataserver/filesys/mmap64_unix.h" // mmap, mmap64
 #include <numeric>
 
@@ -22,11 +23,13 @@ vm_unix_base::vm_unix_base(size_t const size)
     SDL_ASSERT(size && !(size % arena_size));
 }
 
-vm_unix::vm_unix(size_t const size, vm_commited const f)
+vm_unix::vm_unix(size_t const size, vm_commited const f, hugepage const h, size_t const node_count)
     : vm_unix_base(get_arena_size(size) * arena_size)
     , m_arena(arena_reserved)
     , m_free_arena_list{} // clear
-    , m_mixed_arena_list{} // clear
+    , m_mixed_arena_list(a_min(a_max(node_count, size_t(1)), size_t(numa::max_node))) // clear
+    , m_node_count(m_mixed_arena_list.size())
+    , m_hugepage(h)
 {
     SDL_ASSERT(size && !(size % block_size));
     SDL_ASSERT(page_reserved <= vm_unix::max_page);
@@ -37,12 +40,17 @@ vm_unix::vm_unix(size_t const size, vm_commited const f)
     A_STATIC_ASSERT_IS_POD(arena_t);
     static_assert(sizeof(arena_index) == 4, "");
     static_assert(sizeof(block_t) == 4, "");
-    static_assert((sizeof(arena_t) == 14) == is_64_bit::value, "");
-    static_assert((sizeof(arena_t) == 10) == is_32_bit::value, "");
+    static_assert((sizeof(arena_t) == 16) == is_64_bit::value, "");
+    static_assert((sizeof(arena_t) == 12) == is_32_bit::value, "");
     static_assert(block_size * arena_block_num == arena_size, "");
-    static_assert(get_arena_size(gigabyte<1>::value) == 1024, "");
-    static_assert(get_arena_size(terabyte<1>::value) == 1024*1024, ""); // 1048576
-    static_assert(arena_t::mask_all == 0xFFFF, "");
+    static_assert(get_arena_size(gigabyte<1>::value) == 512, "");
+    static_assert(get_arena_size(terabyte<1>::value) == 512*1024, ""); // 524288
+    static_assert(get_arena_size(terabyte<1>::value) == block_t::max_arena, "");
+    static_assert(arena_t::mask_all == 0xFFFFFFFF, "");
+    static_assert(numa::max_node <= 256, "m_arena_node");
+    if (m_node_count > 1) {
+        m_arena_node.resize(arena_reserved);
+    }
     if (is_commited(f)) {
         size_t i = 0;
         for (auto & x : m_arena) {
@@ -62,7 +70,7 @@ vm_unix::vm_unix(size_t const size, vm_commited const f)
         }
     }
     SDL_ASSERT(!m_free_arena_list);
-    SDL_ASSERT(!m_mixed_arena_list);
+    SDL_ASSERT(!count_mixed_arena_list());
     SDL_ASSERT(!m_arena_brk);
 }
 
@@ -148,12 +156,35 @@ size_t vm_unix::find_arena(char const * const p) const
     }
 }
 
+size_t vm_unix::current_node() const {
+    if (m_node_count > 1) {
+        return a_min(numa::current_node(), m_node_count - 1);
+    }
+    return 0;
+}
+
+size_t vm_unix::block_node(block32 const id) const {
+    SDL_ASSERT(id < block_reserved);
+    return arena_node(block_t::init_id(id).d.arenaId);
+}
+
+char * vm_unix::sys_alloc_node_arena(size_t const i, size_t const node) {
+    SDL_ASSERT(node < m_node_count);
+    char * const p = sys_alloc_arena(); // throw if failed
+    if (m_node_count > 1) {
+        if (!numa::bind(p, arena_size, node)) {
+            SDL_TRACE_DEBUG_2("vm_unix: numa::bind failed");
+        }
+        m_arena_node[i] = static_cast<uint8>(node);
+    }
+    return p;
+}
+
 void vm_unix::alloc_arena_nosort(arena_t & x, const size_t i) {
-    (void)i;
     SDL_ASSERT(&x == &m_arena[i]);
     SDL_ASSERT(m_sort_adr.empty());
     if (!x.arena_adr) {
-        x.arena_adr = sys_alloc_arena(); // throw if failed
+        x.arena_adr = sys_alloc_node_arena(i, i % m_node_count); // interleave nodes
         SDL_ASSERT(debug_zero_arena(x));
         ++m_alloc_arena_count;
         SDL_ASSERT(m_alloc_arena_count <= arena_reserved);
@@ -161,11 +192,10 @@ void vm_unix::alloc_arena_nosort(arena_t & x, const size_t i) {
     SDL_ASSERT(x.arena_adr && !x.block_mask);
 }
 
-void vm_unix::alloc_arena(arena_t & x, const size_t i) {
-    (void)i;
+void vm_unix::alloc_arena(arena_t & x, const size_t i, const size_t node) {
     SDL_ASSERT(&x == &m_arena[i]);
     if (!x.arena_adr) {
-        x.arena_adr = sys_alloc_arena(); // throw if failed
+        x.arena_adr = sys_alloc_node_arena(i, node);
         SDL_ASSERT(debug_zero_arena(x));
         ++m_alloc_arena_count;
         SDL_ASSERT(m_alloc_arena_count <= arena_reserved);
@@ -207,7 +237,16 @@ size_t vm_unix::count_free_arena_list() const {
 
 size_t vm_unix::count_mixed_arena_list() const {
     size_t result = 0;
-    for(auto p = m_mixed_arena_list; p; ++result) {
+    for (size_t node = 0; node < m_node_count; ++node) {
+        result += count_mixed_arena_list(node);
+    }
+    return result;
+}
+
+size_t vm_unix::count_mixed_arena_list(size_t const node) const {
+    SDL_ASSERT(node < m_node_count);
+    size_t result = 0;
+    for(auto p = m_mixed_arena_list[node]; p; ++result) {
         const auto & x = m_arena[p.index()];
         SDL_ASSERT(x.arena_adr && x.mixed());
         p = x.next_arena;
@@ -218,13 +257,30 @@ size_t vm_unix::count_mixed_arena_list() const {
 
 char * vm_unix::sys_alloc_arena() {
 #if defined(SDL_OS_UNIX)
+#if defined(MAP_HUGETLB)
+    if (hugepage::hugetlb == m_hugepage) { // needs huge pages reserved by vm.nr_hugepages
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#if defined(MAP_HUGE_SHIFT)
+        flags |= (power_of<arena_size>::value << MAP_HUGE_SHIFT); // MAP_HUGE_2MB
+#endif
+        void * const p = mmap64_t::call(nullptr, arena_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (p != MAP_FAILED) {
+            return reinterpret_cast<char *>(p);
+        }
+        SDL_TRACE("vm_unix: MAP_HUGETLB failed, use transparent huge pages");
+        m_hugepage = hugepage::advise;
+    }
+#endif
+    if (hugepage::advise == m_hugepage) {
+        return sys_alloc_aligned_arena();
+    }
     void * const p = mmap64_t::call(nullptr, arena_size, 
         PROT_READ | PROT_WRITE // the desired memory protection of the mapping
         , MAP_PRIVATE | MAP_ANONYMOUS // private copy-on-write mapping. The mapping is not backed by any file
         ,-1 // file descriptor
         , 0 // offset must be a multiple of the page size as returned by sysconf(_SC_PAGE_SIZE)
     );
-    throw_error_if_t<vm_unix>(!p, "mmap64_t failed");
+    throw_error_if_t<vm_unix>(!p || (p == MAP_FAILED), "mmap64_t failed");
     return reinterpret_cast<char *>(p);
 #else
     char * const p = reinterpret_cast<char *>(std::malloc(arena_size));
@@ -233,6 +289,28 @@ char * vm_unix::sys_alloc_arena() {
 #endif
 }
 
+char * vm_unix::sys_alloc_aligned_arena() {
+#if defined(SDL_OS_UNIX)
+    void * const p = mmap64_t::call(nullptr, arena_size * 2, // trim to aligned arena
+        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    throw_error_if_t<vm_unix>(!p || (p == MAP_FAILED), "mmap64_t failed");
+    char * const start = reinterpret_cast<char *>(p);
+    char * const result = reinterpret_cast<char *>(round_up_div(
+        reinterpret_cast<size_t>(start), size_t(arena_size)) * arena_size);
+    SDL_ASSERT((start <= result) && (result < start + arena_size));
+    if (result != start) {
+        ::munmap(start, result - start);
+    }
+    ::munmap(result + arena_size, start + arena_size - result);
+#if defined(MADV_HUGEPAGE)
+    ::madvise(result, arena_size, MADV_HUGEPAGE); // hint, ignored if transparent huge pages are disabled
+#endif
+    return result;
+#else
+    return sys_alloc_arena();
+#endif
+}
+
 bool vm_unix::sys_free_arena(char * const p) {
     SDL_ASSERT(p);
 #if defined(SDL_OS_UNIX)
@@ -246,7 +324,7 @@ bool vm_unix::sys_free_arena(char * const p) {
     return true;
 }
 
-char * vm_unix::alloc_next_arena_block() 
+char * vm_unix::alloc_next_arena_block(size_t const node)
 {
     SDL_ASSERT(m_arena_brk < arena_reserved);
     if (m_arena_brk >= arena_reserved) {
@@ -255,34 +333,43 @@ char * vm_unix::alloc_next_arena_block()
     }
     const size_t i = m_arena_brk++;
     arena_t & x = m_arena[i];
-    alloc_arena(x, i);
+    alloc_arena(x, i, node);
     x.set_block<0>();
     SDL_ASSERT(x.set_block_count() == 1);
     add_to_mixed_arena_list(x, i);
     return x.arena_adr;
 }
 
-char * vm_unix::alloc_block_without_count()
+char * vm_unix::alloc_mixed_arena_block(size_t const node)
+{
+    arena_index & list = m_mixed_arena_list[node];
+    SDL_ASSERT(list);
+    const size_t i = list.index();
+    arena_t & x = m_arena[i];
+    SDL_ASSERT(x.arena_adr && x.mixed()); 
+    SDL_ASSERT(arena_node(i) == node);
+    const size_t index = x.find_free_block();
+    x.set_block(index);
+    char * const p = x.arena_adr + (index << power_of<block_size>::value);
+    SDL_ASSERT(find_arena(p) == i);
+    if (x.full()) {
+        list = x.next_arena; // can be null
+        x.next_arena.set_null();
+    }
+    return p;
+}
+
+char * vm_unix::alloc_block_without_count(size_t const node)
 {
     SDL_ASSERT(m_arena_brk <= arena_reserved);
+    SDL_ASSERT(node < m_node_count);
     if (!m_arena_brk) {
-        SDL_ASSERT(!m_mixed_arena_list);
+        SDL_ASSERT(!count_mixed_arena_list());
         SDL_ASSERT(!m_free_arena_list);
-        return alloc_next_arena_block();
+        return alloc_next_arena_block(node);
     }
-    if (m_mixed_arena_list) { // use mixed first
-        const size_t i = m_mixed_arena_list.index();
-        arena_t & x = m_arena[i];
-        SDL_ASSERT(x.arena_adr && x.mixed()); 
-        const size_t index = x.find_free_block();
-        x.set_block(index);
-        char * const p = x.arena_adr + (index << power_of<block_size>::value);
-        SDL_ASSERT(find_arena(p) == i);
-        if (x.full()) {
-            m_mixed_arena_list = x.next_arena; // can be null
-            x.next_arena.set_null();
-        }
-        return p;
+    if (m_mixed_arena_list[node]) { // use mixed first
+        return alloc_mixed_arena_block(node);
     }
     if (m_free_arena_list) { // use m_free_arena_list first
         const size_t i = m_free_arena_list.index();
@@ -290,33 +377,40 @@ char * vm_unix::alloc_block_without_count()
         SDL_ASSERT(x.empty() && !x.arena_adr);
         m_free_arena_list = x.next_arena; // can be null
         x.next_arena.set_null();
-        alloc_arena(x, i);
+        alloc_arena(x, i, node);
         x.set_block<0>();
         SDL_ASSERT(x.set_block_count() == 1);
         add_to_mixed_arena_list(x, i);
         return x.arena_adr;
     }
-    SDL_ASSERT(m_arena_brk);
-    SDL_ASSERT(!m_mixed_arena_list);
-    SDL_DEBUG_CPP(const arena_t & test = m_arena[m_arena_brk - 1]);
-    SDL_ASSERT(test.full() && test.arena_adr);
-    return alloc_next_arena_block();
+    if (m_arena_brk < arena_reserved) {
+        return alloc_next_arena_block(node);
+    }
+    for (size_t i = 1; i < m_node_count; ++i) { // address space is used up, take block of other node
+        const size_t other = (node + i) % m_node_count;
+        if (m_mixed_arena_list[other]) {
+            return alloc_mixed_arena_block(other);
+        }
+    }
+    SDL_ASSERT(0);
+    return nullptr;
 }
 
 bool vm_unix::remove_from_mixed_arena_list(size_t const i)
 {
-    if (!m_mixed_arena_list) {
+    arena_index & list = mixed_arena_list(i);
+    if (!list) {
         SDL_ASSERT(0);
         return false;
     }
-    if (m_mixed_arena_list.index() == i) {
+    if (list.index() == i) {
         arena_t & x = m_arena[i];
         SDL_ASSERT(x.arena_adr);
-        m_mixed_arena_list = x.next_arena;
+        list = x.next_arena;
         x.next_arena.set_null();
         return true;
     }
-    arena_index prev = m_mixed_arena_list;
+    arena_index prev = list;
     arena_index p = m_arena[prev.index()].next_arena;
     while (p) {
         SDL_ASSERT(prev);
@@ -362,13 +456,14 @@ bool vm_unix::release_without_count(char * const start)
         SDL_ASSERT(x.mixed());
         if (1 == x.free_block_count()) { // add to m_mixed_arena_list
             SDL_ASSERT_DEBUG_2(!find_mixed_arena_list(i));
-            if (m_mixed_arena_list) {
-                x.next_arena.set_index(m_mixed_arena_list.index());
+            arena_index & list = mixed_arena_list(i);
+            if (list) {
+                x.next_arena.set_index(list.index());
             }
             else {
                 x.next_arena.set_null();
             }
-            m_mixed_arena_list.set_index(i);
+            list.set_index(i);
         }
         SDL_ASSERT_DEBUG_2(find_mixed_arena_list(i));
         return true;
@@ -401,7 +496,7 @@ bool vm_unix::find_free_arena_list(size_t const i) const {
     return false;
 }
 bool vm_unix::find_mixed_arena_list(size_t const i) const {
-    auto p = m_mixed_arena_list;
+    auto p = m_mixed_arena_list[arena_node(i)];
     while (p) {
         if (p.index() == i) {
             SDL_ASSERT(m_arena[i].mixed());
@@ -469,17 +564,29 @@ char * vm_unix::get_free_block(block_t const & b) const // block is NOT allocate
     return nullptr;
 }
 
-bool vm_unix::defragment(move_block_fun const & move_block) // to be tested
+size_t vm_unix::defragment(move_block_fun const & move_block, size_t const max_move)
+{
+    size_t result = 0;
+    for (size_t node = 0; (node < m_node_count) && (result < max_move); ++node) {
+        result += defragment(node, move_block, max_move - result);
+    }
+    return result;
+}
+
+// blocks of least used mixed arenas are moved to most used ones;
+// stops after max_move blocks, so long defragmentation can be split into bounded steps
+size_t vm_unix::defragment(size_t const node, move_block_fun const & move_block, size_t const max_move)
 {
     SDL_ASSERT(move_block);
-    const size_t mixed_count = count_mixed_arena_list();
+    SDL_ASSERT(max_move);
+    const size_t mixed_count = count_mixed_arena_list(node);
     if (mixed_count < 2) {
-        return false; // nothing to defragment
+        return 0; // nothing to defragment
     }
     using arena_block = std::pair<arena32, uint8>;
     std::vector<arena_block> mixed(mixed_count); // sorted by set_block_count
     {
-        arena_index p = m_mixed_arena_list;
+        arena_index p = m_mixed_arena_list[node];
         for (arena_block & val : mixed) {
             SDL_ASSERT(p);
             const auto & x = m_arena[p.index()];
@@ -498,7 +605,7 @@ bool vm_unix::defragment(move_block_fun const & move_block) // to be tested
     SDL_ASSERT(lh->second <= rh->second);
     size_t moved_block_count = 0;
     size_t free_arena_count = 0;
-    while (lh < rh) {
+    while ((lh < rh) && (moved_block_count < max_move)) {
         SDL_DEBUG_CPP(lh->second = 0); // not used
         SDL_DEBUG_CPP(rh->second = 0); // not used
         auto & x = m_arena[lh->first];
@@ -506,7 +613,7 @@ bool vm_unix::defragment(move_block_fun const & move_block) // to be tested
         SDL_ASSERT(x.arena_adr && y.arena_adr);
         SDL_ASSERT(!x.empty() && !y.full());
         auto lmask = x.block_mask;
-        while (lmask && !y.full()) {
+        while (lmask && !y.full() && (moved_block_count < max_move)) {
             const size_t lb = arena_t::find_set_block(lmask);
             const size_t rb = y.find_free_block();
             SDL_ASSERT(x.is_block(lb));
@@ -543,7 +650,7 @@ bool vm_unix::defragment(move_block_fun const & move_block) // to be tested
     }
     SDL_TRACE_IF(free_arena_count > 0, "# free_arena_count = ", free_arena_count);
     SDL_TRACE_IF(moved_block_count > 0, "# moved_block_count = ", moved_block_count);
-    return moved_block_count > 0;
+    return moved_block_count;
 }
 
 //---------------------------------------------------------------
@@ -552,14 +659,76 @@ bool vm_unix::defragment(move_block_fun const & move_block) // to be tested
 namespace {
 class unit_test {
     static void test(vm_commited);
+    static void test_numa();
 public:
     unit_test() {
         test(vm_commited::false_);
         test(vm_commited::true_);
+        test_numa();
         SDL_TRACE_FUNCTION;
     }
 };
 
+void unit_test::test_numa() { // two nodes are simulated on single node machine
+    using T = vm_unix;
+    T test(T::arena_size * 3, vm_commited::false_, T::hugepage::none, 2);
+    SDL_ASSERT(test.node_count() == 2);
+    SDL_ASSERT(test.current_node() < 2);
+    std::vector<char *> block_adr[2];
+    for (size_t i = 0; i < T::arena_block_num + 1; ++i) {
+        block_adr[0].push_back(test.alloc_block(0));
+    }
+    block_adr[1].push_back(test.alloc_block(1));
+    SDL_ASSERT(test.arena_brk() == 3); // node 1 does not use arena of node 0
+    SDL_ASSERT(test.count_mixed_arena_list(0) == 1);
+    SDL_ASSERT(test.count_mixed_arena_list(1) == 1);
+    for (size_t node = 0; node < 2; ++node) {
+        for (char * const p : block_adr[node]) {
+            SDL_ASSERT(test.block_node(test.get_block_id(p)) == node);
+        }
+    }
+    while (test.alloc_block_count() < test.block_reserved) { // node 1 takes free blocks of node 0
+        block_adr[1].push_back(test.alloc_block(1));
+    }
+    SDL_ASSERT(!test.count_mixed_arena_list());
+    SDL_ASSERT(test.block_node(test.get_block_id(block_adr[1].back())) == 0);
+    for (size_t i = 0; i < T::arena_block_num / 2; ++i) {
+        SDL_ASSERT(test.release(block_adr[0][i])); // first arena of node 0
+    }
+    SDL_ASSERT(test.release(block_adr[0][T::arena_block_num])); // second arena of node 0
+    SDL_ASSERT(test.release(block_adr[1][0])); // arena of node 1
+    SDL_ASSERT(test.count_mixed_arena_list(0) == 2);
+    SDL_ASSERT(test.count_mixed_arena_list(1) == 1);
+    size_t moved = 0;
+    SDL_ASSERT(test.defragment([&test, &moved](uint32 const from, uint32 const to){
+        SDL_ASSERT(test.block_node(from) == test.block_node(to));
+        ++moved;
+        return true;
+    }));
+    SDL_ASSERT(moved == 1);
+    SDL_ASSERT(test.count_mixed_arena_list(0) == 1);
+    SDL_ASSERT(test.count_mixed_arena_list(1) == 1);
+    if (1) { // defragmentation in bounded steps
+        T test2(T::arena_size * 2, vm_commited::false_);
+        std::vector<char *> adr;
+        for (size_t i = 0; i < T::arena_block_num * 2; ++i) {
+            adr.push_back(test2.alloc_block());
+        }
+        for (size_t i = 0; i < T::arena_block_num / 2; ++i) {
+            SDL_ASSERT(test2.release(adr[i])); // first arena is half used
+        }
+        SDL_ASSERT(test2.release(adr[T::arena_block_num]));
+        SDL_ASSERT(test2.release(adr[T::arena_block_num + 1])); // two free blocks in second arena
+        SDL_ASSERT(test2.count_mixed_arena_list() == 2);
+        auto move_all = [](uint32, uint32){ return true; };
+        SDL_ASSERT(test2.defragment(move_all, 1) == 1);
+        SDL_ASSERT(test2.count_mixed_arena_list() == 2);
+        SDL_ASSERT(test2.defragment(move_all, 1) == 1);
+        SDL_ASSERT(test2.count_mixed_arena_list() == 1); // second arena is full
+        SDL_ASSERT(!test2.defragment(move_all, 1));
+    }
+}
+
 void unit_test::test(vm_commited const flag) {
     if (1) {
         using T = vm_unix;
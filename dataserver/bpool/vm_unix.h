@@ -6,13 +6,14 @@
 
 #include "dataserver/bpool/vm_base.h"
 #include "dataserver/bpool/block_head.h"
+#include "dataserver/system/database_cfg.h"
 
 namespace sdl { namespace db { namespace bpool { 
 
 class vm_unix_base : public vm_base {
 public:
-    enum { arena_size = megabyte<1>::value }; // 1 MB = 2^20 = 1048,576
-    enum { arena_block_num = 16 };
+    enum { arena_size = megabyte<2>::value }; // 2 MB = 2^21 = 2097,152 (x86-64 huge page)
+    enum { arena_block_num = 32 };
     size_t const byte_reserved;
     size_t const page_reserved;
     size_t const block_reserved;
@@ -50,19 +51,19 @@ public:
             value = 0;
         }
     };
-    struct arena_t { // 14 bytes
-        using mask16 = uint16;
-        static constexpr mask16 mask_all = uint16(-1); // 0xFFFF
+    struct arena_t { // 16 bytes
+        using mask32 = uint32;
+        static constexpr mask32 mask_all = uint32(-1); // 0xFFFFFFFF
         char * arena_adr;          // address of allocated area
         arena_index next_arena;    // index of free_area_list or m_mixed_arena_list (starting from 1) 
-        mask16 block_mask;
+        mask32 block_mask;
         void zero_arena();
         template<size_t> void set_block();
         template<size_t> bool is_block() const;
-        static void clr_block(mask16 &, size_t);
+        static void clr_block(mask32 &, size_t);
         void clr_block(size_t);
         void set_block(size_t);
-        static bool is_block(mask16, size_t);
+        static bool is_block(mask32, size_t);
         bool is_block(size_t) const;
         bool full() const;
         bool empty() const;
@@ -71,15 +72,15 @@ public:
         size_t free_block_count() const;
         size_t find_free_block() const;
         size_t find_set_block() const;
-        static size_t find_free_block(mask16);
-        static size_t find_set_block(mask16);
+        static size_t find_free_block(mask32);
+        static size_t find_set_block(mask32);
     };
     struct block_t { // 4 bytes
-        static constexpr size_t max_arena = (1 << 20);
-        static constexpr size_t max_index = (1 << 4);
+        static constexpr size_t max_arena = (1 << 19);
+        static constexpr size_t max_index = (1 << 5);
         struct data_type {
-            unsigned int index : 4;     // block index in arena (16 blocks = 16 * 64 KB = 1MB)
-            unsigned int arenaId : 20;  // 1 terabyte address space (2^20 * 1MB)
+            unsigned int index : 5;     // block index in arena (32 blocks = 32 * 64 KB = 2MB)
+            unsigned int arenaId : 19;  // 1 terabyte address space (2^19 * 2MB)
             unsigned int zeros : 8;     // zero pad
         };
         union {
@@ -106,13 +107,16 @@ public:
     };
 #pragma pack(pop)
 public:
-    explicit vm_unix(size_t, vm_commited);
+    using hugepage = database_cfg::hugepage;
+    vm_unix(size_t, vm_commited, hugepage = hugepage::none, size_t node_count = 1);
     ~vm_unix();
-    char * alloc_block();
+    char * alloc_block(); // on NUMA node of calling thread
+    char * alloc_block(size_t node);
     bool release(char *);
     bool release_block(block32);
     block32 get_block_id(char const *) const; // block must be allocated
     char * get_block(block32) const; // block must be allocated
+    char * get_block_address(block32) const; // no checks, used by lock-free readers of allocated block
     size_t used_size() const {
         SDL_ASSERT(m_alloc_block_count <= block_reserved);
         SDL_ASSERT((m_alloc_block_count * block_size) <= byte_reserved);
@@ -123,6 +127,7 @@ public:
     }
     size_t count_free_arena_list() const;
     size_t count_mixed_arena_list() const;
+    size_t count_mixed_arena_list(size_t node) const;
     size_t arena_brk() const {
         return m_arena_brk;
     }
@@ -132,11 +137,21 @@ public:
     size_t alloc_arena_count() const {
         return m_alloc_arena_count;
     }
+    hugepage arena_hugepage() const { // may fall back from hugetlb to advise
+        return m_hugepage;
+    }
+    size_t node_count() const {
+        return m_node_count;
+    }
+    size_t current_node() const; // NUMA node of calling thread
+    size_t block_node(block32) const; // NUMA node of allocated block
     using move_block_fun = std::function<bool(block32 from, block32 to)>;
-    bool defragment(move_block_fun const &);
+    size_t defragment(move_block_fun const &, size_t max_move = size_t(-1)); // blocks are moved inside NUMA node, returns number of moved blocks
 private:
     char * get_free_block(block_t const &) const; // block NOT allocated
-    char * alloc_block_without_count();
+    char * alloc_block_without_count(size_t node);
+    char * alloc_mixed_arena_block(size_t node);
+    size_t defragment(size_t node, move_block_fun const &, size_t max_move);
     bool release_without_count(char *);
 #if SDL_DEBUG
     static bool debug_zero_arena(arena_t & x) {
@@ -148,12 +163,20 @@ private:
     bool find_mixed_arena_list(size_t) const;
 #endif
     char * sys_alloc_arena();
+    char * sys_alloc_aligned_arena(); // aligned to arena_size to be backed by transparent huge page
     bool sys_free_arena(char *);
+    char * sys_alloc_node_arena(size_t arena, size_t node);
     void alloc_arena_nosort(arena_t &, size_t);
-    void alloc_arena(arena_t &, size_t);
+    void alloc_arena(arena_t &, size_t, size_t node);
     void free_arena(arena_t &, size_t);
     size_t find_arena(char const *) const;
-    char * alloc_next_arena_block();
+    char * alloc_next_arena_block(size_t node);
+    size_t arena_node(size_t const i) const {
+        return m_arena_node.empty() ? 0 : m_arena_node[i];
+    }
+    arena_index & mixed_arena_list(size_t const i) { // list of NUMA node of arena
+        return m_mixed_arena_list[arena_node(i)];
+    }
     void add_to_free_arena_list(arena_t &, size_t);
     void add_to_mixed_arena_list(arena_t &, size_t);
     bool remove_from_mixed_arena_list(size_t);
@@ -162,9 +185,12 @@ private:
     vector_arena_t m_arena;
     size_t m_arena_brk = 0;
     arena_index m_free_arena_list; // list of released arena(s)
-    arena_index m_mixed_arena_list; // list of arena(s) with allocated and free block(s)
+    std::vector<arena_index> m_mixed_arena_list; // list of arena(s) with allocated and free block(s) per NUMA node
+    std::vector<uint8> m_arena_node; // NUMA node of arena (empty if one node)
+    size_t const m_node_count;
     size_t m_alloc_block_count = 0;
     size_t m_alloc_arena_count = 0;
+    hugepage m_hugepage;
 private:
     enum { use_sort_arena = 1 };
     using sort_adr_t = std::vector<arena32>;
@@ -173,6 +199,12 @@ private:
     sort_adr_t::iterator find_sort_adr(arena32);
 };
 
+inline char * vm_unix::get_block_address(block32 const id) const {
+    const block_t b = block_t::init_id(id);
+    static_assert(power_of<block_size>::value == 16, "");
+    return m_arena[b.d.arenaId].arena_adr + (size_t(b.d.index) << power_of<block_size>::value);
+}
+
 inline bool vm_unix::release_block(block32 const id) {
     return release(get_block(id));
 }
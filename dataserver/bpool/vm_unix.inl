@@ -7,7 +7,12 @@
 namespace sdl { namespace db { namespace bpool { 
 
 inline char * vm_unix::alloc_block() {
-    if (char * const p = alloc_block_without_count()) {
+    return alloc_block(current_node());
+}
+
+inline char * vm_unix::alloc_block(size_t const node) {
+    SDL_ASSERT(node < m_node_count);
+    if (char * const p = alloc_block_without_count(node)) {
         ++m_alloc_block_count;
         SDL_ASSERT(m_alloc_block_count <= block_reserved);
         SDL_ASSERT(get_block_id(p) < block_reserved);
@@ -35,13 +40,14 @@ inline void vm_unix::add_to_mixed_arena_list(arena_t & x, size_t const i) {
     SDL_ASSERT(!x.next_arena);
     SDL_ASSERT(x.mixed() && x.arena_adr);
     SDL_ASSERT(x.block_mask == 1);
-    if (m_mixed_arena_list) {
-        x.next_arena.set_index(m_mixed_arena_list.index());
+    arena_index & list = mixed_arena_list(i);
+    if (list) {
+        x.next_arena.set_index(list.index());
     }
     else {
         x.next_arena.set_null();
     }
-    m_mixed_arena_list.set_index(i);
+    list.set_index(i);
 }
 
 inline void vm_unix::add_to_free_arena_list(arena_t & x, const size_t i) {
@@ -67,41 +73,41 @@ inline void vm_unix::arena_t::zero_arena(){
 inline bool vm_unix::arena_t::is_block(size_t const i) const {
     SDL_ASSERT(arena_adr);
     SDL_ASSERT(i < arena_block_num);
-    return 0 != (block_mask & (mask16)(1 << i));
+    return 0 != (block_mask & (mask32)(1 << i));
 }
-inline bool vm_unix::arena_t::is_block(mask16 const block_mask, size_t const i) {
+inline bool vm_unix::arena_t::is_block(mask32 const block_mask, size_t const i) {
     SDL_ASSERT(i < arena_block_num);
-    return 0 != (block_mask & (mask16)(1 << i));
+    return 0 != (block_mask & (mask32)(1 << i));
 }
 template<size_t i>
 inline bool vm_unix::arena_t::is_block() const {
     SDL_ASSERT(arena_adr);
     static_assert(i < arena_block_num, "");
-    return 0 != (block_mask & (mask16)(1 << i));
+    return 0 != (block_mask & (mask32)(1 << i));
 }
 inline void vm_unix::arena_t::set_block(size_t const i) {
     SDL_ASSERT(arena_adr);
     SDL_ASSERT(i < arena_block_num);
     SDL_ASSERT(!is_block(i));
-    block_mask |= (mask16)(1 << i);
+    block_mask |= (mask32)(1 << i);
 }
 template<size_t i>
 void vm_unix::arena_t::set_block() {
     SDL_ASSERT(arena_adr);
     static_assert(i < arena_block_num, "");
     SDL_ASSERT(!is_block<i>());
-    block_mask |= (mask16)(1 << i);
+    block_mask |= (mask32)(1 << i);
 }
-inline void vm_unix::arena_t::clr_block(mask16 & block_mask, size_t const i) {
+inline void vm_unix::arena_t::clr_block(mask32 & block_mask, size_t const i) {
     SDL_ASSERT(i < arena_block_num);
     SDL_ASSERT(is_block(block_mask, i));
-    block_mask &= ~(mask16(1 << i));
+    block_mask &= ~(mask32(1 << i));
 }
 inline void vm_unix::arena_t::clr_block(size_t const i) {
     SDL_ASSERT(arena_adr);
     SDL_ASSERT(i < arena_block_num);
     SDL_ASSERT(is_block(i));
-    block_mask &= ~(mask16(1 << i));
+    block_mask &= ~(mask32(1 << i));
 }
 inline bool vm_unix::arena_t::full() const {
     SDL_ASSERT(!block_mask || arena_adr);
@@ -123,10 +129,10 @@ inline size_t vm_unix::arena_t::free_block_count() const {
     return arena_block_num - set_block_count();
 }
 
-inline size_t vm_unix::arena_t::find_free_block(mask16 const block_mask) {
+inline size_t vm_unix::arena_t::find_free_block(mask32 const block_mask) {
     SDL_ASSERT(block_mask < arena_t::mask_all);
     size_t index = 0;
-    mask16 b = block_mask;
+    mask32 b = block_mask;
     while (b & 1) {
         ++index;
         b >>= 1;
@@ -135,10 +141,10 @@ inline size_t vm_unix::arena_t::find_free_block(mask16 const block_mask) {
     return index;
 
 }
-inline size_t vm_unix::arena_t::find_set_block(mask16 const block_mask) {
+inline size_t vm_unix::arena_t::find_set_block(mask32 const block_mask) {
     SDL_ASSERT(block_mask);
     size_t index = 0;
-    mask16 b = block_mask;
+    mask32 b = block_mask;
     while (!(b & 1)) {
         ++index;
         b >>= 1;
@@ -0,0 +1,147 @@
+// warm.cpp
+//
+#include "dataserver/bpool/warm.h"
+#include <fstream>
+#include <cstdio> // std::rename
+
+namespace sdl { namespace db { namespace bpool {
+
+namespace {
+const char warm_magic[8] = { 'S', 'D', 'L', 'W', 'A', 'R', 'M', '1' };
+}
+
+warm_header warm_file::make_header(size_t const filesize,
+                                   page_head const * const fileheader,
+                                   page_head const * const boot)
+{
+    static_assert(sizeof(warm_block) == 8, "");
+    static_assert(sizeof(warm_header) == 40, "");
+    warm_header h;
+    memset_zero(h);
+    memcpy(h.magic, warm_magic, sizeof(h.magic));
+    h.filesize = filesize;
+    if (fileheader) {
+        h.fileheader = fileheader->data.lsn;
+    }
+    if (boot) {
+        h.boot = boot->data.lsn;
+    }
+    return h;
+}
+
+bool warm_file::equal(warm_header const & x, warm_header const & y) // except count
+{
+    return !memcmp(x.magic, y.magic, sizeof(x.magic))
+        && (x.filesize == y.filesize)
+        && !memcmp(&x.fileheader, &y.fileheader, sizeof(x.fileheader))
+        && !memcmp(&x.boot, &y.boot, sizeof(x.boot));
+}
+
+bool warm_file::save(std::string const & path, warm_header const & head, vector_block const & data)
+{
+    SDL_ASSERT(!path.empty());
+    std::string const temp = path + ".tmp"; // replace old file only when new one is complete
+    {
+        std::ofstream out(temp, std::ofstream::binary | std::ofstream::trunc);
+        if (!out.is_open()) {
+            SDL_TRACE("warm_file: cannot create ", temp);
+            return false;
+        }
+        warm_header h = head;
+        h.count = static_cast<uint32>(data.size());
+        out.write(reinterpret_cast<char const *>(&h), sizeof(h));
+        if (!data.empty()) {
+            out.write(reinterpret_cast<char const *>(data.data()), data.size() * sizeof(warm_block));
+        }
+        out.flush();
+        if (!out) {
+            SDL_TRACE("warm_file: cannot write ", temp);
+            std::remove(temp.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temp.c_str(), path.c_str())) {
+        SDL_TRACE("warm_file: cannot rename ", temp);
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool warm_file::load(std::string const & path, warm_header const & expect, vector_block & data)
+{
+    data.clear();
+    std::ifstream in(path, std::ifstream::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+    warm_header h;
+    memset_zero(h);
+    if (!in.read(reinterpret_cast<char *>(&h), sizeof(h))) {
+        return false;
+    }
+    if (!equal(h, expect)) {
+        SDL_TRACE("warm_file: stale ", path);
+        return false;
+    }
+    if (h.count > pool_limits::max_block) {
+        SDL_ASSERT(0);
+        return false;
+    }
+    data.resize(h.count);
+    if (h.count && !in.read(reinterpret_cast<char *>(data.data()), data.size() * sizeof(warm_block))) {
+        SDL_TRACE("warm_file: truncated ", path);
+        data.clear();
+        return false;
+    }
+    return true;
+}
+
+warm_file::vector_block32
+warm_file::select(vector_block && data, size_t const max_count, size_t const last_block)
+{
+    data.erase(std::remove_if(data.begin(), data.end(), [last_block](warm_block const & x){
+        return !x.realBlock || (x.realBlock > last_block); // zero block is always loaded
+    }), data.end());
+    if (data.size() > max_count) {
+        std::stable_sort(data.begin(), data.end(), [](warm_block const & x, warm_block const & y){
+            return x.weight > y.weight;
+        });
+        data.resize(max_count);
+    }
+    vector_block32 result(data.size());
+    for (size_t i = 0; i < data.size(); ++i) {
+        result[i] = data[i].realBlock;
+    }
+    std::sort(result.begin(), result.end()); // file order
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+#if SDL_DEBUG
+namespace {
+class unit_test {
+public:
+    unit_test() {
+        {
+            warm_header const x = warm_file::make_header(pool_limits::block_size * 4, nullptr, nullptr);
+            warm_header y = x;
+            y.count = 10;
+            SDL_ASSERT(warm_file::equal(x, y));
+            y.boot.lsn1 = 1;
+            SDL_ASSERT(!warm_file::equal(x, y));
+        }
+        {
+            warm_file::vector_block data {
+                { 7, 1 }, { 3, warm_file::locked_weight }, { 0, warm_file::locked_weight },
+                { 5, 100 }, { 9, 200 }, { 3, 2 }, { 100, 300 } };
+            auto const result = warm_file::select(std::move(data), 3, 10);
+            SDL_ASSERT(result == warm_file::vector_block32({ 3, 5, 9 }));
+        }
+    }
+};
+static unit_test s_test;
+}
+#endif // SDL_DEBUG
+
+}}} // sdl
@@ -0,0 +1,44 @@
+// warm.h
+//
+#pragma once
+#ifndef __SDL_BPOOL_WARM_H__
+#define __SDL_BPOOL_WARM_H__
+
+#include "dataserver/bpool/block_head.h"
+
+namespace sdl { namespace db { namespace bpool {
+
+#pragma pack(push, 1)
+
+struct warm_block { // 8 bytes
+    uint32 realBlock;
+    uint32 weight; // recently used block has greater weight
+};
+
+struct warm_header { // 40 bytes
+    char magic[8];
+    uint64 filesize;    // database file
+    pageLSN fileheader; // LSN of page 0
+    pageLSN boot;       // LSN of boot page
+    uint32 count;       // number of warm_block(s)
+};
+
+#pragma pack(pop)
+
+// sidecar file with resident blocks of page_bpool used to warm up the pool after restart;
+// block list is ignored if database file was changed (file size or LSN of header pages)
+struct warm_file final : is_static {
+    enum : uint32 { locked_weight = 0x10000 }; // locked or fixed block
+    enum { boot_page = 9 };
+    using vector_block = std::vector<warm_block>;
+    using vector_block32 = std::vector<uint32>;
+    static warm_header make_header(size_t filesize, page_head const * fileheader, page_head const * boot);
+    static bool equal(warm_header const &, warm_header const &);
+    static bool save(std::string const & path, warm_header const &, vector_block const &);
+    static bool load(std::string const & path, warm_header const &, vector_block &); // false if stale
+    static vector_block32 select(vector_block &&, size_t max_count, size_t last_block); // hottest blocks in file order
+};
+
+}}} // sdl
+
+#endif // __SDL_BPOOL_WARM_H__
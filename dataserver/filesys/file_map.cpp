@@ -11,7 +11,7 @@ class FileMapping::data_t: noncopyable
     void * m_pFileView = nullptr;
     uint64 m_FileSize = 0;
 public:
-    explicit data_t(const char* filename);
+    data_t(const char* filename, bool populate);
     ~data_t();
 
     void const * GetFileView() const
@@ -24,7 +24,7 @@ public:
     }
 };
 
-FileMapping::data_t::data_t(const char * const filename)
+FileMapping::data_t::data_t(const char * const filename, bool const populate)
 {
     const uint64 fsize = FileMapping::GetFileSize(filename);
     if (0 == fsize) {
@@ -33,7 +33,7 @@ FileMapping::data_t::data_t(const char * const filename)
         return;
     }
     A_STATIC_CHECK_TYPE(file_map_detail::view_of_file, m_pFileView);
-    m_pFileView = file_map_detail::map_view_of_file(filename, 0, fsize);
+    m_pFileView = file_map_detail::map_view_of_file(filename, 0, fsize, populate);
     if (m_pFileView) {
         m_FileSize = fsize; // success
     }
@@ -70,6 +70,21 @@ uint64 FileMapping::GetFileSize() const
     return 0;
 }
 
+bool FileMapping::Advise(advice const a) const
+{
+    return Advise(a, 0, GetFileSize());
+}
+
+bool FileMapping::Advise(advice const a, uint64 const offset, uint64 const size) const
+{
+    if (m_data.get() && size && (offset < m_data->GetFileSize())) {
+        const uint64 end = a_min(offset + size, m_data->GetFileSize());
+        return file_map_detail::advise_view_of_file(
+            const_cast<void *>(m_data->GetFileView()), offset, end - offset, a);
+    }
+    return false;
+}
+
 bool FileMapping::IsFileMapped() const
 {
     return (GetFileView() != nullptr);
@@ -80,11 +95,11 @@ void FileMapping::UnmapView()
     m_data.reset();
 }
 
-void const * FileMapping::CreateMapView(const char * const filename)
+void const * FileMapping::CreateMapView(const char * const filename, bool const populate)
 {
     UnmapView();
 
-    std::unique_ptr<data_t> p(new data_t(filename));
+    std::unique_ptr<data_t> p(new data_t(filename, populate));
 
     auto ret = p->GetFileView();
     if (ret) {
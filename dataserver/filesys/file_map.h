@@ -14,8 +14,11 @@ public:
     FileMapping();
     ~FileMapping();
 
+    enum class advice { normal, random, sequential, willneed }; // expected access (madvise)
+
     // Create file mapping for read-only. Returns nullptr if error
-    void const * CreateMapView(const char* filename);
+    // populate: whole file is read into memory before return (MAP_POPULATE)
+    void const * CreateMapView(const char* filename, bool populate = false);
 
     // Close file mapping
     void UnmapView();
@@ -26,6 +29,10 @@ public:
     
     uint64 GetFileSize() const;
 
+    // Access hint for whole view or range. Returns false if not supported
+    bool Advise(advice) const;
+    bool Advise(advice, uint64 offset, uint64 size) const;
+
     static uint64 GetFileSize(const char* filename);
     static uint64 GetFileSize(const std::string & s) {
         return GetFileSize(s.c_str());
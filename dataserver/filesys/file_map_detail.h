@@ -4,7 +4,7 @@
 #ifndef __SDL_FILESYS_FILE_MAP_DETAIL_H__
 #define __SDL_FILESYS_FILE_MAP_DETAIL_H__
 
-#include "dataserver/common/common.h"
+#include "dataserver/filesys/file_map.h"
 
 namespace sdl {
 
@@ -15,11 +15,17 @@ struct file_map_detail : is_static
     static view_of_file map_view_of_file(
         const char* filename,
         uint64 offset,
-        uint64 size);
+        uint64 size,
+        bool populate);
 
     static bool unmap_view_of_file(view_of_file, 
         uint64 offset,
         uint64 size);    
+
+    static bool advise_view_of_file(view_of_file, 
+        uint64 offset,
+        uint64 size,
+        FileMapping::advice);
 };
 
 } // sdl
@@ -5,13 +5,15 @@
 #include "dataserver/filesys/file_map_detail.h"
 #include "dataserver/filesys/file_h.h"
 #include "dataserver/filesys/mmap64_unix.h"
+#include <unistd.h>
 
 namespace sdl {
 
 file_map_detail::view_of_file 
 file_map_detail::map_view_of_file(const char* filename,
                                   uint64 const offset,  
-                                  uint64 const size)
+                                  uint64 const size,
+                                  bool const populate)
 {
     A_STATIC_ASSERT_64_BIT; 
 
@@ -27,9 +29,17 @@ file_map_detail::map_view_of_file(const char* filename,
             SDL_ASSERT(false);
             return nullptr;
         }
+        int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+        if (populate) { // page tables are filled and file is read ahead by mmap
+            flags |= MAP_POPULATE;
+        }
+#else
+        (void)populate;
+#endif
         auto pFileView = mmap64_t::call(
             nullptr, static_cast<size_t>(size), 
-            PROT_READ, MAP_PRIVATE, fileno(fp.get()), 0);
+            PROT_READ, flags, fileno(fp.get()), 0);
 
         if (pFileView == MAP_FAILED) {
             SDL_TRACE("mmap failed: ", filename);
@@ -59,6 +69,34 @@ bool file_map_detail::unmap_view_of_file(
     return false;
 }
 
+bool file_map_detail::advise_view_of_file(
+    view_of_file const p,
+    uint64 const offset,
+    uint64 const size,
+    FileMapping::advice const a)
+{
+    if (p && size) {
+        int advice = MADV_NORMAL;
+        switch (a) {
+        case FileMapping::advice::random:       advice = MADV_RANDOM; break;
+        case FileMapping::advice::sequential:   advice = MADV_SEQUENTIAL; break;
+        case FileMapping::advice::willneed:     advice = MADV_WILLNEED; break;
+        default:
+            break;
+        }
+        static const size_t page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        const size_t first = static_cast<size_t>(offset) / page_size * page_size; // madvise requires aligned address
+        const size_t last = static_cast<size_t>(offset + size);
+        SDL_ASSERT(first < last);
+        if (::madvise(static_cast<char *>(p) + first, last - first, advice)) {
+            SDL_TRACE("madvise failed: ", advice);
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
+
 } // sdl
 
 #if SDL_DEBUG
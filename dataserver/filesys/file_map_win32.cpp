@@ -56,7 +56,8 @@ public:
 file_map_detail::view_of_file 
 file_map_detail::map_view_of_file(const char* filename,
                                   uint64 const offset,  
-                                  uint64 const size)
+                                  uint64 const size,
+                                  bool const populate)
 {
     A_STATIC_ASSERT_64_BIT;
 
@@ -105,6 +106,7 @@ file_map_detail::map_view_of_file(const char* filename,
             0);             // mapping extends from the specified offset to the end of the file mapping.
 
         ::CloseHandle(hFileMapping);
+        (void)populate; // not supported, pages are loaded on first access
 
         if (!pFileView) {
             SDL_TRACE("MapViewOfFile failed : ", filename);
@@ -133,6 +135,12 @@ bool file_map_detail::unmap_view_of_file(
     return false;
 }
 
+bool file_map_detail::advise_view_of_file(
+    view_of_file, uint64, uint64, FileMapping::advice)
+{
+    return false; // not supported
+}
+
 } // sdl
 
 #if SDL_DEBUG
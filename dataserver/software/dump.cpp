@@ -104,6 +104,7 @@ void trace_datatable(db::database const & db, db::datatable const & table, cmd_o
 {
     trace_schema(db, table, opt);
     size_t row_index = 0;
+    const db::database::scoped_access bulk_read; // full scan must not displace shared pages
     for (auto const record : table._record) {
         if ((opt.record_num != -1) && ((int)row_index >= opt.record_num))
             break;
@@ -19,6 +19,15 @@
 #include <set>
 #include <fstream>
 #include <iomanip> // for std::setprecision
+#include <chrono>
+#include <random>
+#if defined(SDL_OS_UNIX)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <spawn.h>
+extern char ** environ;
+#endif
 
 #if SDL_DEBUG_maketable
 #include "dataserver/usertables/maketable_test.h"
@@ -82,12 +91,44 @@ struct cmd_option : noncopyable {
     std::string dump_pages;
     bool checksum = false;
     bool use_page_bpool = false;
+    bool use_page_preload = false;
+    size_t preload_threads = 0;
+    size_t preload_hugetlb = 0;
+    size_t test_lookup = 0;
+    std::string pool_shared;
+    size_t pool_shared_remove = 0;
+    size_t test_shared = 0;
+    size_t test_shared_child = 0; // process number, set by test_shared
+    std::string program; // argv[0]
     bool unlock_thread = false;
     bool defragment = false;
     size_t min_memory = 0;
     size_t max_memory = 0;
     size_t pool_period = 0;
     size_t pool_defrag = 0;
+    size_t pool_defrag_slice = db::database_cfg::default_defrag_slice;
+    size_t pool_shards = 0;
+    size_t pool_readahead = 0;
+    size_t pool_policy = 0;
+    size_t pool_floor_data = 0;
+    size_t pool_floor_index = 0;
+    size_t pool_floor_meta = 0;
+    size_t pool_hugepage = 0;
+    size_t pool_numa = 0;
+    size_t pool_warm = 0;
+    size_t pool_page_read = 0;
+    size_t pool_direct = 0;
+    size_t pool_io_batch = 0;
+    size_t pool_io = 0;
+    size_t pool_io_depth = db::database_cfg::default_io_depth;
+    std::string pool_pressure;
+    size_t pool_pressure_limit = db::database_cfg::default_pressure_limit;
+    size_t pool_pressure_period = db::database_cfg::default_pressure_period;
+    size_t map_advice = 0;
+    size_t map_populate = 0;
+    size_t map_willneed = db::database_cfg::default_map_willneed;
+    size_t test_pool_threads = 0;
+    size_t test_pool_miss = 0;
 };
 
 template<class sys_row>
@@ -1190,11 +1231,15 @@ void trace_datatable(db::database const & db, db::datatable & table, cmd_option
                 });
             if (opt.col_name.empty() || (found_col < table.ut().size())) {
                 size_t row_index = 0;
-                for (auto const record : table._record) {
-                    if ((opt.record_num != -1) && ((int)row_index >= opt.record_num))
-                        break;
-                    std::cout << "\n[" << (row_index++) << "]";
-                    trace_table_record(db, record, opt);
+                if (1) {
+                    const db::database::scoped_access bulk_read; // full scan must not displace shared pages
+                    const db::database::scoped_unpin unpin; // scan pins only current page
+                    for (auto const record : table._record) {
+                        if ((opt.record_num != -1) && ((int)row_index >= opt.record_num))
+                            break;
+                        std::cout << "\n[" << (row_index++) << "]";
+                        trace_table_record(db, record, opt);
+                    }
                 }
                 if (find_record_iterator) { // test API
                     if (auto primary = table.get_PrimaryKey()) {
@@ -2512,11 +2557,229 @@ void test_unlock_thread(db::database const & db, cmd_option const & opt)
                     SDL_TRACE("defragment diff = ", s1 - s2, ", ", mb, " MB");
                 }
             }
+            SDL_TRACE("defragment moved = ", db.pool_defrag_moved(), ", max pause us = ", db.pool_defrag_max_pause());
+        }
+    }
+}
+#endif
+
+void test_pool_miss(db::database const & db, cmd_option const & opt)
+{
+    SDL_ASSERT(opt.test_pool_miss);
+#if defined(SDL_OS_UNIX)
+    { // drop file from OS page cache to measure cold reads
+        const int fd = ::open(db.filename().c_str(), O_RDONLY);
+        if (fd != -1) {
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(fd);
+        }
+    }
+#endif
+    enum { block_page_num = 8 };
+    const size_t block_count = db.page_count() / block_page_num;
+    const size_t thread_count = opt.test_pool_miss;
+    std::atomic<size_t> total(0), total_us(0), max_us(0);
+    const auto start = std::chrono::steady_clock::now();
+    {
+        using unique_joinable_thread = std::unique_ptr<joinable_thread>;
+        std::vector<unique_joinable_thread> test(thread_count);
+        for (size_t t = 0; t < thread_count; ++t) {
+            reset_new(test[t], [t, thread_count, block_count, &db, &total, &total_us, &max_us](){
+                db::database::scoped_thread_lock lock(db);
+                for (size_t b = 1 + t; b < block_count; b += thread_count) { // block 0 is always loaded
+                    db::pageIndex const id = static_cast<db::pageFileID::page32>(b * block_page_num);
+                    const auto t1 = std::chrono::steady_clock::now();
+                    if (db.load_page_head(id)) {
+                        const size_t us = static_cast<size_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - t1).count());
+                        ++total;
+                        total_us += us;
+                        size_t old = max_us;
+                        while ((us > old) && !max_us.compare_exchange_weak(old, us)) {}
+                        db.unlock_page(id);
+                    }
+                }
+            });
+        }
+    }
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "test_pool_miss = " << thread_count
+        << " blocks = " << total
+        << " avg us = " << (total ? (total_us / total) : 0)
+        << " max us = " << max_us
+        << " ms = " << ms
+        << " hit = " << db.pool_hit_count()
+        << " miss = " << db.pool_miss_count()
+        << " page_miss = " << db.pool_page_miss_count()
+        << " io_merge = " << db.pool_io_merge_count()
+        << std::endl;
+}
+
+// sum of page fields is printed, so page reads are not optimized away
+size_t test_lookup_ns(db::database const & db, std::vector<db::pageFileID::page32> const & pages, size_t & sum)
+{
+    sum = 0;
+    for (auto const id : pages) { // warm up: file mapping faults pages in
+        sum += db.load_page_head(id)->data.headerVersion;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    for (auto const id : pages) {
+        sum += db.load_page_head(id)->data.freeData;
+    }
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    return pages.empty() ? 0 : static_cast<size_t>(ns) / pages.size();
+}
+
+void test_lookup(db::database const & db, cmd_option const & opt)
+{
+    SDL_ASSERT(opt.test_lookup);
+    if (db.use_page_bpool() || db.use_page_shared()) { // pages of init thread would stay fixed in pool
+        std::cout << "test_lookup: file mapping or preload only" << std::endl;
+        return;
+    }
+    std::vector<db::pageFileID::page32> pages(opt.test_lookup);
+    {
+        std::mt19937 gen(0);
+        std::uniform_int_distribution<size_t> dist(0, db.page_count() - 1);
+        for (auto & id : pages) {
+            id = static_cast<db::pageFileID::page32>(dist(gen));
+        }
+    }
+    size_t sum = 0;
+    const size_t ns = test_lookup_ns(db, pages, sum);
+    std::cout << "test_lookup = " << pages.size() << " avg ns = " << ns << " sum = " << sum;
+    if (db.use_page_preload()) { // compare with file mapping of the same file
+        db::database const mmap_db(db.filename());
+        const size_t mmap_ns = test_lookup_ns(mmap_db, pages, sum);
+        std::cout << " mmap avg ns = " << mmap_ns << " sum = " << sum
+            << " gain = " << (mmap_ns ? (100.0 * (double(mmap_ns) - double(ns)) / mmap_ns) : 0.0) << "%";
+    }
+    std::cout << std::endl;
+}
+
+#if defined(SDL_OS_UNIX)
+// process started by test_shared compares pages of shared page cache with file mapping;
+// pages are read by worker thread, so they are unlocked (pages of init thread stay pinned)
+int test_shared_child(db::database const & db, cmd_option const & opt)
+{
+    SDL_ASSERT(opt.test_shared_child);
+    const size_t page_count = db.page_count();
+    size_t mismatch = 0;
+    bool error = false;
+    {
+        joinable_thread worker([&db, &opt, page_count, &mismatch, &error](){
+            try {
+                db::database const mmap_db(db.filename());
+                db::database::scoped_thread_lock lock(db);
+                std::mt19937 gen(static_cast<unsigned>(opt.test_shared_child));
+                std::uniform_int_distribution<size_t> dist(0, page_count - 1);
+                for (size_t i = 0; i < page_count; ++i) {
+                    const auto id = static_cast<db::pageFileID::page32>(dist(gen));
+                    db::page_head const * const p1 = db.load_page_head(id);
+                    db::page_head const * const p2 = mmap_db.load_page_head(id);
+                    if (!p1 || !p2 || memcmp(p1, p2, db::page_head::page_size)) {
+                        ++mismatch;
+                    }
+                    db.unlock_page(id);
+                }
+            }
+            catch (std::exception & e) {
+                std::cerr << "test_shared process = " << opt.test_shared_child << " exception = " << e.what() << std::endl;
+                error = true;
+            }
+        });
+    }
+    std::cerr << "test_shared process = " << opt.test_shared_child
+        << " pages = " << page_count
+        << " mismatch = " << mismatch
+        << " attach = " << db.pool_shared_attach()
+        << std::endl;
+    return (error || mismatch) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// child processes are started from this program (posix_spawn, not fork of process with pool threads)
+// and open database with the same shared page cache
+void test_shared(db::database const & db, cmd_option const & opt)
+{
+    SDL_ASSERT(opt.test_shared && db.use_page_shared());
+    const size_t process_count = opt.test_shared;
+    std::vector<pid_t> child;
+    for (size_t k = 0; k < process_count; ++k) {
+        std::vector<std::string> args = {
+            opt.program,
+            "--mdf_file", db.filename(),
+            "--pool_shared", opt.pool_shared,
+            "--silence", "1",
+            "--test_shared_child", std::to_string(k + 1) };
+        std::vector<char *> argv;
+        for (auto & s : args) {
+            argv.push_back(&s[0]);
+        }
+        argv.push_back(nullptr);
+        pid_t pid = 0;
+        if (::posix_spawnp(&pid, opt.program.c_str(), nullptr, nullptr, argv.data(), environ)) {
+            std::cerr << "test_shared: posix_spawnp failed" << std::endl;
+            continue;
         }
+        child.push_back(pid);
     }
+    size_t failed = process_count - child.size();
+    for (pid_t const pid : child) {
+        int status = 0;
+        if ((::waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+            ++failed;
+        }
+    }
+    std::cout << "test_shared = " << process_count
+        << " failed = " << failed
+        << " hit = " << db.pool_hit_count()
+        << " miss = " << db.pool_miss_count()
+        << " used = " << db.pool_used_size()
+        << std::endl;
 }
 #endif
 
+void test_pool_threads(db::database const & db, cmd_option const & opt)
+{
+    SDL_ASSERT(opt.test_pool_threads);
+    const size_t page_count = db.page_count();
+    enum { test_loop = 4 };
+    for (size_t thread_count = 1; thread_count <= opt.test_pool_threads; thread_count *= 2) {
+        std::atomic<size_t> total(0);
+        const auto start = std::chrono::steady_clock::now();
+        {
+            using unique_joinable_thread = std::unique_ptr<joinable_thread>;
+            std::vector<unique_joinable_thread> test(thread_count);
+            for (size_t t = 0; t < thread_count; ++t) {
+                reset_new(test[t], [t, thread_count, page_count, &db, &total](){
+                    db::database::scoped_thread_lock lock(db);
+                    size_t count = 0;
+                    for (size_t k = 0; k < test_loop; ++k) {
+                        for (size_t i = t; i < page_count; i += thread_count) {
+                            if (db.load_page_head(static_cast<db::pageFileID::page32>(i))) {
+                                ++count;
+                            }
+                        }
+                        db.unlock_thread(db::bpool::removef::false_);
+                    }
+                    total += count;
+                });
+            }
+        }
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        std::cout << "test_pool_threads = " << thread_count
+            << " pages = " << total
+            << " ms = " << ms
+            << " pages/ms = " << (ms ? (total / ms) : total.load())
+            << " hit = " << db.pool_hit_count()
+            << " miss = " << db.pool_miss_count()
+            << std::endl;
+    }
+}
+
 void maketables(db::database const & db, cmd_option const & opt)
 {
     if (!opt.out_file.empty()) {
@@ -2623,6 +2886,36 @@ void print_help(int argc, char* argv[])
         << "\n[--max_memory]"
         << "\n[--pool_period]"
         << "\n[--pool_defrag]"
+        << "\n[--pool_defrag_slice] int : max page pool blocks moved while pool shard is locked by defragmentation"
+        << "\n[--pool_shards] int : number of page pool partitions (0 = hardware threads)"
+        << "\n[--pool_readahead] int : max blocks prefetched on sequential access (0 = disable, 16 is typical)"
+        << "\n[--pool_policy] int : page pool replacement policy (0 = LRU, 1 = ARC)"
+        << "\n[--pool_floor_data] memory retained for data pages under eviction"
+        << "\n[--pool_floor_index] memory retained for index pages under eviction"
+        << "\n[--pool_floor_meta] memory retained for allocation pages under eviction"
+        << "\n[--pool_hugepage] int : page pool memory (0 = base pages, 1 = transparent huge pages, 2 = MAP_HUGETLB)"
+        << "\n[--pool_numa] 0|1 : place page pool blocks on NUMA node of loading thread (0 = off)"
+        << "\n[--pool_warm] int : restore page pool blocks from <mdf>.warm (0 = off, 1 = while serving queries, 2 = before)"
+        << "\n[--pool_page_read] 0|1 : random page pool miss reads one page instead of whole block"
+        << "\n[--pool_direct] 0|1 : page pool reads database file bypassing OS page cache (O_DIRECT)"
+        << "\n[--pool_io_batch] int : microseconds to merge concurrent page pool reads of adjacent blocks (0 = off, 50 is typical)"
+        << "\n[--pool_io] int : asynchronous page pool reads (0 = off, 1 = worker threads, 2 = io_uring)"
+        << "\n[--pool_io_depth] int : max in-flight asynchronous page pool reads"
+        << "\n[--pool_pressure] path : memory pressure file which shrinks page pool, e.g. /proc/pressure/memory"
+        << "\n[--pool_pressure_limit] int : percent of time stalled on memory (avg10) which shrinks page pool"
+        << "\n[--pool_pressure_period] int : seconds between reads of memory pressure file"
+        << "\n[--map_advice] int : file mapping access hint without page pool (0 = normal, 1 = random, 2 = sequential)"
+        << "\n[--map_populate] 0|1 : file mapping is read into memory at open (small databases)"
+        << "\n[--map_willneed] int : pages of file mapping requested in advance by scans (0 = off)"
+        << "\n[--test_pool_threads] int : measure page pool throughput with 1..N threads"
+        << "\n[--test_pool_miss] int : measure cold cache miss latency with N threads"
+        << "\n[--use_page_preload] 0|1 : without page pool, database file is read into huge page memory at open"
+        << "\n[--preload_threads] int : threads which read database file at open (0 = hardware threads)"
+        << "\n[--preload_hugetlb] 0|1 : preload memory uses MAP_HUGETLB (needs vm.nr_hugepages)"
+        << "\n[--test_lookup] int : measure N random page lookups without page pool (preload is compared with file mapping)"
+        << "\n[--pool_shared] name : page cache in POSIX shared memory segment used by processes (max_memory limits cache)"
+        << "\n[--pool_shared_remove] 0|1 : remove shared memory segment on exit"
+        << "\n[--test_shared] int : N processes read pages through shared page cache"
         << std::endl;
 }
 
@@ -2704,6 +2997,36 @@ int run_main(cmd_option const & opt)
             << "\nmax_memory = " << opt.max_memory
             << "\npool_period = " << opt.pool_period
             << "\npool_defrag = " << opt.pool_defrag
+            << "\npool_defrag_slice = " << opt.pool_defrag_slice
+            << "\npool_shards = " << opt.pool_shards
+            << "\npool_readahead = " << opt.pool_readahead
+            << "\npool_policy = " << opt.pool_policy
+            << "\npool_floor_data = " << opt.pool_floor_data
+            << "\npool_floor_index = " << opt.pool_floor_index
+            << "\npool_floor_meta = " << opt.pool_floor_meta
+            << "\npool_hugepage = " << opt.pool_hugepage
+            << "\npool_numa = " << opt.pool_numa
+            << "\npool_warm = " << opt.pool_warm
+            << "\npool_page_read = " << opt.pool_page_read
+            << "\npool_direct = " << opt.pool_direct
+            << "\npool_io_batch = " << opt.pool_io_batch
+            << "\npool_io = " << opt.pool_io
+            << "\npool_io_depth = " << opt.pool_io_depth
+            << "\npool_pressure = " << opt.pool_pressure
+            << "\npool_pressure_limit = " << opt.pool_pressure_limit
+            << "\npool_pressure_period = " << opt.pool_pressure_period
+            << "\nmap_advice = " << opt.map_advice
+            << "\nmap_populate = " << opt.map_populate
+            << "\nmap_willneed = " << opt.map_willneed
+            << "\ntest_pool_threads = " << opt.test_pool_threads
+            << "\ntest_pool_miss = " << opt.test_pool_miss
+            << "\nuse_page_preload = " << opt.use_page_preload
+            << "\npreload_threads = " << opt.preload_threads
+            << "\npreload_hugetlb = " << opt.preload_hugetlb
+            << "\ntest_lookup = " << opt.test_lookup
+            << "\npool_shared = " << opt.pool_shared
+            << "\npool_shared_remove = " << opt.pool_shared_remove
+            << "\ntest_shared = " << opt.test_shared
             << std::endl;
     }
     if (opt.precision) {
@@ -2719,18 +3042,61 @@ int run_main(cmd_option const & opt)
     db::database_cfg cfg(opt.min_memory, opt.max_memory);
     cfg.pool_period = opt.pool_period;
     cfg.pool_defrag = opt.pool_defrag;
+    cfg.pool_defrag_slice = opt.pool_defrag_slice;
+    cfg.pool_shards = opt.pool_shards;
+    cfg.pool_readahead = opt.pool_readahead;
+    cfg.pool_policy = opt.pool_policy ? db::database_cfg::replacement::arc : db::database_cfg::replacement::lru;
+    cfg.pool_floor[(int)db::database_cfg::priority::data] = opt.pool_floor_data;
+    cfg.pool_floor[(int)db::database_cfg::priority::index] = opt.pool_floor_index;
+    cfg.pool_floor[(int)db::database_cfg::priority::meta] = opt.pool_floor_meta;
+    cfg.pool_hugepage = static_cast<db::database_cfg::hugepage>(a_min(opt.pool_hugepage, size_t(2)));
+    cfg.pool_numa = (opt.pool_numa != 0);
+    cfg.pool_warm = static_cast<db::database_cfg::warmup>(a_min(opt.pool_warm, size_t(2)));
+    cfg.pool_page_read = (opt.pool_page_read != 0);
+    cfg.pool_direct = (opt.pool_direct != 0);
+    cfg.pool_io_batch = opt.pool_io_batch;
+    cfg.pool_io = static_cast<db::database_cfg::io_backend>(a_min(opt.pool_io, size_t(2)));
+    cfg.pool_io_depth = opt.pool_io_depth;
+    cfg.pool_pressure = opt.pool_pressure;
+    cfg.pool_pressure_limit = opt.pool_pressure_limit;
+    cfg.pool_pressure_period = opt.pool_pressure_period;
+    cfg.map_advice = static_cast<db::database_cfg::map_access>(a_min(opt.map_advice, size_t(2)));
+    cfg.map_populate = (opt.map_populate != 0);
+    cfg.map_willneed = opt.map_willneed;
     cfg.use_page_bpool = opt.use_page_bpool;
+    cfg.use_page_preload = opt.use_page_preload;
+    cfg.preload_threads = opt.preload_threads;
+    cfg.preload_hugetlb = (opt.preload_hugetlb != 0);
+    cfg.pool_shared = opt.pool_shared;
+    struct shared_remove_guard { // segment is removed after database is closed
+        std::string name;
+        ~shared_remove_guard() {
+            if (!name.empty()) {
+                db::database::remove_page_shared(name);
+            }
+        }
+    } const shared_remove { opt.pool_shared_remove ? opt.pool_shared : std::string() };
     db::database m_db(opt.mdf_file, cfg);
     db::database const & db = m_db;
     if (db.is_open()) {
         std::cout << "\ndatabase opened: " << db.filename()
             << "\nuse_page_bpool = " << db.use_page_bpool()
+            << "\nuse_page_preload = " << db.use_page_preload()
+            << "\nuse_page_shared = " << db.use_page_shared()
             << std::endl;
+        if (db.use_page_preload()) {
+            std::cout << "preload seconds = " << (db.preload_time() / 1000000.0) << std::endl;
+        }
     }
     else {
         std::cerr << "\ndatabase failed: " << db.filename() << std::endl;
         return EXIT_FAILURE;
     }
+#if defined(SDL_OS_UNIX)
+    if (opt.test_shared_child) {
+        return test_shared_child(db, opt);
+    }
+#endif
     const size_t page_count = db.page_count();
     {
         enum { page_size = db::page_head::page_size };
@@ -2748,6 +3114,20 @@ int run_main(cmd_option const & opt)
     if (opt.unlock_thread || opt.defragment) {
         test_unlock_thread(db, opt);
     }
+#endif
+    if (opt.test_pool_miss) { // run before other tests to start with empty pool
+        test_pool_miss(db, opt);
+    }
+    if (opt.test_pool_threads) {
+        test_pool_threads(db, opt);
+    }
+    if (opt.test_lookup) {
+        test_lookup(db, opt);
+    }
+#if defined(SDL_OS_UNIX)
+    if (opt.test_shared && db.use_page_shared()) {
+        test_shared(db, opt);
+    }
 #endif
     if (opt.checksum) {
         SDL_UTILITY_SCOPE_TIMER_SEC(timer, "checksum seconds = ");
@@ -2905,12 +3285,44 @@ int run_main(int argc, char* argv[])
     cmd.add(make_option(0, opt.max_memory, "max_memory"));
     cmd.add(make_option(0, opt.pool_period, "pool_period"));
     cmd.add(make_option(0, opt.pool_defrag, "pool_defrag"));
+    cmd.add(make_option(0, opt.pool_defrag_slice, "pool_defrag_slice"));
+    cmd.add(make_option(0, opt.pool_shards, "pool_shards"));
+    cmd.add(make_option(0, opt.pool_readahead, "pool_readahead"));
+    cmd.add(make_option(0, opt.pool_policy, "pool_policy"));
+    cmd.add(make_option(0, opt.pool_floor_data, "pool_floor_data"));
+    cmd.add(make_option(0, opt.pool_floor_index, "pool_floor_index"));
+    cmd.add(make_option(0, opt.pool_floor_meta, "pool_floor_meta"));
+    cmd.add(make_option(0, opt.pool_hugepage, "pool_hugepage"));
+    cmd.add(make_option(0, opt.pool_numa, "pool_numa"));
+    cmd.add(make_option(0, opt.pool_warm, "pool_warm"));
+    cmd.add(make_option(0, opt.pool_page_read, "pool_page_read"));
+    cmd.add(make_option(0, opt.pool_direct, "pool_direct"));
+    cmd.add(make_option(0, opt.pool_io_batch, "pool_io_batch"));
+    cmd.add(make_option(0, opt.pool_io, "pool_io"));
+    cmd.add(make_option(0, opt.pool_io_depth, "pool_io_depth"));
+    cmd.add(make_option(0, opt.pool_pressure, "pool_pressure"));
+    cmd.add(make_option(0, opt.pool_pressure_limit, "pool_pressure_limit"));
+    cmd.add(make_option(0, opt.pool_pressure_period, "pool_pressure_period"));
+    cmd.add(make_option(0, opt.map_advice, "map_advice"));
+    cmd.add(make_option(0, opt.map_populate, "map_populate"));
+    cmd.add(make_option(0, opt.map_willneed, "map_willneed"));
+    cmd.add(make_option(0, opt.test_pool_threads, "test_pool_threads"));
+    cmd.add(make_option(0, opt.test_pool_miss, "test_pool_miss"));
+    cmd.add(make_option(0, opt.use_page_preload, "use_page_preload"));
+    cmd.add(make_option(0, opt.preload_threads, "preload_threads"));
+    cmd.add(make_option(0, opt.preload_hugetlb, "preload_hugetlb"));
+    cmd.add(make_option(0, opt.test_lookup, "test_lookup"));
+    cmd.add(make_option(0, opt.pool_shared, "pool_shared"));
+    cmd.add(make_option(0, opt.pool_shared_remove, "pool_shared_remove"));
+    cmd.add(make_option(0, opt.test_shared, "test_shared"));
+    cmd.add(make_option(0, opt.test_shared_child, "test_shared_child"));
     try {
         if (argc == 1) {
             print_help(argc, argv);
             std::cout << "\nMissing parameters" << std::endl;
             return EXIT_SUCCESS;
         }
+        opt.program = argv[0];
         cmd.process(argc, argv);
         if (opt.mdf_file.empty() && opt.export_database.empty()) {
             throw std::string("Missing input file");
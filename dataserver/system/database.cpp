@@ -61,7 +61,7 @@ bool database::is_open() const {
 }
 
 void const * database::memory_offset(void const * p) const { // diagnostic
-    if (use_page_bpool()) {
+    if (use_page_bpool() || use_page_shared()) {
         return p;
     }
     char const * p1 = (char const *)m_data->pmap().start_address();
@@ -105,9 +105,14 @@ size_t database::page_allocated() const
 break_or_continue
 database::scan_checksum(checksum_fun fun) const
 {
+    const scoped_access bulk_read; // don't displace pages in use
+    const size_t ahead = willneed_size();
     pageFileID id = pageFileID::init(0);
     size_t count = page_count();
     while (count--) {
+        if (ahead && !(id.pageId % ahead)) { // next range of file mapping is read while this one is checked
+            will_need(id.pageId, ahead * 2);
+        }
         if (is_allocated(id)) {
             if (page_head const * const p = load_page_head(id)) {
                 if (p->data.tornBits) {
@@ -143,6 +148,43 @@ bool database::use_page_bpool() const {
     return m_data->use_page_bpool();
 }
 
+bool database::use_page_shared() const {
+    return m_data->use_page_shared();
+}
+
+bool database::remove_page_shared(const std::string & name) {
+    return bpool::shared_page_cache::remove(name);
+}
+
+bool database::use_page_preload() const {
+    return !use_page_bpool() && !use_page_shared() && m_data->pmap().preload();
+}
+
+size_t database::preload_time() const {
+    if (use_page_preload()) {
+        return m_data->pmap().preload()->statistics().load_us;
+    }
+    return 0;
+}
+
+bpool::accessf database::set_thread_access(bpool::accessf const f) {
+    return bpool::page_bpool::set_thread_access(f);
+}
+
+namespace {
+    thread_local bool t_unpin = false; // see database::scoped_unpin
+}
+
+bool database::thread_unpin() {
+    return t_unpin;
+}
+
+bool database::set_thread_unpin(bool const f) {
+    const bool old = t_unpin;
+    t_unpin = f;
+    return old;
+}
+
 std::thread::id database::init_thread_id() const {
     return m_data->init_thread_id();
 }
@@ -151,6 +193,9 @@ size_t database::unlock_thread(std::thread::id const id, bpool::removef const f)
     if (auto p = m_data->pool()) {
         return p->unlock_thread(id, f);
     }
+    if (auto p = m_data->shared()) {
+        return p->unlock_thread(id, f);
+    }
     return 0;
 }
 
@@ -158,6 +203,9 @@ size_t database::unlock_thread(bpool::removef const f) const {
     if (auto p = m_data->pool()) {
         return p->unlock_thread(f);
     }
+    if (auto p = m_data->shared()) {
+        return p->unlock_thread(f);
+    }
     return 0;
 }
 
@@ -168,10 +216,20 @@ size_t database::free_unlocked(bpool::decommitf const f) const {
     return 0;
 }
 
+bool database::save_warm() const {
+    if (auto p = m_data->pool()) {
+        return p->save_warm();
+    }
+    return false;
+}
+
 bool database::unlock_page(pageIndex const pageId) const {
     if (auto p = m_data->pool()) {
         return p->unlock_page(pageId);
     }
+    if (auto p = m_data->shared()) {
+        return p->unlock_page(pageId);
+    }
     return false;
 }
 
@@ -180,6 +238,9 @@ database::lock_page_fixed(pageIndex const pageId) const {
     if (auto p = m_data->pool()) {
         return p->lock_page_fixed(pageId, bpool::fixedf::true_);
     }
+    if (auto p = m_data->shared()) {
+        return p->lock_page_fixed(pageId);
+    }
     return m_data->pmap().lock_page(pageId);
 }
 #if 0
@@ -220,6 +281,9 @@ size_t database::pool_used_size() const {
     if (auto p = m_data->cpool()) {
         return p->alloc_used_size();
     }
+    if (auto p = m_data->shared()) {
+        return p->used_size();
+    }
     return m_data->pmap().file_size();
 }
 
@@ -251,6 +315,169 @@ bool database::pool_defragment() const {
     return false;
 }
 
+size_t database::pool_defrag_max_pause() const {
+    if (auto p = m_data->cpool()) {
+        return p->defrag_statistics().max_pause_us;
+    }
+    return 0;
+}
+
+size_t database::pool_defrag_moved() const {
+    if (auto p = m_data->cpool()) {
+        return p->defrag_statistics().moved;
+    }
+    return 0;
+}
+
+bool database::pool_resize(size_t const min_memory, size_t const max_memory) const {
+    if (auto p = m_data->pool()) {
+        return p->resize(min_memory, max_memory);
+    }
+    return false;
+}
+
+size_t database::pool_max_memory() const {
+    if (auto p = m_data->cpool()) {
+        return p->max_memory();
+    }
+    return 0;
+}
+
+size_t database::pool_pressure_shrink() const {
+    if (auto p = m_data->cpool()) {
+        return p->pressure_shrink_count();
+    }
+    return 0;
+}
+
+size_t database::pool_prefetch(pageIndex const i, size_t const page_count) const {
+    if (auto p = m_data->pool()) {
+        return p->prefetch(i, page_count);
+    }
+    return 0;
+}
+
+bool database::will_need(pageIndex const i, size_t const page_count) const {
+    if (use_page_bpool() || use_page_shared()) {
+        return false;
+    }
+    return m_data->pmap().will_need(i, page_count);
+}
+
+size_t database::willneed_size() const {
+    if (use_page_bpool() || use_page_shared()) {
+        return 0;
+    }
+    return m_data->pmap().willneed_size();
+}
+
+void database::scan_ahead(page_head const * const p) const {
+    SDL_ASSERT(p);
+    if (size_t const ahead = willneed_size()) {
+        pageFileID const & next = p->data.nextPage;
+        if (next && ((next.pageId / 8) != (p->data.pageId.pageId / 8))) { // eight consecutive pages form an extent
+            will_need(next.pageId / 8 * 8, ahead);
+        }
+    }
+}
+
+// pages are sorted, next willneed_size() pages are requested when scan enters them
+void database::scan_ahead(vector_pageFileID const & pages, size_t const pos) const {
+    SDL_ASSERT(pos < pages.size());
+    size_t const ahead = willneed_size();
+    if (!ahead || (pos % ahead)) {
+        return;
+    }
+    size_t const end = a_min(pos + ahead, pages.size());
+    size_t i = pos;
+    while (i < end) { // adjacent pages are requested at once
+        size_t j = i + 1;
+        while ((j < end) && (pages[j].pageId == pages[j - 1].pageId + 1)) {
+            ++j;
+        }
+        will_need(pages[i].pageId, j - i);
+        i = j;
+    }
+}
+
+database::vector_pageIndex
+database::alloc_pages(sysallocunits_row const * const alloc) const
+{
+    SDL_ASSERT(alloc);
+    vector_pageIndex result;
+    if (alloc->data.pgfirstiam) {
+        for (auto const & page : iam_access(this, alloc)) {
+            A_STATIC_CHECK_TYPE(shared_iam_page const &, page);
+            result.push_back(page->head->data.pageId.pageId);
+            if (iam_page_row const * const row = page->first()) {
+                for (pageFileID const & id : *row) { // mixed extent
+                    if (id) {
+                        result.push_back(id.pageId);
+                    }
+                }
+            }
+            page->allocated_extents([&result](pageFileID const & start) { // uniform extent is one page pool block
+                result.push_back(start.pageId);
+            });
+        }
+    }
+    return result;
+}
+
+database::vector_pageIndex
+database::table_pages(schobj_id const id) const
+{
+    vector_pageIndex result;
+    for_dataType([this, id, &result](dataType::type const t){
+        for (auto alloc : *find_sysalloc(id, t)) {
+            A_STATIC_CHECK_TYPE(sysallocunits_row const *, alloc);
+            vector_pageIndex const pages = alloc_pages(alloc);
+            result.insert(result.end(), pages.begin(), pages.end());
+        }
+    });
+    return result;
+}
+
+size_t database::pool_quota(vector_pageIndex const & pages, size_t const max_memory,
+                            bool const pin, bool const prefetch) const {
+    if (auto p = m_data->pool()) {
+        const size_t q = p->set_quota(pages, max_memory, pin);
+        if (q && prefetch) { // asynchronous if io_queue is used
+            p->prefetch(pages);
+        }
+        return q;
+    }
+    return 0;
+}
+
+size_t database::pool_pin_table(schobj_id const id, bool const prefetch) const {
+    if (use_page_bpool()) {
+        return pool_quota(table_pages(id), 0, true, prefetch);
+    }
+    return 0;
+}
+
+size_t database::pool_table_quota(schobj_id const id, size_t const max_memory) const {
+    if (use_page_bpool()) {
+        return pool_quota(table_pages(id), max_memory, false, false);
+    }
+    return 0;
+}
+
+bool database::pool_erase_quota(size_t const q) const {
+    if (auto p = m_data->pool()) {
+        return p->erase_quota(static_cast<bpool::page_bpool::quota_id>(q));
+    }
+    return false;
+}
+
+size_t database::pool_quota_resident(size_t const q) const {
+    if (auto p = m_data->cpool()) {
+        return p->quota_statistics(static_cast<bpool::page_bpool::quota_id>(q)).resident;
+    }
+    return 0;
+}
+
 size_t database::pool_thread_size() const {
     if (auto p = m_data->cpool()) {
         return p->thread_size();
@@ -258,8 +485,52 @@ size_t database::pool_thread_size() const {
     return 0;
 }
 
-size_t database::pool_max_thread_size() {
-    return bpool::thread_id_t::max_size();
+size_t database::pool_max_thread_size() const {
+    if (auto p = m_data->cpool()) {
+        return p->thread_capacity();
+    }
+    return 0;
+}
+
+size_t database::pool_hit_count() const {
+    if (auto p = m_data->cpool()) {
+        return p->hit_count();
+    }
+    if (auto p = m_data->shared()) {
+        return p->statistics().hit;
+    }
+    return 0;
+}
+
+size_t database::pool_miss_count() const {
+    if (auto p = m_data->cpool()) {
+        return p->miss_count();
+    }
+    if (auto p = m_data->shared()) {
+        return p->statistics().miss;
+    }
+    return 0;
+}
+
+size_t database::pool_shared_attach() const {
+    if (auto p = m_data->shared()) {
+        return p->statistics().attach;
+    }
+    return 0;
+}
+
+size_t database::pool_page_miss_count() const {
+    if (auto p = m_data->cpool()) {
+        return p->page_miss_count();
+    }
+    return 0;
+}
+
+size_t database::pool_io_merge_count() const {
+    if (auto p = m_data->cpool()) {
+        return p->io_merge_count();
+    }
+    return 0;
 }
 
 page_head const *
@@ -267,13 +538,57 @@ database::load_page_head(pageIndex const i) const {
     if (auto p = m_data->pool()) {
         return p->lock_page(i);
     }
+    if (auto p = m_data->shared()) {
+        return p->lock_page(i);
+    }
     return m_data->pmap().lock_page(i);
 }
 
+page_head const *
+database::load_page_head(pageIndex const i, bpool::accessf const f) const {
+    if (auto p = m_data->pool()) {
+        return p->lock_page(i, f);
+    }
+    if (auto p = m_data->shared()) {
+        return p->lock_page(i);
+    }
+    return m_data->pmap().lock_page(i);
+}
+
+bpool::lock_page_head
+database::pin_page_head(pageIndex const i) const {
+    if (auto p = m_data->pool()) {
+        return p->pin_page(i);
+    }
+    if (auto p = m_data->shared()) { // page is locked until unlock_thread
+        return bpool::lock_page_head(p->lock_page(i));
+    }
+    return bpool::lock_page_head(m_data->pmap().lock_page(i));
+}
+
+bpool::lock_page_head
+database::scan_page_head(pageFileID const & id) const {
+    if (id) {
+        if (thread_unpin()) {
+            return this->pin_page_head(id.pageId);
+        }
+        return bpool::lock_page_head(this->load_page_head(id.pageId));
+    }
+    return {};
+}
+
+size_t database::pool_pin_count() const {
+    if (auto p = m_data->pool()) {
+        return p->pin_count();
+    }
+    return 0;
+}
+
 database::page_row
 database::load_page_row(recordID const & row) const
 {
-    if (page_head const * const h = load_page_head(row.id)) {
+    // overflow and text rows are locked as usual, record which refers them may be in bulk_read ring
+    if (page_head const * const h = row.id ? load_page_head(row.id.pageId, bpool::accessf::normal) : nullptr) {
         const datapage data(h);
         if (row.slot < data.size()) {
             if (row_head const * const r = data[row.slot]) {
@@ -795,8 +1110,8 @@ database::find_datapage(schobj_id const id,
         if (auto const index = get_cluster_index(id)) { // use cluster index if possible
             if (index->is_root_index()) {
                 const index_tree tree(this, index);
-                page_head const * const min_page = load_page_head(tree.min_page());
-                page_head const * const max_page = load_page_head(tree.max_page());
+                pageFileID const min_page = tree.min_page();
+                pageFileID const max_page = tree.max_page();
                 if (min_page && max_page) {
                     reset_shared<class_clustered_access>(result, this, min_page, max_page);
                     m_data->set_datapage(id, data_type, page_type, result);
@@ -807,7 +1122,7 @@ database::find_datapage(schobj_id const id,
             else {
                 SDL_ASSERT(index->is_root_data());
                 if (page_head const * p = load_pg_index(id, page_type).pgfirst()) {
-                    reset_shared<class_forward_access>(result, this, p);
+                    reset_shared<class_forward_access>(result, this, p->data.pageId);
                     m_data->set_datapage(id, data_type, page_type, result);
                     return result;
                 }
@@ -815,7 +1130,7 @@ database::find_datapage(schobj_id const id,
         }
     }
     // Heap tables won't have root pages
-    vector_page_head heap_pages;
+    vector_pageFileID heap_pages;
     vector_sysallocunits_row const & sysalloc = *find_sysalloc(id, data_type);
     for (auto alloc : sysalloc) {
         A_STATIC_CHECK_TYPE(sysallocunits_row const *, alloc);
@@ -824,9 +1139,9 @@ database::find_datapage(schobj_id const id,
             A_STATIC_CHECK_TYPE(shared_iam_page const &, page);
             page->allocated_pages(this, [this, page_type, &heap_pages](pageFileID const & id) {
                 SDL_ASSERT(id);
-                if (auto p = this->load_page_head(id)) {
+                if (auto const p = this->pin_page_head(id)) { // page is unpinned after type is checked
                     if (p->data.type == page_type) {
-                        heap_pages.push_back(p);
+                        heap_pages.push_back(id);
                     }
                 }
                 else {
@@ -836,10 +1151,7 @@ database::find_datapage(schobj_id const id,
         }
     }
     if (1) {
-        std::sort(heap_pages.begin(), heap_pages.end(), 
-            [](page_head const * x, page_head const * y){
-            return (x->data.pageId < y->data.pageId);
-        });
+        std::sort(heap_pages.begin(), heap_pages.end());
     }
     reset_shared<class_heap_access>(result, this, std::move(heap_pages));
     m_data->set_datapage(id, data_type, page_type, result);
@@ -39,6 +39,7 @@ public:
 
     using vector_sysallocunits_row = std::vector<sysallocunits_row const *>;
     using vector_page_head = std::vector<page_head const *>;
+    using vector_pageFileID = std::vector<pageFileID>;
     using page_head_access = datatable::page_head_access;
     using shared_sysallocunits = std::shared_ptr<vector_sysallocunits_row>;
     using shared_page_head_access = std::shared_ptr<page_head_access>;
@@ -158,103 +159,77 @@ private:
         }
     };
 private:
+    // access classes keep page ids only, pages are pinned by iterators (see database::scoped_unpin)
     class clustered_access: noncopyable {
         database const * const db;
-        page_head const * const min_page;
-        page_head const * const max_page;
+        pageFileID const min_page;
+        pageFileID const max_page;
     public:
-        using iterator = page_iterator<clustered_access const, page_head const *>;
-        clustered_access(database const * p, page_head const * _min, page_head const * _max)
+        clustered_access(database const * p, pageFileID const & _min, pageFileID const & _max)
             : db(p), min_page(_min), max_page(_max) {
             SDL_ASSERT(db && min_page && max_page);
-            SDL_ASSERT(!min_page->data.prevPage);
-            SDL_ASSERT(!max_page->data.nextPage);
-            SDL_ASSERT(min_page->data.type == pageType::type::data);
-            SDL_ASSERT(max_page->data.type == pageType::type::data);
         }
-        iterator begin() const {
-            page_head const * p = min_page;
-            return iterator(this, std::move(p));
-        }
-        iterator end() const {
-            return iterator(this);
+        bpool::lock_page_head first_page() const {
+            return db->scan_page_head(min_page);
         }
         template<class page_pos>
-        page_head const * load_next_head(page_pos const & p) const {
-            A_STATIC_CHECK_TYPE(page_head const *, p.first);
-            return db->load_next_head(p.first);
-        }
-    private:
-        friend iterator;
-        static page_head const * dereference(page_head const * p) {
-            return p;
-        }
-        void load_next(page_head const * & p) const {
-            SDL_ASSERT(p);
-            p = db->load_next_head(p);
-        }
-        void load_prev(page_head const * & p) const {
-            p = p ? db->load_prev_head(p) : max_page;
-        }
-        static bool is_end(page_head const * const p) {
-            return nullptr == p;
+        bpool::lock_page_head load_next_page(page_pos const & p) const {
+            SDL_ASSERT(p.first);
+            if (p.first->data.pageId == max_page) {
+                SDL_ASSERT(!p.first->data.nextPage);
+                return {};
+            }
+            auto next = db->scan_page_head(p.first->data.nextPage);
+            if (next) {
+                db->scan_ahead(next.get());
+            }
+            return next;
         }
     };
     class forward_access: noncopyable {
         database const * const db;
-        page_head const * const head;
+        pageFileID const head;
     public:
-        using iterator = forward_iterator<forward_access const, page_head const *>;
-        forward_access(database const * p, page_head const * h): db(p), head(h) {
+        forward_access(database const * p, pageFileID const & h): db(p), head(h) {
             SDL_ASSERT(db && head);
-            SDL_ASSERT(!head->data.prevPage);
-            SDL_ASSERT(head->data.type == pageType::type::data);
-        }
-        iterator begin() const {
-            page_head const * p = head;
-            return iterator(this, std::move(p));
         }
-        iterator end() const {
-            return iterator(this);
+        bpool::lock_page_head first_page() const {
+            return db->scan_page_head(head);
         }
         template<class page_pos>
-        page_head const * load_next_head(page_pos const & p) const {
-            A_STATIC_CHECK_TYPE(page_head const *, p.first);
-            return db->load_next_head(p.first);
-        }
-    private:
-        friend iterator;
-        static page_head const * dereference(page_head const * p) {
-            return p;
-        }
-        void load_next(page_head const * & p) const {
-            SDL_ASSERT(p);
-            p = db->load_next_head(p);
-        }
-        static bool is_end(page_head const * const p) {
-            return nullptr == p;
+        bpool::lock_page_head load_next_page(page_pos const & p) const {
+            SDL_ASSERT(p.first);
+            auto next = db->scan_page_head(p.first->data.nextPage);
+            if (next) {
+                db->scan_ahead(next.get());
+            }
+            return next;
         }
     };
     class heap_access: noncopyable {
-        vector_page_head const data;
+        database const * const db;
+        vector_pageFileID const data;
     public:
-        using iterator = vector_page_head::const_iterator;
-        heap_access(database const *, vector_page_head && v): data(std::move(v)) {}
-        iterator begin() const {
-            return data.begin();
+        heap_access(database const * p, vector_pageFileID && v): db(p), data(std::move(v)) {
+            SDL_ASSERT(db);
         }
-        iterator end() const {
-            return data.end();
+        bpool::lock_page_head first_page() const {
+            if (data.empty()) {
+                return {};
+            }
+            db->scan_ahead(data, 0);
+            return db->scan_page_head(data[0]);
         }
         template<class page_pos>
-        page_head const * load_next_head(page_pos const & p) const {
+        bpool::lock_page_head load_next_page(page_pos const & p) const {
             A_STATIC_CHECK_TYPE(size_t, p.second);
             size_t const i = p.second + 1;
             SDL_ASSERT(i <= data.size());
             if (i < data.size()) {
-                return data[i];
+                db->scan_ahead(data, i);
+                return db->scan_page_head(data[i]);
             }
-            return nullptr; 
+            return {};
         }
     };
 private:
@@ -266,14 +241,10 @@ private:
         page_head_access_t(Ts&&... params): _access(std::forward<Ts>(params)...) {}
     private:
         page_pos begin_page() const override {
-            auto it = _access.begin();
-            if (it != _access.end()) {
-                return { *it, 0 };
-            }
-            return {};
+            return { _access.first_page(), 0 };
         }
         void load_next(page_pos & p) const override {
-            if ((p.first = _access.load_next_head(p)) != nullptr) {
+            if ((p.first = _access.load_next_page(p))) { // previous page is unpinned
                 ++(p.second);
             }
             else {
@@ -284,6 +255,9 @@ private:
 private:
     page_head const * sysallocunits_head() const;
     page_head const * load_sys_obj(sysObj) const;
+    void scan_ahead(page_head const *) const; // file mapping reads next extents of page chain in advance
+    void scan_ahead(vector_pageFileID const &, size_t pos) const; // file mapping reads next heap pages in advance
+    size_t willneed_size() const; // 0 if page pool is used or database_cfg::map_willneed = 0
 
     template<class T, class fun_type> static
     void for_row(page_access<T> const & obj, fun_type && fun) {
@@ -333,6 +307,10 @@ public:
 
     std::string dbi_dbname() const;
     bool use_page_bpool() const;
+    bool use_page_shared() const; // page cache in shared memory of processes (see database_cfg::pool_shared)
+    static bool remove_page_shared(const std::string & name); // segment of shared page cache is removed (warm cache is lost)
+    bool use_page_preload() const; // database file is copied into memory at open (see database_cfg::use_page_preload)
+    size_t preload_time() const; // microseconds to read database file at open, 0 if file is not preloaded
 public:
     class scoped_thread_lock : noncopyable { // should be not used in main thread
         const database & m_db;
@@ -344,10 +322,35 @@ public:
             m_db.unlock_thread(std::this_thread::get_id(), remove_id);
         }
     };
+    class scoped_unpin : noncopyable { // page iterators of this thread pin only current page
+        const bool m_old;
+    public:
+        explicit scoped_unpin(bool f = true): m_old(set_thread_unpin(f)) {}
+        ~scoped_unpin() { // must be called in the same thread as ctor
+            set_thread_unpin(m_old);
+        }
+    };
+    // if set, datatable::page_head_access iterators unpin page when moving to next page,
+    // so long scans work with bounded page pool; rows of page are valid only while page is pinned
+    static bool set_thread_unpin(bool); // returns previous value
+    static bool thread_unpin();
+    class scoped_access : noncopyable { // access strategy of this thread
+        const bpool::accessf m_old;
+    public:
+        explicit scoped_access(bpool::accessf f = bpool::accessf::bulk_read) // pages of full scan
+            : m_old(set_thread_access(f)) {}
+        ~scoped_access() { // must be called in the same thread as ctor
+            set_thread_access(m_old);
+        }
+    };
+    // bulk_read: blocks loaded by this thread cycle through small ring, pages remain valid
+    // only while block is used by last page_bpool::bulk_ring_size blocks of the thread
+    static bpool::accessf set_thread_access(bpool::accessf); // returns previous strategy
     std::thread::id init_thread_id() const;
-    size_t unlock_thread(std::thread::id, bpool::removef) const; // returns blocks number
+    size_t unlock_thread(std::thread::id, bpool::removef) const; // id must be calling thread, returns blocks number
     size_t unlock_thread(bpool::removef) const; // returns blocks number
     size_t free_unlocked(bpool::decommitf) const; // returns blocks number
+    bool save_warm() const; // resident pool blocks are saved to <filename>.warm (see database_cfg::pool_warm)
 
     bool unlock_page(pageIndex) const;
     bool unlock_page(pageFileID const &) const;
@@ -367,12 +370,38 @@ public:
     size_t pool_free_size() const;
     size_t pool_commited_size() const;
     bool pool_defragment() const;
+    size_t pool_defrag_max_pause() const; // longest time (microseconds) a pool shard was locked by defragmentation
+    size_t pool_defrag_moved() const; // blocks moved by defragmentation
+    bool pool_resize(size_t min_memory, size_t max_memory) const; // page pool limits at runtime, shrinking evicts unlocked blocks
+    size_t pool_max_memory() const; // current page pool limit (lowered under memory pressure)
+    size_t pool_pressure_shrink() const; // page pool limit reductions caused by memory pressure
     size_t pool_thread_size() const;
-    static size_t pool_max_thread_size();
+    size_t pool_max_thread_size() const; // threads registered before thread table grows (number of threads is not limited)
+    size_t pool_hit_count() const;
+    size_t pool_miss_count() const;
+    size_t pool_shared_attach() const; // processes which opened shared page cache
+    size_t pool_page_miss_count() const;
+    size_t pool_io_merge_count() const;
+    size_t pool_prefetch(pageIndex, size_t page_count) const; // page pool reads blocks of page range in advance
+    bool will_need(pageIndex, size_t page_count) const; // file mapping reads page range in advance (page pool uses read-ahead)
+    using vector_pageIndex = std::vector<pageIndex>;
+    vector_pageIndex alloc_pages(sysallocunits_row const *) const; // IAM pages, mixed pages and first pages of uniform extents
+    vector_pageIndex table_pages(schobj_id) const; // all allocation units of table (data, indexes, LOB and row overflow)
+    size_t pool_quota(vector_pageIndex const &, size_t max_memory, bool pin, bool prefetch) const; // returns quota id, 0 if page pool is not used or all quotas are used
+    size_t pool_pin_table(schobj_id, bool prefetch = true) const; // pages of table are never evicted from page pool
+    size_t pool_table_quota(schobj_id, size_t max_memory) const; // soft limit of page pool memory used by table
+    bool pool_erase_quota(size_t) const;
+    size_t pool_quota_resident(size_t) const; // blocks of quota in page pool
 public:
     page_head const * load_page_head(pageIndex) const;
+    page_head const * load_page_head(pageIndex, bpool::accessf) const;
     page_head const * load_page_head(pageFileID const &) const;
 
+    bpool::lock_page_head pin_page_head(pageIndex) const; // page is unpinned by the last handle of this thread
+    bpool::lock_page_head pin_page_head(pageFileID const &) const;
+    bpool::lock_page_head scan_page_head(pageFileID const &) const; // pinned if thread_unpin(), locked otherwise
+    size_t pool_pin_count() const; // pages pinned by handles of this thread
+
     page_head const * load_next_head(page_head const *) const;
     page_head const * load_prev_head(page_head const *) const;
 
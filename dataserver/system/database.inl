@@ -63,6 +63,14 @@ database::load_page_head(pageFileID const & id) const {
     return nullptr;
 }
 
+inline bpool::lock_page_head
+database::pin_page_head(pageFileID const & id) const {
+    if (id) {
+        return this->pin_page_head(id.pageId);
+    }
+    return {};
+}
+
 inline page_head const * 
 database::load_page_head(sysPage const i) const
 {
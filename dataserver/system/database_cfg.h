@@ -8,13 +8,56 @@
 
 namespace sdl { namespace db {
 
+namespace bpool {
+    class pool_group;
+}
+
 struct database_cfg {
+    enum class replacement { lru, arc }; // page pool replacement policy
+    enum class priority { data, index, meta }; // retention class of pool block, lower class is evicted first
+    enum { priority_size = 3 };
+    enum class hugepage { none, advise, hugetlb }; // backing of pool memory: base pages, transparent huge pages, MAP_HUGETLB
+    enum class warmup { none, async, wait }; // restore blocks listed in <database>.warm while serving queries or before
+    enum class io_backend { sync, thread, uring }; // asynchronous reads of page pool (uring falls back to thread)
+    enum class map_access { normal, random, sequential }; // access hint of file mapping (madvise)
     enum { default_period = 15 }; // in seconds 
     enum { default_defrag = min_to_sec<5>::value };
+    enum { default_readahead = 16 }; // in blocks
+    enum { default_defrag_slice = 16 }; // in blocks
+    enum { default_io_batch = 50 }; // in microseconds
+    enum { default_io_depth = 64 }; // in-flight asynchronous reads
+    enum { default_pressure_limit = 10 }; // in percent
+    enum { default_pressure_period = 1 }; // in seconds
+    enum { default_map_willneed = 64 }; // in pages
     size_t min_memory = 0;
     size_t max_memory = 0;
     size_t pool_period = default_period; // used to decommit free blocks
     size_t pool_defrag = default_defrag; // used to defragment pool memory (= 0 to disable)
+    size_t pool_defrag_slice = default_defrag_slice; // max blocks moved while shard is locked by defragmentation
+    size_t pool_shards = 0; // number of independently locked pool partitions (= 0 to use hardware threads)
+    size_t pool_readahead = 0; // max blocks prefetched on sequential access (= 0 to disable, default_readahead is typical value)
+    replacement pool_policy = replacement::lru;
+    size_t pool_floor[priority_size] = {}; // memory retained for each priority class under eviction (bytes)
+    hugepage pool_hugepage = hugepage::none;
+    bool pool_numa = false; // place pool blocks on NUMA node of loading thread
+    warmup pool_warm = warmup::none; // resident blocks are saved to <database>.warm on close
+    bool pool_page_read = false; // random miss reads one page instead of whole block
+    bool pool_direct = false; // read database file bypassing OS page cache (O_DIRECT)
+    size_t pool_io_batch = 0; // window to merge concurrent reads of adjacent blocks, microseconds (= 0 to disable, default_io_batch is typical value)
+    io_backend pool_io = io_backend::sync; // used by read-ahead, warm-start and prefetch (sync = read in calling thread, no io threads)
+    size_t pool_io_depth = default_io_depth;
+    std::string pool_pressure; // PSI file watched to shrink pool, e.g. /proc/pressure/memory (empty = disabled)
+    size_t pool_pressure_limit = default_pressure_limit; // avg10 percent of stalled time which shrinks pool budget
+    size_t pool_pressure_period = default_pressure_period; // in seconds
+    std::shared_ptr<bpool::pool_group> pool_group; // memory budget shared with page pools of other databases (nullptr = own budget)
+    size_t pool_weight = 1; // share of pool_group memory relative to other databases
+    std::string pool_shared; // POSIX shared memory segment of page cache shared by processes, max_memory limits slots (empty = disabled)
+    map_access map_advice = map_access::normal; // used if page pool is off
+    bool map_populate = false; // file mapping is read into memory at open (small databases)
+    size_t map_willneed = default_map_willneed; // pages of file mapping requested in advance by scans (= 0 to disable)
+    bool use_page_preload = false; // without page pool: file is read into huge page memory at open (database fits in RAM)
+    size_t preload_threads = 0; // threads which read file at open (= 0 to use hardware threads)
+    bool preload_hugetlb = false; // MAP_HUGETLB (needs vm.nr_hugepages), otherwise transparent huge pages
     bool use_page_bpool = false;
     database_cfg() = default;
     explicit database_cfg(bool b) noexcept : use_page_bpool(b) {}
@@ -11,8 +11,11 @@ database_PageMapping::database_PageMapping(const std::string & fname, database_c
     if (cfg.use_page_bpool) {
         reset_new(m_pool, fname, cfg);
     }
+    else if (!cfg.pool_shared.empty()) {
+        reset_new(m_shared, fname, cfg);
+    }
     else {
-        reset_new(m_pmap, fname);
+        reset_new(m_pmap, fname, cfg);
     }
 }
 
@@ -22,16 +25,25 @@ database_PageMapping::~database_PageMapping()
 
 bool database_PageMapping::is_open() const
 {
+    if (m_shared) {
+        return m_shared->is_open();
+    }
     return m_pool ? m_pool->is_open() : m_pmap->is_open();
 }
 
 size_t database_PageMapping::page_count() const
 {
+    if (m_shared) {
+        return m_shared->page_count();
+    }
     return m_pool ? m_pool->page_count() : m_pmap->page_count();
 }
 
 std::thread::id database_PageMapping::init_thread_id() const
 {
+    if (m_shared) {
+        return m_shared->init_thread_id;
+    }
     return m_pool ? m_pool->init_thread_id : m_pmap->init_thread_id;
 }
 
@@ -8,11 +8,13 @@
 #include "dataserver/common/compact_map.h"
 #include "dataserver/system/page_map.h"
 #include "dataserver/bpool/page_bpool.h"
+#include "dataserver/bpool/shared_cache.h"
 
 namespace sdl { namespace db {
 
 class database_PageMapping : noncopyable {
     using page_bpool = bpool::page_bpool;
+    using shared_page_cache = bpool::shared_page_cache;
 public:
     database_PageMapping(const std::string & fname, database_cfg const &);
     ~database_PageMapping();
@@ -28,8 +30,14 @@ public:
     page_bpool const * cpool() const { // can be nullptr
         return m_pool.get();
     }
+    bool use_page_shared() const {
+        return m_shared.get() != nullptr;
+    }
+    shared_page_cache * shared() const { // can be nullptr
+        return m_shared.get();
+    }
     PageMapping const & pmap() const {
-        SDL_ASSERT(m_pmap && !m_pool);
+        SDL_ASSERT(m_pmap && !m_pool && !m_shared);
         return * m_pmap.get();
     }
     bool is_open() const;
@@ -39,6 +47,7 @@ private:
     database_cfg const m_cfg;
     std::unique_ptr<bpool::page_bpool> m_pool;
     std::unique_ptr<PageMapping const> m_pmap;
+    std::unique_ptr<shared_page_cache> m_shared;
 };
 
 class database::shared_data final : public database_PageMapping {
@@ -48,8 +48,8 @@ datatable::page_head_access::make_iterator(datatable const * const tab, pageFile
 {
     SDL_ASSERT(tab && id);
     SDL_ASSERT_DEBUG_2(tab->db->find_datapage(tab->get_id(), dataType::type::IN_ROW_DATA, pageType::type::data).get() == this);
-    if (page_head const * h = tab->db->load_page_head(id)) {
-        return iterator(this, page_pos(h, 0));
+    if (auto h = tab->db->scan_page_head(id)) {
+        return iterator(this, page_pos(std::move(h), 0));
     }
     SDL_ASSERT(0);
     return this->end();
@@ -610,6 +610,16 @@ size_t datatable::cluster_index_size() const
     return 0;
 }
 
+size_t datatable::pool_pin(bool const prefetch) const
+{
+    return db->pool_pin_table(get_id(), prefetch);
+}
+
+size_t datatable::pool_quota(size_t const max_memory) const
+{
+    return db->pool_table_quota(get_id(), max_memory);
+}
+
 datatable::record_iterator
 datatable::find_record_iterator(key_mem const & key) const
 {
@@ -8,6 +8,7 @@
 #include "dataserver/system/index_tree.h"
 #include "dataserver/spatial/spatial_tree.h"
 #include "dataserver/spatial/geography.h"
+#include "dataserver/bpool/lock_page.h"
 
 #if (SDL_DEBUG > 1) && defined(SDL_OS_WIN32)
 #define SDL_DEBUG_RECORD_ID     1
@@ -62,7 +63,7 @@ public:
 //------------------------------------------------------------------
     class page_head_access: noncopyable {
     protected:
-        using page_pos = std::pair<page_head const *, size_t>;
+        using page_pos = std::pair<bpool::lock_page_head, size_t>; // page is pinned while iterator refers to it (see database::scoped_unpin)
         virtual page_pos begin_page() const = 0;
     public:
         using iterator = forward_iterator<page_head_access const, page_pos>;
@@ -77,12 +78,12 @@ public:
     private:
         friend iterator;
         static page_head const * dereference(page_pos const & p) {
-            return p.first;
+            return p.first.get();
         }
         virtual void load_next(page_pos &) const = 0;
         static bool is_end(page_pos const & p) {
             SDL_ASSERT(p.first || !p.second);
-            return (nullptr == p.first);
+            return (nullptr == p.first.get());
         }
     };
 //------------------------------------------------------------------
@@ -294,6 +295,9 @@ public:
     record_iterator find_record_iterator(key_mem const & key) const;
     record_iterator find_record_iterator(vector_mem_range_t const & key) const;
 
+    size_t pool_pin(bool prefetch = true) const; // pages of table and its indexes are never evicted from page pool, returns quota id
+    size_t pool_quota(size_t max_memory) const; // soft limit of page pool memory used by table, returns quota id
+
 private:
     template<typename T> 
     static key_mem make_key_mem(T const & key) {
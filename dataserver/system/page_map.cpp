@@ -4,18 +4,34 @@
 
 namespace sdl { namespace db {
 
-PageMapping::PageMapping(const std::string & fname)
+PageMapping::PageMapping(const std::string & fname, database_cfg const & cfg)
     : init_thread_id(std::this_thread::get_id())
+    , m_willneed(cfg.use_page_preload ? 0 : cfg.map_willneed)
 {
     static_assert(page_size == 8 * 1024, "");
     static_assert(page_size == (1 << 13), ""); // 8192 = 2^13
-    if (m_fmap.CreateMapView(fname.c_str())) {
-        const uint64 sz = m_fmap.GetFileSize();
+    if (cfg.use_page_preload) {
+        reset_new(m_preload, fname, cfg);
+        m_start = m_preload->data();
+        m_fileSize = m_preload->size();
+    }
+    else if (m_fmap.CreateMapView(fname.c_str(), cfg.map_populate)) {
+        m_start = static_cast<char const *>(m_fmap.GetFileView());
+        m_fileSize = m_fmap.GetFileSize();
+    }
+    if (m_start) {
+        const uint64 sz = m_fileSize;
         const uint64 pp = sz / page_size;
         SDL_ASSERT(!(sz % page_size));
         SDL_ASSERT(pp < size_t(-1));
         throw_error_if<PageMapping_error>((sz % page_size)!=0, "bad file size");
         m_pageCount = static_cast<size_t>(pp);
+        switch (cfg.map_advice) {
+        case database_cfg::map_access::random:      advise(FileMapping::advice::random); break; // index seeks do not read ahead
+        case database_cfg::map_access::sequential:  advise(FileMapping::advice::sequential); break;
+        default:
+            break;
+        }
     }
     else {
         SDL_WARNING(false);
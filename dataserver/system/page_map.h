@@ -6,6 +6,7 @@
 
 #include "dataserver/system/page_head.h"
 #include "dataserver/filesys/file_map.h"
+#include "dataserver/system/page_preload.h"
 #include <thread>
 
 namespace sdl { namespace db {
@@ -15,33 +16,44 @@ class PageMapping : noncopyable {
     using thread_id = std::thread::id;
 public:
     const thread_id init_thread_id;
-    explicit PageMapping(const std::string & fname);
+    PageMapping(const std::string & fname, database_cfg const &);
     bool is_open() const {
-        return m_fmap.IsFileMapped();
+        return m_start != nullptr;
     }
     void const * start_address() const {
-        return m_fmap.GetFileView();
+        return m_start;
     }
     uint64 file_size() const {
-        return m_fmap.GetFileSize();
+        return m_fileSize;
+    }
+    PagePreload const * preload() const { // nullptr if file is mapped
+        return m_preload.get();
     }
     size_t page_count() const {
         return m_pageCount;
     }
     page_head const * lock_page(pageIndex) const; // load_page
     bool unlock_page(pageIndex) const;
+    bool advise(FileMapping::advice) const; // access hint for whole file
+    bool will_need(pageIndex, size_t page_count) const; // pages are read in advance (MADV_WILLNEED)
+    size_t willneed_size() const { // pages requested in advance by scans, 0 if disabled
+        return m_willneed;
+    }
 private:
     using PageMapping_error = sdl_exception_t<PageMapping>;
     size_t m_pageCount = 0;
+    size_t const m_willneed;
+    char const * m_start = nullptr; // file mapping or preloaded copy of file
+    uint64 m_fileSize = 0;
     FileMapping m_fmap;
+    std::unique_ptr<PagePreload> m_preload;
 };
 
 inline page_head const *
 PageMapping::lock_page(pageIndex const i) const {
     const size_t page = i.value(); // uint32 => size_t
     if (page < m_pageCount) {
-        const char * const data = static_cast<const char *>(start_address());
-        return reinterpret_cast<page_head const *>(data + page * page_size);
+        return reinterpret_cast<page_head const *>(m_start + page * page_size);
     }
     SDL_TRACE("page not found: ", page);
     throw_error<PageMapping_error>("page not found");
@@ -53,6 +65,17 @@ inline bool PageMapping::unlock_page(pageIndex const id) const {
     return false;
 }
 
+inline bool PageMapping::advise(FileMapping::advice const a) const {
+    return m_fmap.Advise(a);
+}
+
+inline bool PageMapping::will_need(pageIndex const i, size_t const page_count) const {
+    if (i.value() < m_pageCount) {
+        return m_fmap.Advise(FileMapping::advice::willneed, uint64(i.value()) * page_size, uint64(page_count) * page_size);
+    }
+    return false;
+}
+
 } // db
 } // sdl
 
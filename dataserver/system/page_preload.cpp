@@ -0,0 +1,128 @@
+// page_preload.cpp
+//
+#include "dataserver/system/page_preload.h"
+#include "dataserver/common/thread.h"
+#include <chrono>
+#if defined(SDL_OS_UNIX)
+#include "dataserver/filesys/mmap64_unix.h"
+#endif
+
+namespace sdl { namespace db {
+
+PagePreload::PagePreload(const std::string & fname, database_cfg const & cfg)
+{
+    bpool::PagePoolFile file(fname);
+    throw_error_if_not<PagePreload_error>(file.is_open() && file.filesize(), "bad file");
+    m_size = file.filesize();
+    size_t thread_count = cfg.preload_threads ? cfg.preload_threads : std::thread::hardware_concurrency();
+#if !defined(SDL_OS_UNIX)
+    thread_count = 1; // file reads are not positional
+#endif
+    thread_count = a_min_max(thread_count, size_t(1), round_up_div(m_size, size_t(chunk_size)));
+    try {
+        alloc(cfg.preload_hugetlb);
+        load(file, thread_count);
+    }
+    catch (...) { // destructor is not called
+        release();
+        throw;
+    }
+}
+
+PagePreload::~PagePreload()
+{
+    release();
+}
+
+void PagePreload::release()
+{
+    if (m_data) {
+#if defined(SDL_OS_UNIX)
+        if (::munmap(m_data, m_alloc_size)) {
+            SDL_ASSERT(!"munmap");
+        }
+#else
+        std::free(m_data);
+#endif
+        m_data = nullptr;
+    }
+}
+
+void PagePreload::alloc(bool const hugetlb)
+{
+    SDL_ASSERT(m_size && !m_data);
+    m_alloc_size = round_up_div(m_size, size_t(huge_page_size)) * huge_page_size;
+#if defined(SDL_OS_UNIX)
+#if defined(MAP_HUGETLB)
+    if (hugetlb) { // needs huge pages reserved by vm.nr_hugepages
+        void * const p = mmap64_t::call(nullptr, m_alloc_size, PROT_READ | PROT_WRITE, 
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            m_data = reinterpret_cast<char *>(p);
+            m_stat.hugetlb = true;
+            return;
+        }
+        SDL_TRACE("PagePreload: MAP_HUGETLB failed, use transparent huge pages");
+    }
+#else
+    (void)hugetlb;
+#endif
+    void * const p = mmap64_t::call(nullptr, m_alloc_size + huge_page_size, // trim to aligned huge page
+        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    throw_error_if<PagePreload_error>(!p || (p == MAP_FAILED), "mmap64_t failed");
+    char * const start = reinterpret_cast<char *>(p);
+    char * const result = reinterpret_cast<char *>(round_up_div(
+        reinterpret_cast<size_t>(start), size_t(huge_page_size)) * huge_page_size);
+    if (result != start) {
+        ::munmap(start, result - start);
+    }
+    char * const end = result + m_alloc_size;
+    if (end != start + m_alloc_size + huge_page_size) {
+        ::munmap(end, (start + m_alloc_size + huge_page_size) - end);
+    }
+#if defined(MADV_HUGEPAGE)
+    ::madvise(result, m_alloc_size, MADV_HUGEPAGE); // hint, ignored if transparent huge pages are disabled
+#endif
+    m_data = result;
+#else
+    (void)hugetlb;
+    m_data = reinterpret_cast<char *>(std::malloc(m_alloc_size));
+    throw_error_if<PagePreload_error>(!m_data, "bad malloc");
+#endif
+}
+
+void PagePreload::load(bpool::PagePoolFile & file, size_t const thread_count)
+{
+    SDL_ASSERT(m_data && thread_count);
+    SDL_ASSERT(file.filesize() == m_size);
+    const auto start = std::chrono::steady_clock::now();
+    std::atomic<size_t> next_chunk(0);
+    std::atomic<bool> error(false);
+    auto read_chunks = [this, &file, &next_chunk, &error]() {
+        try {
+            size_t offset;
+            while (!error && ((offset = next_chunk++ * chunk_size) < m_size)) {
+                file.read(m_data + offset, offset, a_min(size_t(chunk_size), m_size - offset));
+            }
+        }
+        catch (std::exception & e) {
+            SDL_TRACE("PagePreload error = ", e.what());
+            error = true;
+        }
+    };
+    {
+        std::vector<unique_thread> worker(thread_count - 1);
+        for (auto & w : worker) {
+            reset_new(w, read_chunks);
+        }
+        read_chunks(); // this thread reads too
+    }
+    throw_error_if<PagePreload_error>(error, "read failed");
+    m_stat.thread_count = thread_count;
+    m_stat.load_us = static_cast<size_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    SDL_TRACE("PagePreload: ", m_size, " bytes, ", thread_count, " threads, ", m_stat.load_us, " us");
+}
+
+} // db
+} // sdl
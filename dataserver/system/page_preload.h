@@ -0,0 +1,49 @@
+// page_preload.h
+//
+#pragma once
+#ifndef __SDL_SYSTEM_PAGE_PRELOAD_H__
+#define __SDL_SYSTEM_PAGE_PRELOAD_H__
+
+#include "dataserver/system/database_cfg.h"
+#include "dataserver/bpool/file.h"
+
+namespace sdl { namespace db {
+
+// whole database file is copied at open into anonymous memory backed by huge pages,
+// file is read in large chunks by several threads; pages are never faulted in from file
+class PagePreload : noncopyable {
+public:
+    enum { chunk_size = megabyte<8>::value };
+    enum { huge_page_size = megabyte<2>::value };
+    struct stat_t {
+        size_t load_us = 0;         // time to read file
+        size_t thread_count = 0;    // threads used to read file
+        bool hugetlb = false;       // MAP_HUGETLB, otherwise transparent huge pages are advised
+    };
+    PagePreload(const std::string & fname, database_cfg const &);
+    ~PagePreload();
+    char const * data() const {
+        return m_data;
+    }
+    uint64 size() const {
+        return m_size;
+    }
+    stat_t const & statistics() const {
+        return m_stat;
+    }
+private:
+    void alloc(bool hugetlb);
+    void load(bpool::PagePoolFile &, size_t thread_count);
+    void release();
+private:
+    using PagePreload_error = sdl_exception_t<PagePreload>;
+    char * m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_alloc_size = 0; // multiple of huge_page_size
+    stat_t m_stat;
+};
+
+} // db
+} // sdl
+
+#endif // __SDL_SYSTEM_PAGE_PRELOAD_H__